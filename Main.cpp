@@ -2,9 +2,151 @@
 
 int main(int argc, char *args[])
 {
-	//Lade zu Beginn den Startbildschirm
-	Screen_Start::load();
+	//--offscreen: Kein Fenster, gezeichnet wird ber EGL ohne Display in ein Framebuffer-Objekt (z.B. auf Servern ohne GPU).
+	//Muss vor allem anderen feststehen, da Fenster und OpenGL-Context davon abhngen.
+	bool offscreen{ false };
+	for (int i = 1; i < argc; i++)
+		if (std::string{ args[i] } == "--offscreen")
+			offscreen = true;
+	Game::window.open(offscreen);
 
+	//Der Treiber kompiliert die Shader, whrend die Optionen gelesen und die Texturen geladen werden.
+	Game::programs.compile_all();
+
+	//Kommandozeilen-Optionen
+	Netplay_Session netplay{};
+	std::string netplay_remote{};
+	bool rollback{ false };
+	int netplay_port{ 0 }, netplay_side{ 0 }, input_delay{ -1 }, max_rollback{ 10 };
+	Network_Conditions net_out{}, net_in{};
+	uint64_t net_seed{ 1 };
+	bool gl_stats{ false }, null_renderer{ false };
+	int frame_number{ 0 };
+	Pacing_Mode pacing{ PACING_VSYNC };
+	int fps_limit{ target_fps };
+	int max_frames{ 0 };
+	std::string screenshot_path{};
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option{ args[i] };
+		//--export-video <Archiv> <Match> <Datei.y4m>: Rendert ein Replay offscreen in eine Videodatei und beendet das Programm.
+		if (option == "--export-video" && i + 3 < argc)
+		{
+			std::size_t match{ 0 };
+			if (!parse_number(args[i + 2], match))
+				return -1;
+			return Replay_Export::run(args[i + 1], match, args[i + 3]);
+		}
+		//--lockstep <lokaler Port> <Host:Port> <left|right>: Zwei-Spieler-Modus bers Netzwerk, wartet auf den Input vom Gegner.
+		//--rollback <lokaler Port> <Host:Port> <left|right>: Wie --lockstep, aber sagt den Input vom Gegner voraus und spult bei Fehlern zurck.
+		else if ((option == "--lockstep" || option == "--rollback") && i + 3 < argc)
+		{
+			rollback = (option == "--rollback");
+			if (!parse_number(args[i + 1], netplay_port))
+				return -1;
+			netplay_remote = args[i + 2];
+			const std::string side{ args[i + 3] };
+			if (side != "left" && side != "right")
+			{
+				std::cerr << "Error: Unknown side \"" << side << "\" (left, right)!\n";
+				return -1;
+			}
+			netplay_side = (side == "right") ? 1 : 0;
+			i += 3;
+		}
+		//--input-delay <Ticks>: Um wie viele Ticks der eigene Input verzgert wird (Standard: 3 im Lockstep, 1 mit Rollback).
+		else if (option == "--input-delay" && i + 1 < argc)
+		{
+			if (!parse_number(args[++i], input_delay))
+				return -1;
+		}
+		//--max-rollback <Ticks>: Wie viele Ticks hchstens vorhergesagt werden, bevor auf den Gegner gewartet wird.
+		else if (option == "--max-rollback" && i + 1 < argc)
+		{
+			if (!parse_number(args[++i], max_rollback))
+				return -1;
+		}
+		//--net-out <Bedingungen>, --net-in <Bedingungen>: Simuliert ein schlechtes Netzwerk, z.B. latency=50,jitter=10,loss=2.
+		else if ((option == "--net-out" || option == "--net-in") && i + 1 < argc)
+		{
+			if (!Network_Conditions::parse(args[++i], option == "--net-out" ? net_out : net_in))
+				return -1;
+		}
+		//--net-seed <Zahl>: Seed fr das simulierte Netzwerk.
+		else if (option == "--net-seed" && i + 1 < argc)
+		{
+			if (!parse_number(args[++i], net_seed))
+				return -1;
+		}
+		//--texture-atlas: Legt Schrift und Portraits in eine gemeinsame Textur. Muss vor --export-video stehen.
+		else if (option == "--texture-atlas")
+			Game::textures.use_atlas(true);
+		//--gl-stats: Gibt jede Sekunde aus, wie viele OpenGL-Aufrufe und wie viel Zeit ein Bild braucht.
+		else if (option == "--gl-stats")
+			gl_stats = true;
+		//--null-renderer: Zeichnet nichts, sondern zeichnet die Befehle nur auf. Misst mit --gl-stats die CPU-Zeit ohne Treiber.
+		else if (option == "--null-renderer")
+			null_renderer = true;
+		//--always-redraw: Zeichnet auch statische Mens jedes Bild neu, selbst wenn sich nichts verndert hat.
+		else if (option == "--always-redraw")
+			Game::redraw.enabled = false;
+		//--pacing <vsync|adaptive|limit|uncapped>: Wie die Bildrate begrenzt wird (Standard: vsync).
+		else if (option == "--pacing" && i + 1 < argc)
+		{
+			if (!Frame_Pacer::parse(args[++i], pacing))
+				return -1;
+		}
+		//--fps <Bilder>: Ziel-Bildrate fr --pacing limit (Standard: 60). Die Physik luft unabhngig davon mit 60 Ticks.
+		else if (option == "--fps" && i + 1 < argc)
+		{
+			if (!parse_number(args[++i], fps_limit))
+				return -1;
+		}
+		//--frames <n>: Beendet das Spiel nach n gezeichneten Bildern, z.B. fr Benchmarks.
+		else if (option == "--frames" && i + 1 < argc)
+		{
+			if (!parse_number(args[++i], max_frames))
+				return -1;
+		}
+		//--screenshot <Datei.ppm>: Speichert das letzte Bild vor dem Beenden (ohne --frames das erste).
+		else if (option == "--screenshot" && i + 1 < argc)
+			screenshot_path = args[++i];
+	}
+	Game::pacer.set_mode(pacing, fps_limit);
+	if (!screenshot_path.empty() && max_frames <= 0)
+		max_frames = 1;
+	if (null_renderer)
+		Game::gl.set_backend(Game::null_backend);
+
+	//Offscreen wird in ein Framebuffer-Objekt gezeichnet, und zwar jedes Bild, da niemand zuschaut oder Events schickt.
+	Framebuffer offscreen_target{};
+	if (Game::window.is_offscreen())
+	{
+		offscreen_target.load(window.width(), window.height());
+		offscreen_target.bind();
+		Game::redraw.enabled = false;
+	}
+
+	//Lade zu Beginn den Startbildschirm, oder direkt das Spiel im Netzwerkmodus.
+	if (!netplay_remote.empty())
+	{
+		if (input_delay < 0)
+			input_delay = rollback ? 1 : 3;
+		if (!netplay.open(static_cast<uint16_t>(netplay_port), netplay_remote, netplay_side, input_delay, rollback ? max_rollback : 0))
+			return -1;
+		if (net_out.is_active() || net_in.is_active())
+			netplay.emulate(net_out, net_in, net_seed);
+		Screen_Main::load_netplay(netplay);
+		Pong::menu = SCREEN_MAIN;
+	}
+	else
+		Screen_Start::load();
+	Menu menu_drawn{ Pong::menu };
+	const bool netplay_active{ !netplay_remote.empty() };
+	const int tick_ms{ static_cast<int>(1000.0 * dt) };
+
+	//Erst hier, damit die erste Ausgabe von --gl-stats das Laden nicht mitzhlt.
+	double stats_time{ Game::clock.get_time() };
 	while(window.is_open)
 	{
 		//Alte Events
@@ -29,10 +171,12 @@ int main(int argc, char *args[])
 			 //Taste wird gedrckt
 			case SDL_KEYDOWN:
 				keystate[event.key.keysym.scancode] = true;
+				Game::redraw.mark_dirty();
 				break;
 			 //Taste wird wieder losgelassen
 			case SDL_KEYUP:
 				keystate[event.key.keysym.scancode] = false;
+				Game::redraw.mark_dirty();
 				break;
 
 			//Behandle Fenster-Events
@@ -41,14 +185,33 @@ int main(int argc, char *args[])
 				{
 				case SDL_WINDOWEVENT_SIZE_CHANGED:
 					window.update_size();
+					Game::redraw.mark_dirty();
 					break;
 
+				//Minimiert steht das Spiel still, ausser im Netzwerkmodus, wo der Gegner weiterspielt.
 				case SDL_WINDOWEVENT_MINIMIZED:
+					if (!window.is_minimized && !netplay_active)
+						Game::clock.pause();
 					window.is_minimized = true;
 					break;
 
 				case SDL_WINDOWEVENT_RESTORED:
+					Game::clock.resume();
 					window.is_minimized = false;
+					Game::redraw.mark_dirty();
+					break;
+
+				case SDL_WINDOWEVENT_FOCUS_GAINED:
+					window.has_focus = true;
+					break;
+
+				case SDL_WINDOWEVENT_FOCUS_LOST:
+					window.has_focus = false;
+					break;
+
+				//Das Fenster war verdeckt: Das alte Bild ist nicht mehr gltig.
+				case SDL_WINDOWEVENT_EXPOSED:
+					Game::redraw.mark_dirty();
 					break;
 				}
 				break;
@@ -61,6 +224,7 @@ int main(int argc, char *args[])
 
 			//Welche Maustaste gedrckt wurde und ob via Doppelklick.
 			case SDL_MOUSEBUTTONDOWN:
+				Game::redraw.mark_dirty();
 				switch (event.button.button)
 				{
 				case SDL_BUTTON_LEFT:
@@ -83,6 +247,7 @@ int main(int argc, char *args[])
 
 			//Wenn man die Maustaste nicht lnger drckt.
 			case SDL_MOUSEBUTTONUP:
+				Game::redraw.mark_dirty();
 				mouse.left_click = false;
 				mouse.left_doubleclick = false;
 				mouse.right_click = false;
@@ -93,6 +258,7 @@ int main(int argc, char *args[])
 			//Um wie viel das Mausrad gedreht wurde.
 			case SDL_MOUSEWHEEL:
 				mouse.mousewheel = Game::event.wheel.y;
+				Game::redraw.mark_dirty();
 				break;
 			}
 		}
@@ -121,7 +287,14 @@ int main(int argc, char *args[])
 			break;
 		}
 
-		//Update die Physik in delta-Zeit.
+		//Das Match luft in einem eigenen Thread mit festen Ticks. Minimiert steht es still, ausser im Netzwerkmodus.
+		const bool simulate{ Pong::menu == SCREEN_MAIN && (!Game::window.is_minimized || netplay_active) };
+		if (simulate && !Screen_Main::simulation.is_running())
+			Screen_Main::start_simulation();
+		else if (!simulate && Screen_Main::simulation.is_running())
+			Screen_Main::stop_simulation();
+
+		//Update die Physik der Mens in delta-Zeit.
 		time_new = Game::clock.get_time();
 		rest_time += time_new - time_old;
 		time_old = time_new;
@@ -129,8 +302,7 @@ int main(int argc, char *args[])
 		{
 			switch (Pong::menu)
 			{
-			case SCREEN_MAIN:
-				Screen_Main::update_physics(dt);
+			case SCREEN_MAIN:	//Luft im Simulations-Thread.
 				break;
 
 			case SCREEN_OPTIONS:
@@ -149,7 +321,7 @@ int main(int argc, char *args[])
 		switch (Pong::menu)
 		{
 		case SCREEN_MAIN:
-			Screen_Main::update_graphics(alpha);
+			Screen_Main::update_graphics();
 			break;
 
 		case SCREEN_OPTIONS:
@@ -161,10 +333,15 @@ int main(int argc, char *args[])
 			break;
 		}
 
+		//Statische Mens werden nur neu gezeichnet, wenn sich etwas verndert hat. Spiel und Endlos-Optionen bewegen sich immer.
+		const bool static_screen{ Pong::menu == SCREEN_START || Pong::menu == SCREEN_OPTIONS || Pong::menu == SCREEN_OPTIONSTOURNAMENT };
+		if (Pong::menu != menu_drawn)
+			Game::redraw.mark_dirty();
+
 		//Behandle Render-Funktionen
-		if (!Game::window.is_minimized) //Zeichne nur, falls das Fenster nicht minimiert wurde.
+		if (!Game::window.is_minimized && (!static_screen || Game::redraw.needs_redraw())) //Zeichne nur, falls das Fenster nicht minimiert wurde.
 		{
-			glClear(GL_COLOR_BUFFER_BIT);
+			Game::gl.clear();
 			switch (Pong::menu)
 			{
 			case SCREEN_START:
@@ -187,14 +364,56 @@ int main(int argc, char *args[])
 				Screen_OptionsEndless::draw();
 				break;
 			}
-			SDL_GL_SwapWindow(window.get_window());
+			Game::quads.flush();
+			Game::quads.end_frame();
+			if (++frame_number == max_frames)
+			{
+				if (!screenshot_path.empty())
+					Framebuffer::save_screenshot(screenshot_path, window.width(), window.height());
+				window.is_open = false;
+			}
+			Game::gl.present(window.get_window());
+
+			Game::gl.end_frame();
+			if (gl_stats && frame_number % target_fps == 0)
+			{
+				const GL_State::Statistics& statistics{ Game::gl.get_frame_statistics() };
+				const double time_now{ Game::clock.get_time() };
+				std::cout << "[gl] " << statistics.calls << " calls per frame (" << statistics.draw_calls << " draw calls, "
+					<< statistics.bytes_uploaded << " bytes uploaded), " << statistics.skipped << " redundant calls skipped, "
+					<< 1000.0 * (time_now - stats_time) / target_fps << " ms per frame\n";
+				stats_time = time_now;
+			}
+			Game::redraw.presented();
+			menu_drawn = Pong::menu;
+
+			//Ohne Fokus hchstens etwa ein Bild pro Tick, sonst nach dem gewhlten Modus.
+			if (Game::window.has_focus)
+				Game::pacer.wait_for_next_frame();
+			else
+				Game::pacer.idle(tick_ms);
 		}
+		//Minimiert wird nichts gezeichnet. Im Netzwerkmodus muss die Physik weiterlaufen, sonst reicht seltenes Aufwachen.
+		else if (Game::window.is_minimized)
+			Game::pacer.idle(netplay_active ? tick_ms : 250);
+		//Nichts hat sich verndert: Das alte Bild bleibt stehen, warte auf das nchste Event.
+		else
+			Game::pacer.idle(tick_ms);
 	}
 
-	Game::window.close_SDL();
+	//Falls das Fenster whrend eines Matches geschlossen wurde.
+	Screen_Main::stop_simulation();
+	if (Pong::menu == SCREEN_MAIN)
+	{
+		Screen_Main::save_replay();
+		Screen_Main::write_finished_replay();
+	}
 
-	//Damit der Kompiler keine Warnung darber gibt, dass man argc und args nicht genutzt hat.
-	(void)argc;
-	(void)args;
+	Game::quads.unload();
+	Game::programs.unload();
+	Game::geometry.unload();
+	Game::textures.unload();
+	offscreen_target.unload();
+	Game::window.close_SDL();
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,183 @@
+//Kommandozeilen-Tool, um das Replay-Archiv zu durchsuchen. Braucht weder SDL noch OpenGL:
+//  g++ -std=c++20 -O2 Pong_Archive_Tool.cpp -o pong_archive
+#include "Pong_Replay.h"
+#include <chrono>
+#include <cstdlib>
+#include <charconv>
+
+namespace Archive_Tool
+{
+	const char* personality_names[3]{ "calm", "aggressive", "strategic" };
+	const char* intelligence_names[3]{ "player", "dumb", "smart" };
+
+	void print_usage()
+	{
+		std::cerr << "Usage: pong_archive <archive> <command> [filters]\n"
+			<< "Commands:\n"
+			<< "  stats               Number of matches and segments.\n"
+			<< "  query [filters]     List all matching matches.\n"
+			<< "  count [filters]     Count all matching matches.\n"
+			<< "  frames <match>      Decode and print the frames of one match.\n"
+			<< "  compact             Merge all segments into one.\n"
+			<< "Filters:\n"
+			<< "  --personality calm|aggressive|strategic\n"
+			<< "  --intelligence player|dumb|smart\n"
+			<< "  --treact MIN:MAX  --score-left MIN:MAX  --score-right MIN:MAX  --rally MIN:MAX\n";
+	}
+
+	int find_name(const char* const* names, int n, const std::string& name)
+	{
+		for (int i{ 0 }; i < n; i++)
+		{
+			if (name == names[i])
+				return i;
+		}
+		std::cerr << "Error: Unknown value " << name << '\n';
+		exit(-1);
+	}
+
+	//Liest eine Zahl. Ist der Text keine Zahl oder hat er Reste, wird mit der Hilfe abgebrochen.
+	template<typename T>
+	T parse_number(const std::string& text)
+	{
+		T value{};
+		const char* end{ text.data() + text.size() };
+		const auto [number_end, error]{ std::from_chars(text.data(), end, value) };
+		if (error != std::errc{} || number_end != end)
+		{
+			std::cerr << "Error: Invalid number " << text << '\n';
+			print_usage();
+			exit(-1);
+		}
+		return value;
+	}
+
+	//Liest einen Bereich der Form MIN:MAX. Fehlt eine Seite, bleibt der alte Wert.
+	template<typename T>
+	void parse_range(const std::string& text, T& min, T& max)
+	{
+		std::size_t colon = text.find(':');
+		std::string lower = text.substr(0, colon);
+		std::string upper = (colon == std::string::npos) ? lower : text.substr(colon + 1);
+		if (!lower.empty())
+			min = static_cast<T>(parse_number<double>(lower));
+		if (!upper.empty())
+			max = static_cast<T>(parse_number<double>(upper));
+	}
+
+	bool parse_query(int argc, char* args[], int first, Replay_Query& q)
+	{
+		for (int i{ first }; i < argc; i++)
+		{
+			std::string option{ args[i] };
+			if (i + 1 >= argc)
+			{
+				std::cerr << "Error: Missing value for " << option << '\n';
+				return false;
+			}
+			std::string value{ args[++i] };
+
+			if (option == "--personality")
+				q.personality = find_name(personality_names, 3, value);
+			else if (option == "--intelligence")
+				q.intelligence = find_name(intelligence_names, 3, value);
+			else if (option == "--treact")
+				parse_range(value, q.t_react_min, q.t_react_max);
+			else if (option == "--score-left")
+				parse_range(value, q.score_left_min, q.score_left_max);
+			else if (option == "--score-right")
+				parse_range(value, q.score_right_min, q.score_right_max);
+			else if (option == "--rally")
+				parse_range(value, q.rally_min, q.rally_max);
+			else
+			{
+				std::cerr << "Error: Unknown option " << option << '\n';
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void print_match(std::size_t row, const Replay_Info& info)
+	{
+		std::cout << row << '\t' << (info.personality < 3 ? personality_names[info.personality] : "?")
+			<< '\t' << (info.intelligence < 3 ? intelligence_names[info.intelligence] : "?")
+			<< '\t' << info.t_react_multiplier << '\t' << info.score_left << ':' << info.score_right
+			<< '\t' << info.rally_length << '\t' << info.n_frames << '\n';
+	}
+};
+
+int main(int argc, char* args[])
+{
+	using namespace Archive_Tool;
+	using clock = std::chrono::steady_clock;
+
+	if (argc < 3)
+	{
+		print_usage();
+		return -1;
+	}
+
+	const std::string command{ args[2] };
+	auto t0 = clock::now();
+	Replay_Archive archive{};
+	if (!archive.open(args[1]))
+		return -1;
+	auto t1 = clock::now();
+
+	if (command == "stats")
+	{
+		std::cout << "Matches: " << archive.size() << "\nSegments: " << archive.number_of_segments() << '\n';
+	}
+	else if (command == "query" || command == "count")
+	{
+		Replay_Query q{};
+		if (!parse_query(argc, args, 3, q))
+			return -1;
+
+		std::vector<std::size_t> rows = archive.query(q);
+		auto t2 = clock::now();
+
+		if (command == "count")
+			std::cout << rows.size() << '\n';
+		else
+		{
+			std::cout << "match\tpersonality\tintelligence\ttreact\tscore\trally\tframes\n";
+			for (std::size_t row : rows)
+				print_match(row, archive.get_info(row));
+		}
+
+		std::cerr << "Read metadata of " << archive.size() << " matches in " << std::chrono::duration<double, std::milli>(t1 - t0).count()
+			<< " ms, query took " << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms.\n";
+	}
+	else if (command == "frames" && argc >= 4)
+	{
+		std::size_t row = parse_number<std::size_t>(args[3]);
+		std::vector<Replay_Frame> frames;
+		if (row >= archive.size() || !archive.load_frames(row, frames))
+		{
+			std::cerr << "Error: Could not load match " << row << '\n';
+			return -1;
+		}
+		for (const Replay_Frame& frame : frames)
+		{
+			std::cout << frame.x_ball << ' ' << frame.y_ball << ' ' << frame.y_player << ' ' << frame.y_opponent << ' '
+				<< frame.score_left << ' ' << frame.score_right << '\n';
+		}
+	}
+	else if (command == "compact")
+	{
+		if (!archive.compact())
+		{
+			std::cerr << "Error: Could not compact the replay archive!\n";
+			return -1;
+		}
+	}
+	else
+	{
+		print_usage();
+		return -1;
+	}
+
+	return 0;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "SDL_Game_Header.h"
+#include "Pong_Simulation.h"
 
 //Spielrand. Gerade Linie, die entweder oben oder unten ist.
 class Obj_Edge
@@ -51,7 +52,7 @@ public:
 	}
 
 	//Variablen, die andere Objekte bentigen.
-	static constexpr float level_border{ 0.1f };			//Der Punkt, wo der Ball vom Rand abprallt.
+	static constexpr float level_border{ Simulation::level_border };	//Der Punkt, wo der Ball vom Rand abprallt.
 	static constexpr float edge_cutoff{ 0.05f };			//Abstand vom linken und rechten Bildrand. 
 	//0.05f fr ganzen Bildschirm, 0.175f damit Schlger am Tischrand sind, 0.15625f fr 200 Pixel Abstand.
 
@@ -140,33 +141,13 @@ private:
 	Shader_Lines line_shader{};
 };
 
-//Forward-Deklarationen
-class Obj_Schlaeger;
-class Obj_Ball;
-class Obj_ScoreBoard;
-class Obj_Portrait;
-
-//K.I. Verhalten Schlger
-enum Personality
-{
-	CALM,
-	AGGRESSIVE,
-	STRATEGIC,
-};
-
-enum Intelligence
-{
-	PLAYER,
-	DUMB,
-	SMART,
-};
-
+//Schlger, wie er gezeichnet wird. Die Physik und die K.I. sind in Sim_Schlaeger (Pong_Simulation.h).
 class Obj_Schlaeger
 {
 public:
 
-	Obj_Schlaeger(double x = 0.0, double y = 0.0, Intelligence in = PLAYER, Personality p = CALM) : 
-		x{x}, y{y}, x_old{x}, y_old{y}, x_draw{(float)x}, y_draw{(float)y}, personality{p}, intelligence{in}
+	Obj_Schlaeger(double x = 0.0, double y = 0.0) : 
+		x{x}, y{y}, y_old{y}, x_draw{(float)x}, y_draw{(float)y}
 	{}
 
 	void load()
@@ -176,69 +157,30 @@ public:
 			shader.load();
 			shader.move_to(x_draw,y_draw);
 			shader.change_size(size);
-			if(intelligence == PLAYER)
-				shader.change_colour({0.9f,0.9f,0.9f});
-			else
-			{
-				t_react = 1.0;
-				switch(personality)
-				{
-				case CALM:
-					shader.change_colour({ 0.0f,0.9f,0.0f });
-					set_reaction_time(t_react);
-					break;
-
-				case AGGRESSIVE:
-					shader.change_colour({ 0.9f,0.0f,0.0f });
-					set_reaction_time(t_react);
-					break;
-
-				case STRATEGIC:
-					shader.change_colour({ 0.0f,0.0f,0.9f });
-					set_reaction_time(t_react);
-					break;
-				}
-			}
+			shader.change_colour(colour());
 			loaded = true;
 		}
 	}
 
-	void change_personality(Personality p)
+	//bernimm Position und Aussehen aus der Simulation.
+	void update_state(const Sim_Schlaeger& sim)
 	{
-		personality = p;
-		if(intelligence != PLAYER)
+		x = sim.x;
+		y = sim.y;
+		y_old = sim.y_old;
+		if (sim.personality != personality || sim.intelligence != intelligence)
 		{
-			switch (personality)
-			{
-			case CALM:
-				shader.change_colour({ 0.0f,0.9f,0.0f });
-				break;
-
-			case AGGRESSIVE:
-				shader.change_colour({ 0.9f,0.0f,0.0f });
-				break;
-
-			case STRATEGIC:
-				shader.change_colour({ 0.0f,0.0f,0.9f });
-				break;
-			}
+			personality = sim.personality;
+			intelligence = sim.intelligence;
+			shader.change_colour(colour());
 		}
 	}
 
-	void change_intelligence(Intelligence i)
-	{
-		intelligence = i;
-	}
-
-	Personality get_personality() const
+	//Setze den Schlger direkt auf eine Position, z.B. beim Abspielen eines Replays.
+	void move_to(double y_new)
 	{
-		return personality;
-	}
-
-	void reset_position()
-	{
-		y_old = 0.0;
-		y = 0.0;
+		y_old = y_new;
+		y = y_new;
 		update_graphics();
 	}
 
@@ -250,91 +192,25 @@ public:
 		}
 	}
 
-	void update_physics(double dt, Obj_Schlaeger &player, Obj_Schlaeger &opponent)
-	{
-		x_old = x;
-		y_old = y;
-
-		bool collision_up = (y + 0.5 * size.height >= 1.0 - Obj_Edge::level_border) && v_y > 0.0;
-		bool collision_down = (y - 0.5 * size.height <= -1.0 + Obj_Edge::level_border) && v_y < 0.0;
-
-		if (collision_down || collision_up)
-		{
-			v_y = 0.0;
-			//Linker Rand
-			if (x <= -1.0)
-			{
-				opponent.lost_last_round = false;
-				player.lost_last_round = true;
-			}
-			//Rechter Rand
-			else if (x >= 1.0)
-			{
-				player.lost_last_round = false;
-				opponent.lost_last_round = true;
-			}
-		}
-
-		x += v_x * dt;
-		y += v_y * dt;
-	}
-
 	void update_graphics(double alpha = 1.0)
 	{
-		x_draw = static_cast<float>(alpha * x + (1.0 - alpha) * x_old);
+		x_draw = static_cast<float>(x);
 		y_draw = static_cast<float>(alpha * y + (1.0 - alpha) * y_old);
 		shader.move_to(x_draw, y_draw);
 	}
 
-	void process_input()
+	//Input vom Spieler via Tastatur.
+	static uint8_t read_input()
 	{
 		using namespace Game;
 		if (keystate[key.KEY_UP] || keystate[key.KEY_UP2])
-			v_y = v_max;
+			return INPUT_UP;
 		else if (keystate[key.KEY_DOWN] || keystate[key.KEY_DOWN2])
-			v_y = -v_max;
+			return INPUT_DOWN;
 		else
-			v_y = 0.0;
+			return INPUT_NONE;
 	}
 
-	double set_reaction_time(double multiplier);
-
-	bool move_to_centre(double tiredness = 0.2, double radius = 0.001)
-	{
-		if (y < -radius)
-		{
-			v_y = tiredness * v_max;
-			//std::cout << "Moving co centre up!\n";
-			return false;
-		}
-		else if (y > radius)
-		{
-			v_y = -tiredness * v_max;
-			//std::cout << "Moving co centre down!\n";
-			return false;
-		}
-		else
-		{
-			v_y = 0.0;
-			//std::cout << "Reached centre!\n";
-			return true;
-		}
-	}
-
-	void wiggle(double speed = 5.0, double amplitude = 0.5)
-	{
-		double omega = speed / amplitude;
-
-		if (move_to_centre(1.0, amplitude + 0.1))
-			v_y = -1.0 * amplitude * omega * std::sin(omega * Game::clock.get_time());
-	}
-
-	double determine_Ball_path(const Obj_Ball& ball);
-
-	void move_to_Ball(const Obj_Ball& ball);
-
-	void react_to_Ball(const Obj_Ball& ball);
-
 	void unload()
 	{
 		if(loaded)
@@ -349,32 +225,39 @@ public:
 		unload();
 	}
 
-	friend class Obj_Ball;
-
 private:
 	bool loaded{ false };
+	double x, y, y_old;
 
-	//Physik-Variablen
-	double x, y, x_old, y_old;
-	double v_x{0.0}, v_y{0.0};
-	const double v_max{ 2.0 };
-	double y_ball{ 0.0 }; //Fr die Berechnung, wo der Ball ist.
+	//Aussehen
+	Personality personality{ CALM };
+	Intelligence intelligence{ PLAYER };
 
-	//K.I.
-	Personality personality;
-	Intelligence intelligence;
-	bool lost_last_round{false};
-	
-	//Timer
-	double difficulty = 1.0;
-	double t_start = 0.0, t_react = 0.0, t_react_multiplier = 1.0;
+	Colour colour() const
+	{
+		if (intelligence == PLAYER)
+			return { 0.9f,0.9f,0.9f };
+
+		switch (personality)
+		{
+		case AGGRESSIVE:
+			return { 0.9f,0.0f,0.0f };
+
+		case STRATEGIC:
+			return { 0.0f,0.0f,0.9f };
+
+		default:
+			return { 0.0f,0.9f,0.0f };
+		}
+	}
 
 	//Shader
 	float x_draw, y_draw;
-	const Scale_2D size{ 0.05f , 4.5f * 0.05f };
+	const Scale_2D size{ Sim_Schlaeger::width, Sim_Schlaeger::height };
 	Shader_Square shader{};
 };
 
+//Ball, wie er gezeichnet wird, mit den Sounds. Die Physik ist in Sim_Ball (Pong_Simulation.h).
 class Obj_Ball
 {
 public:
@@ -386,6 +269,7 @@ public:
 		{
 			shader.load();
 			shader.change_size(shape);
+			shader.change_colour(colour);
 			sfx_playerhit.load();
 			sfx_opponenthit.load();
 			sfx_upperedgehit.load();
@@ -394,83 +278,29 @@ public:
 		}
 	}
 
-	//Resette alle Variablen ausser v_x
-	void soft_reset()
-	{
-		//Warte 0.5 Sekunden lang und starte dann den Ball neu
-		if (pause(1.0))
-		{
-			x = x_start;
-			y = y_start;
-			x_old = x_start;
-			y_old = y_start;
-			x_draw = static_cast<float>(x_start);
-			y_draw = static_cast<float>(y_start);
-			v_y = -v_start / sqrt(2.0);
-		}
-		else
-		{
-			//Bewege in der Zwischenzeit den Ball ausserhalb des Bildschirms
-			x = 0.0;
-			x_old = 0.0;
-			y = 2.0;
-			y_old = 2.0;
-			v_y = 0.0;
-		}
-	}
-
-	//Resette alle Variablen auf die Startwerte
-	void reset()
+	//bernimm die Position aus der Simulation.
+	void update_state(const Sim_Ball& sim)
 	{
-		soft_reset();
-		v_x = -v_start / sqrt(2.0);
+		x = sim.x;
+		y = sim.y;
+		x_old = sim.x_old;
+		y_old = sim.y_old;
 	}
 
-	void check_collision_schlaeger(const Obj_Schlaeger& schlaeger)
+	//Spiele die Sounds zu den Sim_Event eines Ticks ab.
+	void play_sounds(unsigned events, Intelligence left, Intelligence right)
 	{
-		const double damping{ 0.5 }; //Um wie viel der Ball die Geschwindigkeit vom Schlger bernimmt.
-		const double off{ 0.01 };	 //Es fhlt sich besser an, wenn der Ball im Schlger etwas versinkt.
-
-		//Teste, ob eine Kollsion von links oder rechts erfolgt.
-		bool coll_y{ (y - 0.5*shape.height) <= (schlaeger.y + 0.5 * schlaeger.size.height) && (y + 0.5*shape.height) >= (schlaeger.y - 0.5 * schlaeger.size.height) };	//Ball und Schlger sind auf gleicher Hhe.
-		bool coll_right{ (x - 0.5*shape.width + off) <= (schlaeger.x + 0.5 * schlaeger.size.width) && (x - 0.5*shape.width + off) >= schlaeger.x && v_x < 0.0 };	//Kollsion rechts.
-		bool coll_left{ (x + 0.5*shape.width - off) >= (schlaeger.x - 0.5 * schlaeger.size.width) && (x + 0.5*shape.width - off) <= schlaeger.x && v_x > 0.0 };	//Kollision links.
-
-		//Teste, ob eine Kollsion von oben oder unten erfolgt.
-		bool coll_x{ (x - 0.5*shape.width) <= (schlaeger.x + 0.5 * schlaeger.size.width) && (x + 0.5*shape.width) >= (schlaeger.x - 0.5 * schlaeger.size.width) };		//Ball und Schlger sind bereinander.
-		bool coll_up{ (y - 0.5*shape.height + off) <= (schlaeger.y + 0.5 * schlaeger.size.height) && (y - 0.5*shape.height + off) >= schlaeger.y && v_y < 0.0 };		//Kollision oben.
-		bool coll_down{ (y + shape.height - off) >= (schlaeger.y - 0.5 * schlaeger.size.height) && (y + 0.5*shape.height - off) <= schlaeger.y && v_y > 0.0 };	//Kollision unten.
+		if (events & EVENT_EDGE_DOWN)
+			sfx_loweredgehit.play();
+		else if (events & EVENT_EDGE_UP)
+			sfx_upperedgehit.play();
 
-		//Falls es zu einer horizontalen Kollision kommt.
-		if (coll_y && (coll_left || coll_right))
-		{
-			v_x = -v_x;
-			//Falls v_max nicht berschritten wird, erhhe v_y anhand der Geschwindigkeit des Schlgers.
-			if (std::pow(v_x, 2) + std::pow(v_y, 2) <= std::pow(v_max, 2))
-				v_y += damping * schlaeger.v_y;
-			//std::cout << "Ball: Empfange Geschwindigkeit: " << schlaeger.v_y << '\n';
-
-			//Spiele den Sound ab
-			if (schlaeger.intelligence == PLAYER)
-				sfx_playerhit.play();
-			else
-				sfx_opponenthit.play();
-		}
-		//Falls nicht, teste ob eine Kollision von oben oder unten erfolgt.
-		else if (coll_x && (coll_up || coll_down))
-		{
-			v_y = -v_y;
-			//Spiele den Sound ab
-			if (schlaeger.intelligence == PLAYER)
-				sfx_playerhit.play();
-			else
-				sfx_opponenthit.play();
-		}
+		if (events & EVENT_HIT_LEFT)
+			(left == PLAYER ? sfx_playerhit : sfx_opponenthit).play();
+		if (events & EVENT_HIT_RIGHT)
+			(right == PLAYER ? sfx_playerhit : sfx_opponenthit).play();
 	}
 
-	void update_physics(double dt, Obj_Schlaeger& player, Obj_Schlaeger& opponent, Obj_ScoreBoard& score_board,
-		Obj_Portrait& portrait_left, Obj_Portrait& portrait_right);
-
 	void update_graphics(double alpha = 1.0)
 	{
 		x_draw = static_cast<float>(alpha * x + (1.0 - alpha) * x_old);
@@ -483,27 +313,14 @@ public:
 		shader.draw();
 	}
 
-	//Warte t Sekunden lang.
-	bool pause(double t)
+	//Setze den Ball direkt auf eine Position, z.B. beim Abspielen eines Replays.
+	void move_to(double x_new, double y_new)
 	{
-		static bool timer_start{ true };
-		static double t0;
-
-		//Beginne den Timer
-		if (timer_start == true)
-		{
-			t0 = Game::clock.get_time();
-			timer_start = false;
-			return false;
-		}
-		//Falls die Zeit vorbei ist
-		else if (Game::clock.get_time() - t0 > t)
-		{
-			timer_start = true;
-			return true;
-		}
-		else
-			return false;
+		x_old = x_new;
+		y_old = y_new;
+		x = x_new;
+		y = y_new;
+		update_graphics();
 	}
 
 	void unload()
@@ -524,8 +341,6 @@ public:
 		unload();
 	}
 
-	friend class Obj_Schlaeger;
-
 private:
 	bool loaded{ false };
 
@@ -536,17 +351,12 @@ private:
 	Sound_Effect sfx_upperedgehit{ "Sound_Effects\\Pong_Sound_03.mp3", volume };
 	Sound_Effect sfx_loweredgehit{ "Sound_Effects\\Pong_Sound_04.mp3", volume };
 
-	//Physik-Variablen
-	const double x_start{0.0}, y_start{1.0 - Obj_Edge::level_border};
-	double x{x_start}, y{y_start}, x_old{x_start}, y_old{y_start};
-	static constexpr double v_start{ 1.0 };
-	double v_x{ - (1.0 / sqrt(2.0)) * v_start }, v_y{ - (1.0/sqrt(2.0)) * v_start };
-	const double v_max{ 3.0 * v_start };
+	double x{ Sim_Ball::x_start }, y{ Sim_Ball::y_start }, x_old{ Sim_Ball::x_start }, y_old{ Sim_Ball::y_start };
 
 	//Shader
-	float x_draw{ (float)x_start }, y_draw{ (float)y_start };
-	const float radius = 0.02f;
-	const Scale_2D shape{2.0f*radius,2.0f*radius};
+	float x_draw{ (float)x }, y_draw{ (float)y };
+	const Scale_2D shape{ Sim_Ball::width, Sim_Ball::height };
+	const Colour colour{ 0.9f, 0.9f, 0.9f };
 	Shader_Square shader{};
 };
 
@@ -567,38 +377,35 @@ public:
 		}
 	}
 
-	void update_score(bool player_win)
+	void reset_score()
 	{
-		//Update den Punktestand
-		if (player_win)
-			score_left += 1;
-		else
-			score_right += 1;
-
-		//Update den Punktestand im Text
-		std::stringstream new_score;
-		new_score << score_left << ' ' << score_right;
-		txt_score.change_text(new_score.str());
+		score_left = 0;
+		score_right = 0;
+		txt_score.change_text("0 0");
+		txt_score.centre_text_horizontally();
+		text_length = 3;
+	}
 
-		//Rezentriere den Text, falls der Punktestand ein Vielfaches von 10 ist
-		if ((score_left != 0 && score_left % 10 == 0) || (score_right != 0 && score_right % 10 == 0))
+	//bernimm den Punktestand, z.B. aus der Simulation oder einem Replay.
+	void set_score(int left, int right)
+	{
+		if (left != score_left || right != score_right)
 		{
-			if (!text_recentred)
+			score_left = left;
+			score_right = right;
+
+			//Update den Punktestand im Text
+			std::stringstream new_score;
+			new_score << score_left << ' ' << score_right;
+			txt_score.change_text(new_score.str());
+
+			//Rezentriere den Text, falls sich die Anzahl Ziffern gendert hat
+			if (new_score.str().size() != text_length)
 			{
 				txt_score.centre_text_horizontally();
-				text_recentred = true;
+				text_length = new_score.str().size();
 			}
 		}
-		else
-			text_recentred = false;
-	}
-
-	void reset_score()
-	{
-		score_left = 0;
-		score_right = 0;
-		txt_score.change_text("0 0");
-		txt_score.centre_text_horizontally();
 	}
 
 	void draw()
@@ -623,7 +430,8 @@ public:
 	int score_left{ 0 }, score_right{ 0 };
 
 private:
-	bool loaded{ false }, text_recentred{true};
+	bool loaded{ false };
+	std::size_t text_length{ 3 };
 	Text_Bitmap txt_score{"0 0",0.0f,0.55f,0.1f,Colour_List::white};
 };
 
@@ -734,255 +542,4 @@ private:
 	float y_texture{ 3.0f / texture_height };
 	Scale_2D shape{ 0.15625f, 0.15625f }; //Grsse, damit das Fenster 200px x 200 px gross ist.
 	Shader_Portrait shader{};
-};
-
-//Funktionen, die andere Objekte bentigen
-double Obj_Schlaeger::set_reaction_time(double multiplier)
-{
-	const double speed_ratio = abs( Obj_Ball::v_start / (std::sqrt(2.0) * v_max) );
-
-	//Vertical Distance Schlaeger to Edge
-	const double distance_zero_to_edge = 1.0 - Obj_Edge::level_border - 0.5 * size.height;
-	const double distance_edge_to_edge = 2.0 - 2.0*Obj_Edge::level_border - size.height;
-
-	//Horizontal Distance Ball to Schlaeger
-	const double distance_ball_to_self = speed_ratio * distance_zero_to_edge;
-	const double distance_ball_from_opponent = 2.0 * abs(x) - size.width - distance_ball_to_self;
-
-	//Maximal erlaubte Distanz fr t_react_min
-	const double max_distance_ball_to_self = speed_ratio * distance_edge_to_edge;
-	const double max_distance_ball_from_opponent = 2.0 * abs(x) - size.width - max_distance_ball_to_self;
-
-	//Minimal erlaubte Distanz fr t_react_max
-	const double min_distance_ball_to_self = 0.2;
-	const double min_distance_ball_from_opponent = 2.0 * abs(x) - size.width - min_distance_ball_to_self;
-
-	//Reaktionszeit
-	t_react_multiplier = multiplier;
-	t_react = distance_ball_from_opponent / (Obj_Ball::v_start / std::sqrt(2.0));
-	const double t_react_min = max_distance_ball_from_opponent / (Obj_Ball::v_start / std::sqrt(2.0));
-	const double t_react_max = min_distance_ball_from_opponent / (Obj_Ball::v_start / std::sqrt(2.0));
-
-	t_react = multiplier * t_react;
-	if (t_react <= t_react_min)
-		t_react = t_react_min;
-	else if (t_react >= t_react_max)
-		t_react = t_react_max;
-
-	return t_react;
-}
-
-double Obj_Schlaeger::determine_Ball_path(const Obj_Ball& ball)
-{
-	using namespace Game;
-	double x_Ball = ball.x, y_Ball = ball.y, v_Ball = ball.v_y;
-
-	while (abs(x_Ball) < abs(x - 0.5 * (double)size.width) )
-	{
-		x_Ball += ball.v_x * dt;
-
-		bool collision_up = (y_Ball + 0.5 * ball.shape.height >= 1.0 - Obj_Edge::level_border) && v_Ball > 0.0;
-		bool collision_down = (y_Ball - 0.5 * ball.shape.height <= -1.0 + Obj_Edge::level_border) && v_Ball < 0.0;
-
-		if (collision_down || collision_up)
-			v_Ball = -1.0 * v_Ball;
-
-		y_Ball += v_Ball * dt;
-	}
-	return y_Ball;
-}
-
-void Obj_Schlaeger::move_to_Ball(const Obj_Ball& ball)
-{
-	//Bewege dich direkt zum Ball hin.
-	if (abs(x - ball.x) > 0.01 + 0.5 * size.width)
-	{
-		//Bewege dich direkt zum Ball hin.
-		if(intelligence == DUMB)
-		{
-			y_ball = ball.y;
-		}
-
-		if (y + 0.3 * size.height < y_ball)
-		{
-			v_y = v_max;
-		}
-		else if (y - 0.3 * size.height > y_ball)
-		{
-			v_y = -v_max;
-		}
-		else
-		{
-			v_y = 0.0;
-		}
-	}
-	//Beschleunige oder verlangsame den Ball, je nach Persnlichkeit
-	else
-	{
-		double sign = ball.v_y / abs(ball.v_y);
-		switch (personality)
-		{
-		case CALM:
-			v_y = -1.0 * sign * v_max;
-			break;
-
-		case AGGRESSIVE:
-			v_y = sign * v_max;
-			break;
-
-		case STRATEGIC:
-			double v_middle = (ball.v_max + ball.v_start) / 2.0;
-			if (ball.v_y > v_middle)
-				v_y = -1.0 * sign * v_max;
-			else
-				v_y = sign * v_max;
-			break;
-		}
-	}
-}
-
-void Obj_Schlaeger::react_to_Ball(const Obj_Ball& ball)
-{
-	//Am Start der Runde, wenn der Ball ausserhalb des Bildschirms ist
-	if (abs(ball.y) >= 1.0)
-	{
-		//Setzte temporr die Reaktionszeit auf 0.5, damit am Start der Runde der Schlger den Ball erwischt.
-		if (lost_last_round)
-			t_react = 0.5;
-
-		switch (personality)
-		{
-		case CALM:
-			v_y = 0.0;
-			break;
-
-		case AGGRESSIVE:
-			wiggle(4.0 * v_max, 0.2);
-			break;
-
-		case STRATEGIC:
-			move_to_centre();
-			break;
-		}
-	}
-	//Falls sich der Ball zum Schlger hin bewegt
-	else if ((ball.x < x && ball.v_x > 0.0) || (ball.x > x && ball.v_x < 0.0))
-	{
-		if (t_start == 0.0)
-		{
-			if(intelligence == SMART)
-				y_ball = determine_Ball_path(ball);
-			t_start = Game::clock.get_time();
-		}
-		else if (Game::clock.get_time() - t_start >= t_react)
-		{
-			//std::cout << "Going after the ball!\n";
-			move_to_Ball(ball);
-		}
-		else
-		{
-			switch (personality)
-			{
-			case CALM:
-				v_y = 0.0;
-				break;
-
-			case AGGRESSIVE:
-				wiggle(v_max, 0.5);
-				break;
-
-			case STRATEGIC:
-				move_to_centre();
-				break;
-			}
-		}
-	}
-	else
-	{
-		t_start = 0.0;
-		if (lost_last_round)
-		{
-			t_react = set_reaction_time(t_react_multiplier);
-			lost_last_round = false;
-		}
-		//Was der Schlger tut, wenn der Ball nicht zu ihm geht.
-		switch (personality)
-		{
-		case CALM:
-			v_y = 0.0;
-			break;
-
-		case AGGRESSIVE:
-			wiggle(v_max, 0.5);
-			break;
-
-		case STRATEGIC:
-			move_to_centre();
-			break;
-		}
-	}
-}
-
-void Obj_Ball::update_physics(double dt, Obj_Schlaeger& player, Obj_Schlaeger& opponent, Obj_ScoreBoard& score_board, 
-	Obj_Portrait &portrait_left, Obj_Portrait &portrait_right)
-{
-	x_old = x;
-	y_old = y;
-
-	static bool changed_to_neutral{ true };
-
-	//Kollision oberer oder unterer Rand
-	bool collision_up = (y + 0.5 * shape.height >= 1.0 - Obj_Edge::level_border) && v_y > 0.0;
-	bool collision_down = (y - 0.5 * shape.height <= -1.0 + Obj_Edge::level_border) && v_y < 0.0;
-
-	if (collision_down || collision_up)
-	{
-		v_y = -v_y;
-		if (collision_down)
-			sfx_loweredgehit.play();
-		else if (collision_up)
-			sfx_upperedgehit.play();
-	}
-
-	//Falls der Ball aus dem Bildschirm herausfliegt oder die horizontale Geschwindigkeit 0 ist.
-	if (abs(x) >= 1.0 || abs(y) >= 1.0 || v_x == 0)
-	{
-		//Linker Rand
-		if (x <= -1.0)
-		{
-			score_board.update_score(0);
-			opponent.lost_last_round = false;
-			portrait_right.change_to_happy();
-			player.lost_last_round = true;
-			portrait_left.change_to_sad();
-		}
-		//Rechter Rand
-		else if (x >= 1.0)
-		{
-			score_board.update_score(1);
-			player.lost_last_round = false;
-			portrait_left.change_to_happy();
-			opponent.lost_last_round = true;
-			if(opponent.get_personality() == AGGRESSIVE)
-				portrait_right.change_to_angry();
-			else
-				portrait_right.change_to_sad();
-		}
-		changed_to_neutral = false;
-		soft_reset();
-	}
-	else if(!changed_to_neutral)
-	{
-		portrait_left.change_to_neutral();
-		portrait_right.change_to_neutral();
-		changed_to_neutral = true;
-	}
-
-	//Kollision Schlger
-	check_collision_schlaeger(player);
-	check_collision_schlaeger(opponent);
-
-
-	x += v_x * dt;
-	y += v_y * dt;
-}
\ No newline at end of file
+};
\ No newline at end of file
@@ -0,0 +1,399 @@
+#pragma once
+
+//Matchmaking fr den dedizierten Server, ohne SDL oder OpenGL.
+//Wartende Clients kommen nach Rating und Latenz in Buckets. In jedem Bucket liegen sie in einem Heap nach Ankunftszeit,
+//so dass immer die am lngsten Wartenden zuerst ein Match bekommen. Wer lange wartet, darf auch gegen Clients aus
+//benachbarten Buckets spielen. Einfgen, Paaren und Entfernen nach einem Timeout kosten je O(log n).
+
+#include "Pong_Network.h"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+
+//Ein Client meldet sich mit einer zuflligen Nonce an. Adresse und Nonce bestimmen ihn eindeutig.
+struct Join_Key
+{
+	uint32_t address{ 0 };
+	uint16_t port{ 0 };
+	uint32_t nonce{ 0 };
+
+	Join_Key() {}
+	Join_Key(const UDP_Address& from, uint32_t client_nonce) : address{ from.addr.sin_addr.s_addr }, port{ from.addr.sin_port }, nonce{ client_nonce } {}
+
+	bool operator==(const Join_Key& other) const
+	{
+		return address == other.address && port == other.port && nonce == other.nonce;
+	}
+};
+
+struct Join_Key_Hash
+{
+	std::size_t operator()(const Join_Key& key) const
+	{
+		uint64_t h{ (static_cast<uint64_t>(key.address) << 16 | key.port) * 0x9E3779B97F4A7C15ull };
+		return static_cast<std::size_t>(h ^ (static_cast<uint64_t>(key.nonce) * 0xC2B2AE3D27D4EB4Full));
+	}
+};
+
+//Binrer Heap ber Ids, der die Position jeder Id kennt. Damit kann nicht nur die Spitze, sondern jede Id in O(log n)
+//entfernt oder nach einer nderung ihrer Prioritt neu eingeordnet werden.
+//Die Positionen liegen in einem Vektor ausserhalb, so dass sich viele Heaps mit disjunkten Ids einen Vektor teilen.
+//Before(a, b) ist true, wenn a vor b an der Reihe ist.
+template<typename Before>
+class Indexed_Heap
+{
+public:
+	Indexed_Heap(std::vector<uint32_t>* position_storage, Before order) : positions{ position_storage }, before{ order } {}
+
+	bool empty() const
+	{
+		return heap.empty();
+	}
+
+	std::size_t size() const
+	{
+		return heap.size();
+	}
+
+	uint32_t top() const
+	{
+		return heap.front();
+	}
+
+	void push(uint32_t id)
+	{
+		heap.push_back(id);
+		(*positions)[id] = static_cast<uint32_t>(heap.size() - 1);
+		sift_up(heap.size() - 1);
+	}
+
+	uint32_t pop()
+	{
+		const uint32_t id{ heap.front() };
+		erase(id);
+		return id;
+	}
+
+	void erase(uint32_t id)
+	{
+		const std::size_t position{ (*positions)[id] };
+		const uint32_t last{ heap.back() };
+		heap.pop_back();
+		if (position < heap.size())
+		{
+			heap[position] = last;
+			(*positions)[last] = static_cast<uint32_t>(position);
+			sift_up(position);
+			sift_down((*positions)[last]);
+		}
+	}
+
+	//Nach einer nderung der Prioritt von id aufrufen.
+	void update(uint32_t id)
+	{
+		const std::size_t position{ (*positions)[id] };
+		sift_up(position);
+		sift_down((*positions)[id]);
+	}
+
+private:
+	std::vector<uint32_t> heap;
+	std::vector<uint32_t>* positions{ nullptr };
+	Before before;
+
+	void place(std::size_t position, uint32_t id)
+	{
+		heap[position] = id;
+		(*positions)[id] = static_cast<uint32_t>(position);
+	}
+
+	void sift_up(std::size_t position)
+	{
+		const uint32_t id{ heap[position] };
+		while (position > 0)
+		{
+			const std::size_t parent{ (position - 1) / 2 };
+			if (!before(id, heap[parent]))
+				break;
+			place(position, heap[parent]);
+			position = parent;
+		}
+		place(position, id);
+	}
+
+	void sift_down(std::size_t position)
+	{
+		const uint32_t id{ heap[position] };
+		while (true)
+		{
+			std::size_t child{ 2 * position + 1 };
+			if (child >= heap.size())
+				break;
+			if (child + 1 < heap.size() && before(heap[child + 1], heap[child]))
+				child++;
+			if (!before(heap[child], id))
+				break;
+			place(position, heap[child]);
+			position = child;
+		}
+		place(position, id);
+	}
+};
+
+struct Matchmaking_Config
+{
+	int rating_bucket{ 100 };			//Breite eines Rating-Buckets.
+	int max_rating{ 3000 };				//Hhere Ratings kommen in den obersten Bucket.
+	double widen_interval{ 2.0 };		//Pro so viele Sekunden Wartezeit darf der Gegner einen Rating-Bucket weiter weg sein...
+	int max_widen{ 5 };					//...aber hchstens so viele Buckets.
+	double latency_widen{ 5.0 };		//Ab dieser Wartezeit auch Gegner aus dem benachbarten Latenz-Bucket.
+	double timeout{ 5.0 };				//Sekunden ohne JOIN, bis ein wartender Client entfernt wird.
+};
+
+class Matchmaker
+{
+public:
+	static constexpr int latency_buckets{ 6 };
+	static constexpr uint16_t latency_limits[latency_buckets - 1]{ 30, 60, 100, 150, 250 };	//Obergrenzen in ms.
+
+	struct Player
+	{
+		UDP_Address address{};
+		uint32_t nonce{ 0 };
+		uint16_t rating{ 0 }, latency{ 0 };	//Latenz zum Server in ms, vom Client gemessen.
+	};
+
+	struct Pair
+	{
+		Player players[2]{};
+		double wait[2]{};
+	};
+
+	//Seit dem letzten reset_statistics()
+	struct Statistics
+	{
+		uint64_t enqueued{ 0 }, paired{ 0 }, widened{ 0 }, timed_out{ 0 };	//paired und widened zhlen Paare.
+		double wait_sum{ 0.0 }, wait_max{ 0.0 }, rating_difference_sum{ 0.0 };
+	};
+
+	Matchmaker(const Matchmaking_Config& new_config = Matchmaking_Config{}) : expiry{ &expiry_positions, By_Last_Seen{ &tickets } }
+	{
+		configure(new_config);
+	}
+
+	//Die Heaps zeigen auf tickets: Nicht kopieren.
+	Matchmaker(const Matchmaker&) = delete;
+	Matchmaker& operator=(const Matchmaker&) = delete;
+
+	//Nur aufrufen, solange niemand wartet.
+	void configure(const Matchmaking_Config& new_config)
+	{
+		config = new_config;
+		config.rating_bucket = std::max(1, config.rating_bucket);
+		config.max_rating = std::max(0, config.max_rating);
+		n_rating_buckets = config.max_rating / config.rating_bucket + 1;
+		buckets.clear();
+		for (int i{ 0 }; i < n_rating_buckets * latency_buckets; i++)
+			buckets.emplace_back(&bucket_positions, By_Enqueued{ &tickets });
+	}
+
+	static int latency_bucket(uint16_t latency)
+	{
+		int bucket{ 0 };
+		while (bucket < latency_buckets - 1 && latency > latency_limits[bucket])
+			bucket++;
+		return bucket;
+	}
+
+	int rating_bucket(uint16_t rating) const
+	{
+		return std::min<int>(rating, config.max_rating) / config.rating_bucket;
+	}
+
+	//Ein Client will spielen (now in Sekunden). Wartet er schon, gilt das JOIN nur als Lebenszeichen.
+	void enqueue(const Player& player, double now)
+	{
+		auto inserted{ waiting.try_emplace(Join_Key{ player.address, player.nonce }, 0) };
+		if (!inserted.second)
+		{
+			tickets[inserted.first->second].last_seen = now;
+			expiry.update(inserted.first->second);
+			return;
+		}
+
+		uint32_t id;
+		if (!free_ids.empty())
+		{
+			id = free_ids.back();
+			free_ids.pop_back();
+		}
+		else
+		{
+			id = static_cast<uint32_t>(tickets.size());
+			tickets.emplace_back();
+			bucket_positions.push_back(0);
+			expiry_positions.push_back(0);
+		}
+		inserted.first->second = id;
+
+		Ticket& ticket{ tickets[id] };
+		ticket.player = player;
+		ticket.enqueued = now;
+		ticket.last_seen = now;
+		ticket.bucket = rating_bucket(player.rating) * latency_buckets + latency_bucket(player.latency);
+		buckets[ticket.bucket].push(id);
+		expiry.push(id);
+		statistics.enqueued++;
+	}
+
+	//Entfernt Clients ohne Lebenszeichen und hngt alle neuen Paare an pairs an. Regelmssig aufrufen, zum Beispiel 10 Mal
+	//pro Sekunde: Je seltener, desto mehr Clients liegen im selben Bucket und desto besser passen die Paare.
+	void match(double now, std::vector<Pair>& pairs)
+	{
+		while (!expiry.empty() && now - tickets[expiry.top()].last_seen > config.timeout)
+		{
+			remove(expiry.top());
+			statistics.timed_out++;
+		}
+
+		//Zuerst innerhalb der Buckets, die am lngsten Wartenden zuerst.
+		for (auto& bucket : buckets)
+		{
+			while (bucket.size() >= 2)
+			{
+				const uint32_t a{ bucket.pop() };
+				pairs.push_back(make_pair(a, bucket.pop(), now));
+			}
+		}
+
+		//Danach ist in jedem Bucket hchstens noch einer. Wer lange genug wartet, bekommt den nchsten aus den Nachbarn.
+		for (int b{ 0 }; b < static_cast<int>(buckets.size()); b++)
+		{
+			if (buckets[b].empty())
+				continue;
+			const uint32_t id{ buckets[b].top() };
+			const double wait{ now - tickets[id].enqueued };
+			const int widen{ std::min(config.max_widen, static_cast<int>(wait / config.widen_interval)) };
+			const int widen_latency{ wait >= config.latency_widen ? 1 : 0 };
+			if (widen == 0 && widen_latency == 0)
+				continue;
+
+			const int rating{ b / latency_buckets }, latency{ b % latency_buckets };
+			int best{ -1 }, best_distance{ 0 };
+			for (int r{ std::max(0, rating - widen) }; r <= std::min(n_rating_buckets - 1, rating + widen); r++)
+			{
+				for (int l{ std::max(0, latency - widen_latency) }; l <= std::min(latency_buckets - 1, latency + widen_latency); l++)
+				{
+					const int other{ r * latency_buckets + l };
+					if (other == b || buckets[other].empty())
+						continue;
+					const int distance{ std::abs(r - rating) + std::abs(l - latency) };
+					if (best < 0 || distance < best_distance ||
+						(distance == best_distance && tickets[buckets[other].top()].enqueued < tickets[buckets[best].top()].enqueued))
+					{
+						best = other;
+						best_distance = distance;
+					}
+				}
+			}
+			if (best >= 0)
+			{
+				buckets[b].pop();
+				pairs.push_back(make_pair(id, buckets[best].pop(), now));
+				statistics.widened++;
+			}
+		}
+	}
+
+	//Anzahl wartende Clients
+	std::size_t size() const
+	{
+		return waiting.size();
+	}
+
+	const Statistics& get_statistics() const
+	{
+		return statistics;
+	}
+
+	void reset_statistics()
+	{
+		statistics = Statistics{};
+	}
+
+private:
+	struct Ticket
+	{
+		Player player{};
+		double enqueued{ 0.0 }, last_seen{ 0.0 };
+		int bucket{ 0 };
+	};
+
+	struct By_Enqueued
+	{
+		const std::vector<Ticket>* tickets{ nullptr };
+
+		bool operator()(uint32_t a, uint32_t b) const
+		{
+			const double ta{ (*tickets)[a].enqueued }, tb{ (*tickets)[b].enqueued };
+			return ta < tb || (ta == tb && a < b);
+		}
+	};
+
+	struct By_Last_Seen
+	{
+		const std::vector<Ticket>* tickets{ nullptr };
+
+		bool operator()(uint32_t a, uint32_t b) const
+		{
+			const double ta{ (*tickets)[a].last_seen }, tb{ (*tickets)[b].last_seen };
+			return ta < tb || (ta == tb && a < b);
+		}
+	};
+
+	Matchmaking_Config config{};
+	int n_rating_buckets{ 0 };
+
+	//Die Heaps speichern nur Ids in tickets. Jede Id liegt in genau einem Bucket und im Heap fr die Timeouts.
+	std::vector<Ticket> tickets;
+	std::vector<uint32_t> free_ids, bucket_positions, expiry_positions;
+	std::vector<Indexed_Heap<By_Enqueued>> buckets;
+	Indexed_Heap<By_Last_Seen> expiry;
+	std::unordered_map<Join_Key, uint32_t, Join_Key_Hash> waiting;
+	Statistics statistics{};
+
+	void remove(uint32_t id)
+	{
+		buckets[tickets[id].bucket].erase(id);
+		release(id);
+	}
+
+	//Fr Tickets, die schon aus ihrem Bucket genommen wurden.
+	void release(uint32_t id)
+	{
+		const Ticket& ticket{ tickets[id] };
+		expiry.erase(id);
+		waiting.erase(Join_Key{ ticket.player.address, ticket.player.nonce });
+		free_ids.push_back(id);
+	}
+
+	//a und b sind schon aus ihren Buckets genommen.
+	Pair make_pair(uint32_t a, uint32_t b, double now)
+	{
+		Pair pair{};
+		const uint32_t ids[2]{ a, b };
+		for (int i{ 0 }; i < 2; i++)
+		{
+			pair.players[i] = tickets[ids[i]].player;
+			pair.wait[i] = now - tickets[ids[i]].enqueued;
+			statistics.wait_sum += pair.wait[i];
+			statistics.wait_max = std::max(statistics.wait_max, pair.wait[i]);
+			release(ids[i]);
+		}
+		statistics.paired++;
+		statistics.rating_difference_sum += std::abs(static_cast<int>(pair.players[0].rating) - static_cast<int>(pair.players[1].rating));
+		return pair;
+	}
+};
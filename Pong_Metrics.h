@@ -0,0 +1,326 @@
+#pragma once
+
+//Metriken des dedizierten Servers im Textformat von Prometheus, ber HTTP auf 127.0.0.1.
+//Jeder Thread schreibt nur in seine eigenen Zhler und Histogramme, ohne Lock und ohne atomare Read-Modify-Write-Befehle.
+//Erst beim Abfragen liest der Koordinator alle zusammen.
+//Nur fr Linux (epoll).
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace Metrics
+{
+	//Fr Zhler mit nur einem schreibenden Thread: Andere Threads drfen jederzeit lesen.
+	inline void increment(std::atomic<uint64_t>& counter, uint64_t n = 1)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+}
+
+//Histogramm fr Zeiten in Sekunden, mit festen Grenzen von 1 us bis 131 ms (jede doppelt so gross wie die vorige).
+//Nur ein Thread darf observe() aufrufen, lesen drfen alle.
+class Histogram
+{
+public:
+	static constexpr int n_bounds{ 18 };
+	static constexpr double bounds[n_bounds]{ 1e-6, 2e-6, 4e-6, 8e-6, 16e-6, 32e-6, 64e-6, 128e-6, 256e-6, 512e-6,
+		1.024e-3, 2.048e-3, 4.096e-3, 8.192e-3, 16.384e-3, 32.768e-3, 65.536e-3, 131.072e-3 };
+
+	//Kopie der Zhler, auch von mehreren Histogrammen zusammengezhlt.
+	struct Counts
+	{
+		uint64_t buckets[n_bounds + 1]{};	//Der letzte Bucket ist alles ber der grssten Grenze.
+		double sum{ 0.0 };
+
+		void add(const Histogram& histogram)
+		{
+			for (int i{ 0 }; i <= n_bounds; i++)
+				buckets[i] += histogram.buckets[i].load(std::memory_order_relaxed);
+			sum += histogram.sum.load(std::memory_order_relaxed);
+		}
+	};
+
+	void observe(double seconds)
+	{
+		int i{ 0 };
+		while (i < n_bounds && seconds > bounds[i])
+			i++;
+		Metrics::increment(buckets[i]);
+		sum.store(sum.load(std::memory_order_relaxed) + seconds, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> buckets[n_bounds + 1]{};
+	std::atomic<double> sum{ 0.0 };
+};
+
+//Zhlt die Aufrufe von operator new pro Thread. Gezhlt wird nur, wenn das Programm operator new ersetzt und count()
+//aufruft (siehe Pong_Server.cpp). Threads ohne register_thread() teilen sich Platz 0.
+namespace Allocation_Counter
+{
+	constexpr int max_slots{ 128 };
+
+	struct alignas(64) Slot
+	{
+		std::atomic<uint64_t> allocations{ 0 }, bytes{ 0 };
+	};
+
+	inline Slot slots[max_slots]{};
+	inline thread_local Slot* current{ &slots[0] };
+
+	inline void register_thread(int slot)
+	{
+		if (slot > 0 && slot < max_slots)
+			current = &slots[slot];
+	}
+
+	//Platz 0 wird von mehreren Threads geteilt, daher fetch_add. Die anderen Pltze sind so nie umkmpft.
+	inline void count(std::size_t size)
+	{
+		current->allocations.fetch_add(1, std::memory_order_relaxed);
+		current->bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+}
+
+//Schreibt Metriken im Textformat von Prometheus (Version 0.0.4).
+class Metrics_Text
+{
+public:
+	explicit Metrics_Text(std::string& output) : out{ output } {}
+
+	//Einmal pro Metrik, vor ihren Werten. type: counter, gauge oder histogram.
+	void family(const char* name, const char* type, const char* help)
+	{
+		out += "# HELP ";
+		out += name;
+		out += ' ';
+		out += help;
+		out += "\n# TYPE ";
+		out += name;
+		out += ' ';
+		out += type;
+		out += '\n';
+	}
+
+	//labels ohne Klammern, zum Beispiel shard="0". Leer fr keine.
+	void sample(const char* name, const std::string& labels, double value)
+	{
+		out += name;
+		if (!labels.empty())
+		{
+			out += '{';
+			out += labels;
+			out += '}';
+		}
+		out += ' ';
+		append_number(value);
+		out += '\n';
+	}
+
+	void histogram(const char* name, const std::string& labels, const Histogram::Counts& counts)
+	{
+		const std::string prefix{ labels.empty() ? std::string{} : labels + "," };
+		std::string series{ name };
+		uint64_t cumulative{ 0 };
+		char bound[32];
+		for (int i{ 0 }; i <= Histogram::n_bounds; i++)
+		{
+			cumulative += counts.buckets[i];
+			if (i < Histogram::n_bounds)
+				snprintf(bound, sizeof(bound), "%g", Histogram::bounds[i]);
+			else
+				snprintf(bound, sizeof(bound), "+Inf");
+			sample((series + "_bucket").c_str(), prefix + "le=\"" + bound + "\"", static_cast<double>(cumulative));
+		}
+		sample((series + "_sum").c_str(), labels, counts.sum);
+		sample((series + "_count").c_str(), labels, static_cast<double>(cumulative));
+	}
+
+private:
+	std::string& out;
+
+	void append_number(double value)
+	{
+		char text[32];
+		snprintf(text, sizeof(text), "%.12g", value);
+		out += text;
+	}
+};
+
+//Minimaler HTTP-Server nur fr GET /metrics auf 127.0.0.1. Luft im Thread des Aufrufers:
+//native_handle() ist ein epoll-Handle, das in die eigene epoll-Schleife kommt. Ist es lesbar, poll() aufrufen.
+class Metrics_Server
+{
+public:
+	Metrics_Server() {}
+
+	bool open(uint16_t port)
+	{
+		listen_handle = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		const int yes{ 1 };
+		setsockopt(listen_handle, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+		if (listen_handle < 0 || bind(listen_handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || listen(listen_handle, 16) < 0)
+		{
+			std::cerr << "Error: Could not listen for metrics on 127.0.0.1:" << port << "!\n";
+			return false;
+		}
+
+		epoll_handle = epoll_create1(0);
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.fd = listen_handle;
+		epoll_ctl(epoll_handle, EPOLL_CTL_ADD, listen_handle, &event);
+		return true;
+	}
+
+	bool is_open() const
+	{
+		return epoll_handle >= 0;
+	}
+
+	int native_handle() const
+	{
+		return epoll_handle;
+	}
+
+	//Nimmt Verbindungen an, beantwortet vollstndige Anfragen und schickt den Rest von Antworten, die nicht auf einmal
+	//weggingen, sobald der Socket wieder schreibbar ist. write_metrics(std::string&) schreibt den Text.
+	template<typename Writer>
+	void poll(Writer write_metrics)
+	{
+		epoll_event events[16];
+		const int n{ epoll_wait(epoll_handle, events, 16, 0) };
+		for (int i{ 0 }; i < n; i++)
+		{
+			const int handle{ events[i].data.fd };
+			if (handle == listen_handle)
+			{
+				int connection;
+				while ((connection = accept4(listen_handle, nullptr, nullptr, SOCK_NONBLOCK)) >= 0)
+				{
+					//Zu viele offene Verbindungen: Die neue gleich wieder schliessen.
+					if (connections.size() >= max_connections)
+					{
+						::close(connection);
+						continue;
+					}
+					epoll_event event{};
+					event.events = EPOLLIN;
+					event.data.fd = connection;
+					epoll_ctl(epoll_handle, EPOLL_CTL_ADD, connection, &event);
+					connections[connection] = Connection{};
+				}
+				continue;
+			}
+
+			auto found{ connections.find(handle) };
+			if (found == connections.end())
+				continue;
+			Connection& connection{ found->second };
+
+			//Die Antwort ist schon unterwegs: Nur weiterschicken.
+			if (!connection.response.empty())
+			{
+				if (!send_pending(handle, connection))
+					close_connection(handle);
+				continue;
+			}
+
+			char buffer[1024];
+			const ssize_t size{ recv(handle, buffer, sizeof(buffer), 0) };
+			if (size > 0)
+				connection.request.append(buffer, static_cast<std::size_t>(size));
+			if (connection.request.find("\r\n\r\n") != std::string::npos)
+			{
+				respond(connection, write_metrics);
+				if (send_pending(handle, connection))
+				{
+					//Der Socket-Puffer ist voll: Den Rest schicken, sobald er wieder Platz hat.
+					epoll_event event{};
+					event.events = EPOLLOUT;
+					event.data.fd = handle;
+					epoll_ctl(epoll_handle, EPOLL_CTL_MOD, handle, &event);
+				}
+				else
+					close_connection(handle);
+			}
+			else if (size == 0 || (size < 0 && errno != EAGAIN) || connection.request.size() > 8192)
+				close_connection(handle);
+		}
+	}
+
+	~Metrics_Server()
+	{
+		for (const auto& entry : connections)
+			::close(entry.first);
+		if (listen_handle >= 0)
+			::close(listen_handle);
+		if (epoll_handle >= 0)
+			::close(epoll_handle);
+	}
+
+private:
+	static constexpr std::size_t max_connections{ 64 };
+
+	//Eine offene Verbindung: Was bisher von der Anfrage da ist und die Antwort, soweit sie schon gesendet ist.
+	struct Connection
+	{
+		std::string request{}, response{};
+		std::size_t sent{ 0 };
+	};
+
+	int listen_handle{ -1 }, epoll_handle{ -1 };
+	std::unordered_map<int, Connection> connections;
+	std::string body;
+
+	template<typename Writer>
+	void respond(Connection& connection, Writer& write_metrics)
+	{
+		const std::string& request{ connection.request };
+		const bool found{ request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0 };
+		body.clear();
+		if (found)
+			write_metrics(body);
+		else
+			body = "Not found\n";
+
+		std::string& response{ connection.response };
+		response = found ? "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n" : "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n";
+		response += "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+		response += body;
+		connection.sent = 0;
+	}
+
+	//Schickt, so viel der Socket-Puffer nimmt, ohne zu warten. true: Es bleibt noch etwas fr spter.
+	bool send_pending(int handle, Connection& connection)
+	{
+		while (connection.sent < connection.response.size())
+		{
+			const ssize_t n{ send(handle, connection.response.data() + connection.sent, connection.response.size() - connection.sent, MSG_NOSIGNAL) };
+			if (n <= 0)
+				return n < 0 && errno == EAGAIN;
+			connection.sent += static_cast<std::size_t>(n);
+		}
+		return false;
+	}
+
+	void close_connection(int handle)
+	{
+		::close(handle);
+		connections.erase(handle);
+	}
+};
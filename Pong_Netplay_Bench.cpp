@@ -0,0 +1,199 @@
+//Misst, wie oft die Netplay_Session unter einem schlechten Netzwerk zurckspult und was das Neusimulieren kostet.
+//Braucht weder SDL noch OpenGL:
+//  g++ -std=c++20 -O2 Pong_Netplay_Bench.cpp -o pong_netplay_bench
+//Beide Spieler laufen im selben Prozess ber Loopback und in simulierter Zeit, mit demselben Seed ist jeder Lauf gleich.
+#include "Pong_Network.h"
+#include <chrono>
+#include <random>
+#include <cstdio>
+
+namespace Netplay_Bench
+{
+	using clock = std::chrono::steady_clock;
+
+	struct Peer
+	{
+		Netplay_Session session{};
+		Sim_Match match{};
+		std::mt19937 random_engine{};
+		uint8_t input{ INPUT_NONE };
+		int hold{ 0 };
+
+		//Dauer von advance(), getrennt fr Frames mit und ohne Rckspulen.
+		double time_normal{ 0.0 }, time_rollback{ 0.0 }, time_max{ 0.0 };
+		uint32_t n_normal{ 0 }, n_rollback{ 0 };
+	};
+
+	void print_usage()
+	{
+		std::cerr << "Usage: pong_netplay_bench [options]\n"
+			<< "  --rollback          Predict the opponent's input and roll back (default).\n"
+			<< "  --lockstep          Wait for the opponent's input instead.\n"
+			<< "  --input-delay N     Input delay in ticks (default 1 with rollback, 3 in lockstep).\n"
+			<< "  --max-rollback N    Ticks predicted at most before waiting (default 10).\n"
+			<< "  --net SPEC          Conditions for the packets of each player, e.g. latency=50,jitter=10,loss=2,duplicate=1,reorder=5\n"
+			<< "                      (times in ms, probabilities in %).\n"
+			<< "  --seconds N         Simulated seconds to play (default 60).\n"
+			<< "  --seed N            Seed for the network and the inputs (default 1).\n"
+			<< "  --port PORT         The players use PORT and PORT+1 on localhost (default 7301).\n";
+	}
+
+	//Die Spieler halten einen zuflligen Input fr 5 bis 30 Ticks, ungefhr wie ein Mensch.
+	uint8_t next_input(Peer& peer)
+	{
+		if (--peer.hold <= 0)
+		{
+			peer.input = static_cast<uint8_t>(peer.random_engine() % 3);
+			peer.hold = 5 + static_cast<int>(peer.random_engine() % 26);
+		}
+		return peer.input;
+	}
+
+	void print_peer(const char* name, const Peer& peer, double seconds)
+	{
+		const Netplay_Session& session{ peer.session };
+		const uint32_t ticks{ session.get_tick() };
+		const uint32_t rollbacks{ session.number_of_rollbacks() };
+		const uint64_t rollback_ticks{ session.number_of_rollback_ticks() };
+		printf("%s: %u ticks, %u stalls | %u rollbacks (%.1f/s), %llu ticks simulated again (%.1f%% of all, %.2f per rollback, longest %u)\n",
+			name, ticks, session.number_of_stalls(), rollbacks, rollbacks / seconds, static_cast<unsigned long long>(rollback_ticks),
+			ticks ? 100.0 * static_cast<double>(rollback_ticks) / ticks : 0.0, rollbacks ? static_cast<double>(rollback_ticks) / rollbacks : 0.0,
+			session.longest_rollback());
+		printf("%s: advance() %.2f us without rollback, %.2f us with rollback, max %.2f us | score %u:%u%s\n",
+			name, peer.n_normal ? 1e6 * peer.time_normal / peer.n_normal : 0.0, peer.n_rollback ? 1e6 * peer.time_rollback / peer.n_rollback : 0.0,
+			1e6 * peer.time_max, peer.match.score_left, peer.match.score_right, session.has_desynced() ? " | DESYNC" : "");
+	}
+
+	void print_network(const char* name, const Network_Emulator* emulator)
+	{
+		if (emulator == nullptr)
+			return;
+		const Network_Emulator::Statistics& out{ emulator->get_outgoing_statistics() };
+		printf("%s: %llu packets sent, %llu lost, %llu duplicated, %llu reordered\n", name, static_cast<unsigned long long>(out.packets),
+			static_cast<unsigned long long>(out.lost), static_cast<unsigned long long>(out.duplicated), static_cast<unsigned long long>(out.reordered));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool rollback{ true };
+	int input_delay{ -1 }, max_rollback{ 10 }, port{ 7301 };
+	double seconds{ 60.0 };
+	uint64_t seed{ 1 };
+	Network_Conditions conditions{};
+	for (int i{ 1 }; i < argc; i++)
+	{
+		const std::string option{ argv[i] };
+		if (option == "--rollback")
+			rollback = true;
+		else if (option == "--lockstep")
+			rollback = false;
+		else if (option == "--input-delay" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], input_delay))
+				return -1;
+		}
+		else if (option == "--max-rollback" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], max_rollback))
+				return -1;
+		}
+		else if (option == "--net" && i + 1 < argc)
+		{
+			if (!Network_Conditions::parse(argv[++i], conditions))
+				return -1;
+		}
+		else if (option == "--seconds" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], seconds))
+				return -1;
+		}
+		else if (option == "--seed" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], seed))
+				return -1;
+		}
+		else if (option == "--port" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], port))
+				return -1;
+			//Der zweite Spieler benutzt port + 1.
+			if (port < 1 || port > 65534)
+			{
+				std::cerr << "Error: Port must be between 1 and 65534!\n";
+				Netplay_Bench::print_usage();
+				return -1;
+			}
+		}
+		else
+		{
+			Netplay_Bench::print_usage();
+			return -1;
+		}
+	}
+	if (input_delay < 0)
+		input_delay = rollback ? 1 : 3;
+
+	initialize_sockets();
+	Netplay_Bench::Peer peers[2]{};
+	for (int i{ 0 }; i < 2; i++)
+	{
+		Netplay_Bench::Peer& peer{ peers[i] };
+		//Auch ohne schlechtes Netzwerk braucht es den Emulator fr die simulierte Uhr. Vor open(), damit die Session
+		//schon beim ffnen die simulierte Zeit sieht.
+		peer.session.emulate(conditions, Network_Conditions{}, seed * 2 + static_cast<uint64_t>(i));
+		peer.session.get_emulator()->set_time(0.0);
+		const std::string remote{ "127.0.0.1:" + std::to_string(port + 1 - i) };
+		if (!peer.session.open(static_cast<uint16_t>(port + i), remote, i, input_delay, rollback ? max_rollback : 0))
+			return -1;
+		peer.match.right = Sim_Schlaeger{ 0.8, PLAYER };
+		peer.random_engine.seed(static_cast<uint32_t>(seed * 2 + static_cast<uint64_t>(i)));
+	}
+
+	const uint64_t n_frames{ static_cast<uint64_t>(seconds * Simulation::tick_rate) };
+	for (uint64_t frame{ 0 }; frame < n_frames; frame++)
+	{
+		const double time{ static_cast<double>(frame) / Simulation::tick_rate };
+		for (Netplay_Bench::Peer& peer : peers)
+		{
+			peer.session.get_emulator()->set_time(time);
+			peer.session.poll();
+		}
+		for (Netplay_Bench::Peer& peer : peers)
+		{
+			if (peer.session.has_failed())
+			{
+				std::cerr << "Error: Lost the connection between the players!\n";
+				return -1;
+			}
+
+			const uint8_t input{ Netplay_Bench::next_input(peer) };
+			const uint32_t rollbacks_before{ peer.session.number_of_rollbacks() };
+			unsigned events{ 0 };
+			const auto start{ Netplay_Bench::clock::now() };
+			const bool advanced{ peer.session.advance(peer.match, input, events) };
+			const double duration{ std::chrono::duration<double>(Netplay_Bench::clock::now() - start).count() };
+			if (!advanced)
+				continue;
+			if (peer.session.number_of_rollbacks() != rollbacks_before)
+			{
+				peer.time_rollback += duration;
+				peer.n_rollback++;
+			}
+			else
+			{
+				peer.time_normal += duration;
+				peer.n_normal++;
+			}
+			peer.time_max = std::max(peer.time_max, duration);
+		}
+	}
+
+	printf("%s, input delay %d, %.0f simulated seconds, seed %llu\n", rollback ? "Rollback" : "Lockstep", input_delay, seconds,
+		static_cast<unsigned long long>(seed));
+	Netplay_Bench::print_peer("left ", peers[0], seconds);
+	Netplay_Bench::print_peer("right", peers[1], seconds);
+	Netplay_Bench::print_network("left ", peers[0].session.get_emulator());
+	Netplay_Bench::print_network("right", peers[1].session.get_emulator());
+	return (peers[0].session.has_desynced() || peers[1].session.has_desynced()) ? 1 : 0;
+}
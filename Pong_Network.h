@@ -0,0 +1,851 @@
+#pragma once
+
+//Netzwerk fr den Zwei-Spieler-Modus: UDP-Socket und Session mit Lockstep oder Rollback,
+//dazu ein Emulator fr schlechte Netzwerke zum Testen.
+//Braucht weder SDL noch OpenGL.
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <cstdlib>
+#include <algorithm>
+#include <charconv>
+#include "Pong_Simulation.h"
+
+//Unter Windows muss Winsock einmal gestartet werden.
+inline bool initialize_sockets()
+{
+#ifdef _WIN32
+	static bool initialized{ false };
+	if (!initialized)
+	{
+		WSADATA wsa_data;
+		if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+		{
+			std::cerr << "Error: Could not initialize Winsock!\n";
+			return false;
+		}
+		initialized = true;
+	}
+#endif
+	return true;
+}
+
+//Liest eine Zahl aus der Kommandozeile. Text, Reste nach der Zahl oder Werte ausserhalb von T ergeben einen Fehler.
+template<typename T>
+bool parse_number(const std::string& text, T& value)
+{
+	const char* end{ text.data() + text.size() };
+	const auto [number_end, error]{ std::from_chars(text.data(), end, value) };
+	if (text.empty() || error != std::errc{} || number_end != end)
+	{
+		std::cerr << "Error: Invalid number " << text << "!\n";
+		return false;
+	}
+	return true;
+}
+
+//Adresse eines UDP-Partners (IPv4).
+struct UDP_Address
+{
+	sockaddr_in addr{};
+
+	bool operator==(const UDP_Address& other) const
+	{
+		return addr.sin_addr.s_addr == other.addr.sin_addr.s_addr && addr.sin_port == other.addr.sin_port;
+	}
+
+	static bool resolve(const std::string& host, uint16_t port, UDP_Address& address)
+	{
+		initialize_sockets();
+		addrinfo hints{};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		addrinfo* result{ nullptr };
+		if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr)
+		{
+			std::cerr << "Error: Could not resolve host! " << host << '\n';
+			return false;
+		}
+		memcpy(&address.addr, result->ai_addr, sizeof(sockaddr_in));
+		address.addr.sin_port = htons(port);
+		freeaddrinfo(result);
+		return true;
+	}
+
+	//Format: "host:port", z.B. "127.0.0.1:7001".
+	static bool resolve(const std::string& host_and_port, UDP_Address& address)
+	{
+		std::size_t colon{ host_and_port.rfind(':') };
+		if (colon == std::string::npos)
+		{
+			std::cerr << "Error: Address must have the form host:port! " << host_and_port << '\n';
+			return false;
+		}
+		uint16_t port{ 0 };
+		if (!parse_number(host_and_port.substr(colon + 1), port))
+			return false;
+		return resolve(host_and_port.substr(0, colon), port, address);
+	}
+};
+
+//Netzwerkbedingungen fr eine Richtung. Zeiten in Sekunden, Wahrscheinlichkeiten zwischen 0 und 1.
+struct Network_Conditions
+{
+	double latency{ 0.0 };		//Feste Verzgerung
+	double jitter{ 0.0 };		//Zufllig zwischen -jitter und +jitter zur Verzgerung dazu
+	double loss{ 0.0 };			//Das Paket geht verloren.
+	double duplicate{ 0.0 };	//Das Paket kommt zweimal an, mit unabhngiger Verzgerung.
+	double reorder{ 0.0 };		//Das Paket wird zustzlich 20-50 ms verzgert und so von spteren berholt.
+
+	bool is_active() const
+	{
+		return latency > 0.0 || jitter > 0.0 || loss > 0.0 || duplicate > 0.0 || reorder > 0.0;
+	}
+
+	//Liest z.B. "latency=50,jitter=10,loss=2,duplicate=1,reorder=5": Zeiten in Millisekunden, Wahrscheinlichkeiten in Prozent.
+	static bool parse(const std::string& text, Network_Conditions& conditions)
+	{
+		std::size_t start{ 0 };
+		while (start < text.size())
+		{
+			std::size_t end{ text.find(',', start) };
+			if (end == std::string::npos)
+				end = text.size();
+			const std::string item{ text.substr(start, end - start) };
+			start = end + 1;
+
+			const std::size_t equals{ item.find('=') };
+			char* number_end{ nullptr };
+			const double value{ equals == std::string::npos ? 0.0 : std::strtod(item.c_str() + equals + 1, &number_end) };
+			if (equals == std::string::npos || number_end == item.c_str() + equals + 1 || *number_end != '\0' || value < 0.0)
+			{
+				std::cerr << "Error: Invalid network condition " << item << "!\n";
+				return false;
+			}
+
+			const std::string key{ item.substr(0, equals) };
+			if (key == "latency")
+				conditions.latency = value / 1000.0;
+			else if (key == "jitter")
+				conditions.jitter = value / 1000.0;
+			else if (key == "loss")
+				conditions.loss = value / 100.0;
+			else if (key == "duplicate")
+				conditions.duplicate = value / 100.0;
+			else if (key == "reorder")
+				conditions.reorder = value / 100.0;
+			else
+			{
+				std::cerr << "Error: Unknown network condition " << key << "!\n";
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+//Simuliert ein schlechtes Netzwerk direkt ber dem Socket: Ausgehende Pakete werden zurckgehalten und erst gesendet,
+//wenn ihre Verzgerung vorbei ist, empfangene Pakete ebenso erst dann weitergegeben. Verlust, Duplikate und
+//Umsortieren kommen dazu. Alle Zufallszahlen kommen aus einem Generator mit festem Seed, so dass ein Lauf mit
+//eigener Uhr (set_time) reproduzierbar ist.
+class Network_Emulator
+{
+public:
+	static constexpr std::size_t max_packet_size{ 1500 };
+
+	struct Statistics
+	{
+		uint64_t packets{ 0 }, lost{ 0 }, duplicated{ 0 }, reordered{ 0 };
+	};
+
+	Network_Emulator(const Network_Conditions& out, const Network_Conditions& in, uint64_t seed) : random_state{ seed }
+	{
+		outgoing.conditions = out;
+		incoming.conditions = in;
+	}
+
+	//Ab jetzt bestimmt nur noch set_time() die Zeit, nicht mehr die Uhr des Systems.
+	void set_time(double seconds)
+	{
+		manual_time = seconds;
+	}
+
+	bool has_manual_time() const
+	{
+		return manual_time >= 0.0;
+	}
+
+	//Zeit in Sekunden
+	double time() const
+	{
+		if (has_manual_time())
+			return manual_time;
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void send(const uint8_t* data, std::size_t size, const UDP_Address& to)
+	{
+		schedule(outgoing, data, size, to);
+	}
+
+	void arrive(const uint8_t* data, std::size_t size, const UDP_Address& from)
+	{
+		schedule(incoming, data, size, from);
+	}
+
+	//Nchstes fllige Paket, oder -1, falls keines fllig ist.
+	int next_outgoing(uint8_t* buffer, std::size_t size, UDP_Address& to)
+	{
+		return take(outgoing, buffer, size, to);
+	}
+
+	int next_incoming(uint8_t* buffer, std::size_t size, UDP_Address& from)
+	{
+		return take(incoming, buffer, size, from);
+	}
+
+	const Statistics& get_outgoing_statistics() const
+	{
+		return outgoing.statistics;
+	}
+
+	const Statistics& get_incoming_statistics() const
+	{
+		return incoming.statistics;
+	}
+
+private:
+	struct Delayed_Packet
+	{
+		double release{ 0.0 };
+		uint64_t order{ 0 };	//Bei gleicher Zeit in der Reihenfolge des Sendens.
+		UDP_Address address{};
+		std::vector<uint8_t> data;
+	};
+
+	struct Later
+	{
+		bool operator()(const Delayed_Packet& a, const Delayed_Packet& b) const
+		{
+			return a.release > b.release || (a.release == b.release && a.order > b.order);
+		}
+	};
+
+	struct Direction
+	{
+		Network_Conditions conditions{};
+		std::priority_queue<Delayed_Packet, std::vector<Delayed_Packet>, Later> queue;
+		Statistics statistics{};
+	};
+
+	Direction outgoing{}, incoming{};
+	uint64_t random_state{ 0 }, order{ 0 };
+	double manual_time{ -1.0 };
+
+	//SplitMix64: Klein und auf allen Plattformen gleich, anders als die Verteilungen der Standardbibliothek.
+	double random()
+	{
+		uint64_t z{ random_state += 0x9E3779B97F4A7C15ull };
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z ^= z >> 31;
+		return static_cast<double>(z >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	void schedule(Direction& direction, const uint8_t* data, std::size_t size, const UDP_Address& address)
+	{
+		const Network_Conditions& c{ direction.conditions };
+		direction.statistics.packets++;
+
+		//Pro Paket immer gleich viele Zufallszahlen, damit ein gendertes Verhltnis die spteren Pakete nicht verschiebt.
+		const double r_loss{ random() }, r_duplicate{ random() };
+		const bool lost{ r_loss < c.loss || size > max_packet_size }, duplicated{ r_duplicate < c.duplicate };
+		direction.statistics.lost += lost;
+		direction.statistics.duplicated += (!lost && duplicated);
+
+		for (int copy{ 0 }; copy < 2; copy++)
+		{
+			const double r_jitter{ random() }, r_reorder{ random() }, r_extra{ random() };
+			if (lost || (copy == 1 && !duplicated))
+				continue;
+
+			double delay{ std::max(0.0, c.latency + c.jitter * (2.0 * r_jitter - 1.0)) };
+			if (r_reorder < c.reorder)
+			{
+				delay += 0.02 + 0.03 * r_extra;
+				direction.statistics.reordered++;
+			}
+			direction.queue.push({ time() + delay, order++, address, std::vector<uint8_t>(data, data + size) });
+		}
+	}
+
+	int take(Direction& direction, uint8_t* buffer, std::size_t size, UDP_Address& address)
+	{
+		if (direction.queue.empty() || direction.queue.top().release > time())
+			return -1;
+
+		const Delayed_Packet& packet{ direction.queue.top() };
+		const std::size_t n{ std::min(size, packet.data.size()) };
+		memcpy(buffer, packet.data.data(), n);
+		address = packet.address;
+		direction.queue.pop();
+		return static_cast<int>(n);
+	}
+};
+
+//UDP-Socket, der nie blockiert.
+class UDP_Socket
+{
+public:
+	UDP_Socket() {}
+	UDP_Socket(const UDP_Socket&) = delete;
+	UDP_Socket& operator=(const UDP_Socket&) = delete;
+
+	//ffne den Socket auf dem lokalen Port (0: Das Betriebssystem whlt einen Port).
+	bool open(uint16_t port)
+	{
+		if (!initialize_sockets())
+			return false;
+
+		handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (!is_open())
+		{
+			std::cerr << "Error: Could not create UDP socket!\n";
+			return false;
+		}
+
+		sockaddr_in local{};
+		local.sin_family = AF_INET;
+		local.sin_addr.s_addr = htonl(INADDR_ANY);
+		local.sin_port = htons(port);
+		if (bind(handle, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0)
+		{
+			std::cerr << "Error: Could not bind UDP socket to port " << port << "!\n";
+			close();
+			return false;
+		}
+
+#ifdef _WIN32
+		u_long non_blocking{ 1 };
+		ioctlsocket(handle, FIONBIO, &non_blocking);
+#else
+		fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+		return true;
+	}
+
+	bool is_open() const
+	{
+#ifdef _WIN32
+		return handle != INVALID_SOCKET;
+#else
+		return handle >= 0;
+#endif
+	}
+
+	//Fr epoll, recvmmsg etc. im Server.
+	auto native_handle() const
+	{
+		return handle;
+	}
+
+	//Simuliere ab jetzt ein schlechtes Netzwerk fr diesen Socket, getrennt fr ausgehende und eingehende Pakete.
+	void emulate(const Network_Conditions& out, const Network_Conditions& in, uint64_t seed)
+	{
+		emulator = std::make_unique<Network_Emulator>(out, in, seed);
+	}
+
+	Network_Emulator* get_emulator()
+	{
+		return emulator.get();
+	}
+
+	//Zeit in Sekunden. Hat der Emulator eine eigene Uhr, dessen Zeit, damit Tests in simulierter Zeit laufen knnen.
+	double time() const
+	{
+		if (emulator)
+			return emulator->time();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	bool send_to(const uint8_t* data, std::size_t size, const UDP_Address& to)
+	{
+		if (emulator)
+		{
+			emulator->send(data, size, to);
+			send_delayed();
+			return true;
+		}
+		return send_now(data, size, to);
+	}
+
+	//Gibt die Grsse des empfangenen Pakets zurck, oder -1, falls keines da ist.
+	int receive(uint8_t* buffer, std::size_t size, UDP_Address& from)
+	{
+		if (!emulator)
+			return receive_now(buffer, size, from);
+
+		send_delayed();
+		uint8_t packet[Network_Emulator::max_packet_size];
+		UDP_Address sender{};
+		int n;
+		while ((n = receive_now(packet, sizeof(packet), sender)) >= 0)
+			emulator->arrive(packet, static_cast<std::size_t>(n), sender);
+		return emulator->next_incoming(buffer, size, from);
+	}
+
+	void close()
+	{
+		if (is_open())
+		{
+#ifdef _WIN32
+			closesocket(handle);
+			handle = INVALID_SOCKET;
+#else
+			::close(handle);
+			handle = -1;
+#endif
+		}
+	}
+
+	~UDP_Socket()
+	{
+		close();
+	}
+
+private:
+#ifdef _WIN32
+	SOCKET handle{ INVALID_SOCKET };
+#else
+	int handle{ -1 };
+#endif
+	std::unique_ptr<Network_Emulator> emulator;
+
+	bool send_now(const uint8_t* data, std::size_t size, const UDP_Address& to)
+	{
+		return sendto(handle, reinterpret_cast<const char*>(data), static_cast<int>(size), 0,
+			reinterpret_cast<const sockaddr*>(&to.addr), sizeof(to.addr)) == static_cast<int>(size);
+	}
+
+	int receive_now(uint8_t* buffer, std::size_t size, UDP_Address& from)
+	{
+		socklen_t length{ sizeof(from.addr) };
+		return static_cast<int>(recvfrom(handle, reinterpret_cast<char*>(buffer), static_cast<int>(size), 0,
+			reinterpret_cast<sockaddr*>(&from.addr), &length));
+	}
+
+	//Schicke die zurckgehaltenen Pakete, deren Verzgerung vorbei ist.
+	void send_delayed()
+	{
+		uint8_t packet[Network_Emulator::max_packet_size];
+		UDP_Address to{};
+		int n;
+		while ((n = emulator->next_outgoing(packet, sizeof(packet), to)) >= 0)
+			send_now(packet, static_cast<std::size_t>(n), to);
+	}
+};
+
+//Hilfsfunktionen, um Pakete unabhngig von der Byte-Reihenfolge des Rechners zu schreiben und zu lesen (Little Endian).
+namespace Packet
+{
+	inline void write_u32(uint8_t* out, uint32_t value)
+	{
+		out[0] = static_cast<uint8_t>(value);
+		out[1] = static_cast<uint8_t>(value >> 8);
+		out[2] = static_cast<uint8_t>(value >> 16);
+		out[3] = static_cast<uint8_t>(value >> 24);
+	}
+
+	inline uint32_t read_u32(const uint8_t* in)
+	{
+		return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) | (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+	}
+}
+
+//Netzwerk-Session fr zwei Spieler: Jeder schickt nur seinen Input pro Tick, beide rechnen dieselbe Simulation.
+//Jedes Paket enthlt alle Inputs, die der Gegner noch nicht besttigt hat. Verlorene Pakete mssen so nicht extra neu geschickt werden.
+//
+//Der eigene Input gilt erst input_delay Ticks spter, damit er normalerweise beim Gegner ankommt, bevor dieser ihn braucht.
+//Mit max_rollback = 0 ist das reiner Lockstep: Ein Tick wird erst simuliert, wenn beide Inputs da sind.
+//Mit max_rollback > 0 wird der Input des Gegners vorhergesagt (sein letzter Input), damit das Spiel ohne Warten weiterluft.
+//Kommt der echte Input und unterscheidet sich von der Vorhersage, wird der gespeicherte Zustand vor diesem Tick geladen
+//und bis zum aktuellen Tick neu simuliert (Rollback wie bei GGPO). Sounds und Portraits von neu simulierten Ticks werden nicht wiederholt.
+//Alle Puffer haben eine feste Grsse, advance() alloziert nie Speicher.
+class Netplay_Session
+{
+public:
+	static constexpr int max_input_delay{ 60 };
+	static constexpr int max_rollback_ticks{ 60 };
+
+	Netplay_Session() {}
+
+	//side: 0 = linker Schlger, 1 = rechter Schlger. Beide Seiten mssen dasselbe input_delay verwenden.
+	bool open(uint16_t local_port, const std::string& remote_host_and_port, int local_side, int delay, int rollback = 0)
+	{
+		if (delay < 0 || delay > max_input_delay)
+		{
+			std::cerr << "Error: Input delay must be between 0 and " << max_input_delay << " ticks!\n";
+			return false;
+		}
+		if (rollback < 0 || rollback > max_rollback_ticks)
+		{
+			std::cerr << "Error: Rollback must be between 0 and " << max_rollback_ticks << " ticks!\n";
+			return false;
+		}
+		if (!UDP_Address::resolve(remote_host_and_port, remote_address) || !socket.open(local_port))
+			return false;
+
+		side = local_side;
+		input_delay = delay;
+		max_rollback = rollback;
+
+		//Die ersten input_delay Ticks hat niemand einen Input.
+		local_count = static_cast<uint32_t>(input_delay);
+		remote_count = static_cast<uint32_t>(input_delay);
+		remote_ack = static_cast<uint32_t>(input_delay);
+		time_last_received = socket.time();
+		time_last_hello = socket.time() - 1.0;
+		return true;
+	}
+
+	//Simuliere ein schlechtes Netzwerk unter der Session (siehe Network_Emulator). Fr Tests in simulierter Zeit vor open()
+	//aufrufen und die Uhr des Emulators stellen.
+	void emulate(const Network_Conditions& out, const Network_Conditions& in, uint64_t seed)
+	{
+		socket.emulate(out, in, seed);
+	}
+
+	//Fr Tests in simulierter Zeit, nach emulate().
+	Network_Emulator* get_emulator()
+	{
+		return socket.get_emulator();
+	}
+
+	//Empfange alle Pakete und schicke die eigenen Inputs nochmals. Einmal pro Frame aufrufen.
+	void poll()
+	{
+		uint8_t buffer[512];
+		UDP_Address from{};
+		int size;
+		while ((size = socket.receive(buffer, sizeof(buffer), from)) >= 0)
+		{
+			if (from == remote_address && size >= 3 && buffer[0] == magic[0] && buffer[1] == magic[1])
+				receive_packet(buffer, static_cast<std::size_t>(size));
+		}
+
+		if (!connected)
+		{
+			//Schicke die Begrssung alle 100 ms, bis der Gegner antwortet.
+			if (socket.time() - time_last_hello > 0.1)
+			{
+				send_hello();
+				time_last_hello = socket.time();
+			}
+		}
+		else
+			send_inputs();
+	}
+
+	//Simuliere den nchsten Tick. Gibt false zurck, falls auf den Gegner gewartet werden muss.
+	//local_input ist der aktuelle Input des Spielers. Er gilt fr den Tick input_delay Ticks spter.
+	//events enthlt nur die Sim_Event vom neuen Tick, nicht die von neu simulierten Ticks.
+	bool advance(Sim_Match& match, uint8_t local_input, unsigned& events)
+	{
+		if (!connected || failed)
+			return false;
+
+		//Falls eine Vorhersage falsch war: Lade den Zustand vor dem Tick und simuliere bis jetzt neu.
+		if (rollback_tick < tick)
+		{
+			const uint32_t n{ tick - rollback_tick };
+			match = states[rollback_tick % buffer_size];
+			for (uint32_t t{ rollback_tick }; t < tick; t++)
+				simulate_tick(match, t);
+			n_rollbacks++;
+			n_rollback_ticks += n;
+			if (n > n_max_rollback)
+				n_max_rollback = n;
+		}
+		rollback_tick = no_rollback;
+
+		if (local_count == tick + static_cast<uint32_t>(input_delay))
+		{
+			local_inputs[local_count % buffer_size] = local_input;
+			local_count++;
+			send_inputs();
+		}
+
+		//Es drfen hchstens max_rollback Ticks mit vorhergesagtem Input simuliert sein.
+		if (tick >= remote_count + static_cast<uint32_t>(max_rollback) || should_wait())
+		{
+			n_stalls++;
+			return false;
+		}
+
+		events = simulate_tick(match, tick);
+		tick++;
+		update_checksum(match);
+		return true;
+	}
+
+	bool is_connected() const
+	{
+		return connected;
+	}
+
+	//Falls der Gegner 5 Sekunden lang nichts mehr geschickt hat oder die Einstellungen nicht zusammenpassen.
+	bool has_failed() const
+	{
+		return failed || (connected && socket.time() - time_last_received > 5.0);
+	}
+
+	//Falls die beiden Simulationen nicht mehr denselben Zustand haben.
+	bool has_desynced() const
+	{
+		return desynced;
+	}
+
+	uint32_t get_tick() const
+	{
+		return tick;
+	}
+
+	//Anzahl Ticks, die nicht mehr zurckgespult werden knnen: Beide Inputs sind bekannt und es steht kein Rollback aus.
+	uint32_t confirmed_ticks() const
+	{
+		return std::min({ tick, remote_count, rollback_tick });
+	}
+
+	//Der Zustand nach dem Tick t < confirmed_ticks(). match ist der aktuelle Zustand, der nach dem letzten Tick.
+	//Hlt nur, solange t nicht mehr als buffer_size Ticks zurck liegt.
+	const Sim_Match& confirmed_state(uint32_t t, const Sim_Match& match) const
+	{
+		return (t + 1 < tick) ? states[(t + 1) % buffer_size] : match;
+	}
+
+	//Wie oft auf den Gegner gewartet werden musste.
+	uint32_t number_of_stalls() const
+	{
+		return n_stalls;
+	}
+
+	//Wie oft zurckgespult wurde, wie viele Ticks insgesamt neu simuliert wurden und die lngste Rckspulung.
+	uint32_t number_of_rollbacks() const
+	{
+		return n_rollbacks;
+	}
+
+	uint64_t number_of_rollback_ticks() const
+	{
+		return n_rollback_ticks;
+	}
+
+	uint32_t longest_rollback() const
+	{
+		return n_max_rollback;
+	}
+
+private:
+	static constexpr uint32_t buffer_size{ 256 };		//Muss grsser als 2 * max_input_delay + max_rollback_ticks + 2 sein.
+	static constexpr uint32_t checksum_interval{ 60 };	//Alle wie viele Ticks die Prfsumme verglichen wird.
+	static constexpr uint32_t no_rollback{ UINT32_MAX };
+	static constexpr uint8_t magic[2]{ 'P', 'L' };
+
+	enum Packet_Type : uint8_t
+	{
+		PACKET_HELLO = 1,
+		PACKET_INPUT = 2,
+	};
+
+	UDP_Socket socket{};
+	UDP_Address remote_address{};
+	int side{ 0 }, input_delay{ 0 }, max_rollback{ 0 };
+	bool connected{ false }, failed{ false }, desynced{ false };
+
+	//Ticks und Inputs. *_count: Anzahl Ticks, fr die der Input bekannt ist.
+	uint32_t tick{ 0 }, local_count{ 0 }, remote_count{ 0 }, remote_ack{ 0 }, remote_tick{ 0 };
+	uint8_t local_inputs[buffer_size]{}, remote_inputs[buffer_size]{};
+
+	//Rollback: Zustand vor jedem Tick und der Input vom Gegner, mit dem der Tick simuliert wurde.
+	Sim_Match states[buffer_size]{};
+	uint8_t used_remote_inputs[buffer_size]{};
+	uint32_t rollback_tick{ no_rollback }, last_wait_tick{ 0 };
+
+	//Statistik
+	uint32_t n_stalls{ 0 }, n_rollbacks{ 0 }, n_max_rollback{ 0 };
+	uint64_t n_rollback_ticks{ 0 };
+
+	//Die letzten Prfsummen von besttigten Zustnden (alle Inputs bekannt), die eigenen und die vom Gegner.
+	static constexpr uint32_t checksum_history{ 8 };
+	uint32_t own_check_tick{ 0 }, remote_check_tick{ 0 };
+	uint32_t own_check_ticks[checksum_history]{}, own_checksums[checksum_history]{};
+	uint32_t remote_check_ticks[checksum_history]{}, remote_checksums[checksum_history]{};
+
+	double time_last_received{ 0.0 }, time_last_hello{ 0.0 };	//Sekunden, von socket.time()
+
+	uint8_t predicted_remote_input() const
+	{
+		return remote_inputs[(remote_count - 1) % buffer_size];
+	}
+
+	unsigned simulate_tick(Sim_Match& match, uint32_t t)
+	{
+		states[t % buffer_size] = match;
+		const uint8_t input_local{ local_inputs[t % buffer_size] };
+		const uint8_t input_remote{ (t < remote_count) ? remote_inputs[t % buffer_size] : predicted_remote_input() };
+		used_remote_inputs[t % buffer_size] = input_remote;
+		return (side == 0) ? match.step(input_local, input_remote) : match.step(input_remote, input_local);
+	}
+
+	//Falls wir dem Gegner mehr als einen Tick voraus sind, warte ab und zu einen Tick, sonst msste er dauernd zurckspulen.
+	bool should_wait()
+	{
+		if (max_rollback == 0 || tick < last_wait_tick + 10)
+			return false;
+
+		const int64_t local_advantage{ static_cast<int64_t>(tick) - remote_count };
+		const int64_t remote_advantage{ static_cast<int64_t>(remote_tick) - remote_ack };
+		if (local_advantage - remote_advantage >= 4)
+		{
+			last_wait_tick = tick;
+			return true;
+		}
+		return false;
+	}
+
+	//Merke die Prfsumme vom letzten besttigten Zustand, der ein Vielfaches von checksum_interval ist.
+	void update_checksum(const Sim_Match& match)
+	{
+		const uint32_t confirmed{ (remote_count < tick) ? remote_count : tick };
+		const uint32_t check_tick{ confirmed - confirmed % checksum_interval };
+		if (check_tick > own_check_tick && tick - check_tick < buffer_size)
+		{
+			own_check_tick = check_tick;
+			const uint32_t i{ (check_tick / checksum_interval) % checksum_history };
+			own_check_ticks[i] = check_tick;
+			own_checksums[i] = (check_tick == tick) ? match.checksum() : states[check_tick % buffer_size].checksum();
+			compare_checksum(check_tick);
+		}
+	}
+
+	void send_hello()
+	{
+		uint8_t packet[5]{ magic[0], magic[1], PACKET_HELLO, static_cast<uint8_t>(side), static_cast<uint8_t>(input_delay) };
+		socket.send_to(packet, sizeof(packet), remote_address);
+	}
+
+	//Paket: Magic, Typ, Besttigung (Anzahl empfangener Inputs), eigener Tick, erster Tick, Anzahl Inputs, Inputs, Tick und Prfsumme.
+	void send_inputs()
+	{
+		uint8_t packet[3 + 4 + 4 + 4 + 1 + buffer_size + 8];
+		packet[0] = magic[0];
+		packet[1] = magic[1];
+		packet[2] = PACKET_INPUT;
+		Packet::write_u32(packet + 3, remote_count);
+		Packet::write_u32(packet + 7, tick);
+		Packet::write_u32(packet + 11, remote_ack);
+		const uint32_t n{ local_count - remote_ack };
+		packet[15] = static_cast<uint8_t>(n);
+		for (uint32_t i{ 0 }; i < n; i++)
+			packet[16 + i] = local_inputs[(remote_ack + i) % buffer_size];
+
+		Packet::write_u32(packet + 16 + n, own_check_tick);
+		Packet::write_u32(packet + 20 + n, own_checksums[(own_check_tick / checksum_interval) % checksum_history]);
+		socket.send_to(packet, 24 + n, remote_address);
+	}
+
+	void receive_packet(const uint8_t* packet, std::size_t size)
+	{
+		time_last_received = socket.time();
+
+		if (packet[2] == PACKET_HELLO && size >= 5)
+		{
+			if (packet[3] == side || packet[4] != input_delay)
+			{
+				std::cerr << "Error: Both players must use different sides and the same input delay!\n";
+				failed = true;
+				return;
+			}
+			//Antworte einmal, damit der Gegner auch weiss, dass die Verbindung steht.
+			//Danach erfhrt er es sptestens durch die Inputs.
+			if (!connected)
+			{
+				connected = true;
+				send_hello();
+			}
+		}
+		else if (packet[2] == PACKET_INPUT && size >= 16)
+		{
+			connected = true;
+			const uint32_t ack{ Packet::read_u32(packet + 3) }, sender_tick{ Packet::read_u32(packet + 7) }, first{ Packet::read_u32(packet + 11) };
+			const uint32_t n{ packet[15] };
+			if (size < 24 + n)
+				return;
+
+			if (ack > remote_ack && ack <= local_count)
+				remote_ack = ack;
+			if (sender_tick > remote_tick)
+				remote_tick = sender_tick;
+
+			//bernimm die Inputs, die neu sind. Die Inputs kommen immer lckenlos ab der letzten Besttigung.
+			for (uint32_t i{ 0 }; i < n; i++)
+			{
+				if (first + i == remote_count)
+				{
+					const uint8_t input{ packet[16 + i] };
+					//Der Tick wurde schon mit einer falschen Vorhersage simuliert.
+					if (remote_count < tick && used_remote_inputs[remote_count % buffer_size] != input && remote_count < rollback_tick)
+						rollback_tick = remote_count;
+					remote_inputs[remote_count % buffer_size] = input;
+					remote_count++;
+				}
+			}
+
+			const uint32_t check_tick{ Packet::read_u32(packet + 16 + n) };
+			if (check_tick > remote_check_tick && check_tick % checksum_interval == 0)
+			{
+				remote_check_tick = check_tick;
+				const uint32_t i{ (check_tick / checksum_interval) % checksum_history };
+				remote_check_ticks[i] = check_tick;
+				remote_checksums[i] = Packet::read_u32(packet + 20 + n);
+				compare_checksum(check_tick);
+			}
+		}
+	}
+
+	//Vergleiche die Prfsummen, sobald beide Seiten den besttigten Tick haben.
+	void compare_checksum(uint32_t check_tick)
+	{
+		const uint32_t i{ (check_tick / checksum_interval) % checksum_history };
+		if (check_tick != 0 && own_check_ticks[i] == check_tick && remote_check_ticks[i] == check_tick && own_checksums[i] != remote_checksums[i] && !desynced)
+		{
+			std::cerr << "Error: Simulation desynced at tick " << check_tick << "!\n";
+			desynced = true;
+		}
+	}
+};
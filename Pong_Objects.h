@@ -1,5 +1,7 @@
 #pragma once
 #include "Pong_Classes.h"
+#include "Pong_Replay.h"
+#include "Pong_Network.h"
 
 using namespace Game;
 
@@ -136,8 +138,27 @@ namespace Screen_Start
 namespace Screen_Main
 {
 	Choice_Box cb_quit{0.0f,0.0f,0.3f,0.01f,"QUIT GAME?"};
-	Obj_Schlaeger player{-0.8,0.0,PLAYER};
-	Obj_Schlaeger opponent{ 0.8,0.0,SMART};
+
+	//Die Simulation. Die Objekte unten zeichnen nur ihren Zustand.
+	Sim_Match match{};
+	uint8_t input_player{ INPUT_NONE };
+
+	//Die Simulation luft in einem eigenen Thread mit festen Ticks. Whrend er luft, werden match, input_player, paused,
+	//die Netplay-Session und replay_recorder nur mit match_mutex verwendet. Gezeichnet wird aus den Snapshots, die er jeden Tick verffentlicht.
+	struct Match_Snapshot
+	{
+		Sim_Match match{};
+		std::chrono::steady_clock::time_point time{};	//Wann der Tick verffentlicht wurde.
+		bool connected{ true };							//Netzwerkmodus: Ob der Gegner schon verbunden ist.
+	};
+	std::mutex match_mutex;
+	Fixed_Tick_Thread simulation{};
+	Triple_Buffer<Match_Snapshot> snapshots{};
+	Match_Snapshot snapshot_previous{}, snapshot_latest{};	//Nur im Haupt-Thread: Die beiden neuesten Snapshots.
+	std::atomic<unsigned> pending_events{ 0 };				//Sim_Event seit dem letzten Bild.
+
+	Obj_Schlaeger player{-0.8,0.0};
+	Obj_Schlaeger opponent{ 0.8,0.0};
 	Obj_Ball ball{};
 	Obj_ScoreBoard score_board{};
 	
@@ -153,8 +174,105 @@ namespace Screen_Main
 	int progress{ 0 };
 	int max_score{ 1 };
 
+	//Zwei-Spieler-Modus bers Netzwerk. Falls gesetzt, steuert der Gegner den anderen Schlger.
+	Netplay_Session* netplay{ nullptr };
+	uint32_t recorded_ticks{ 0 };	//Bis hierhin sind die Ticks der Session im Replay.
+	Text_Bitmap txt_waiting{ "WAITING FOR OPPONENT...", 0.0f, 0.0f, 0.05f, Colour_List::white };
+
+	//bernimm den Zustand der Simulation in die Objekte, die gezeichnet werden.
+	void sync_objects(const Sim_Match& state)
+	{
+		player.update_state(state.left);
+		opponent.update_state(state.right);
+		ball.update_state(state.ball);
+		score_board.set_score(state.score_left, state.score_right);
+	}
+
+	//Wie sync_objects, aber zeichnet die Objekte auch gleich an der neuen Position, z.B. wenn das Spiel pausiert ist.
+	void show_state()
+	{
+		sync_objects(match);
+		player.update_graphics();
+		opponent.update_graphics();
+		ball.update_graphics();
+	}
+
+	//Sounds und Portraits zu den Sim_Event eines oder mehrerer Ticks.
+	void handle_events(unsigned events, const Sim_Match& state)
+	{
+		ball.play_sounds(events, state.left.intelligence, state.right.intelligence);
+
+		if (events & EVENT_POINT_RIGHT)
+		{
+			portrait_right.change_to_happy();
+			portrait_left.change_to_sad();
+		}
+		else if (events & EVENT_POINT_LEFT)
+		{
+			portrait_left.change_to_happy();
+			if (state.right.personality == AGGRESSIVE)
+				portrait_right.change_to_angry();
+			else
+				portrait_right.change_to_sad();
+		}
+		else if (events & EVENT_SERVE)
+		{
+			portrait_left.change_to_neutral();
+			portrait_right.change_to_neutral();
+		}
+	}
+
+	//Replays: Jedes Match (im Turnier jede Runde) wird beim Ende ans Archiv angehngt.
+	const std::filesystem::path replay_archive_path{ std::filesystem::path{"Replays"} / "Pong_Replays.pra" };
+	Replay_Recorder replay_recorder{};
+
+	//Ein fertiges Match wird unter match_mutex nur bernommen und erst danach kodiert und geschrieben,
+	//damit der Simulations-Thread nicht auf die Festplatte warten muss.
+	Replay_Recorder replay_finished{};
+	Replay_Info replay_finished_info{};
+
+	//Nur mit match_mutex aufrufen.
+	void save_replay()
+	{
+		if (!replay_recorder.empty())
+		{
+			replay_finished_info = Replay_Info{};
+			replay_finished_info.personality = static_cast<uint8_t>(match.right.personality);
+			replay_finished_info.intelligence = static_cast<uint8_t>(match.right.intelligence);
+			replay_finished_info.t_react_multiplier = static_cast<float>(match.right.t_react_multiplier);
+			std::swap(replay_finished, replay_recorder);
+		}
+		replay_recorder.start();
+	}
+
+	//Ohne match_mutex aufrufen.
+	void write_finished_replay()
+	{
+		if (replay_finished.empty())
+			return;
+		std::vector<uint8_t> body = replay_finished.finish(replay_finished_info);
+		Replay_Archive::append(replay_archive_path, replay_finished_info, body);
+		replay_finished.start();
+	}
+
+	void record_replay_frame(const Sim_Match& state)
+	{
+		Replay_Frame frame{};
+		frame.x_ball = static_cast<float>(state.ball.x);
+		frame.y_ball = static_cast<float>(state.ball.y);
+		frame.y_player = static_cast<float>(state.left.y);
+		frame.y_opponent = static_cast<float>(state.right.y);
+		frame.score_left = state.score_left;
+		frame.score_right = state.score_right;
+		replay_recorder.record(frame, state.ball.n_hits);
+	}
+
 	void load()
 	{
+		replay_recorder.start();
+
+		background.load();
+
 		cb_quit.load();
 		cb_quit.active = false;
 
@@ -162,10 +280,8 @@ namespace Screen_Main
 
 		textbox.load();
 
+		match = Sim_Match{};
 		player.load();
-		player.set_reaction_time(0.0);
-		player.reset_position();
-
 		opponent.load();
 		if(tournament_mode)
 		{
@@ -175,29 +291,29 @@ namespace Screen_Main
 			switch (progress)
 			{
 			case 0:
-				opponent.change_personality(CALM);
+				match.right.personality = CALM;
 				portrait_right.load(CALM);
 				textbox.change_text({ "ROUND 1","TURTLE: ...HASTE MAKES WASTE." });
 				break;
 
 			case 1:
-				opponent.change_personality(AGGRESSIVE);
+				match.right.personality = AGGRESSIVE;
 				portrait_right.load(AGGRESSIVE);
 				textbox.change_text({ "ROUND 2","PANDA: I AM GOING TO BEAT YOU!!!" });
 				break;
 
 			case 2:
-				opponent.change_personality(STRATEGIC);
+				match.right.personality = STRATEGIC;
 				portrait_right.load(STRATEGIC);
 				textbox.change_text({ "ROUND 3","RAVEN: LET US BEGIN." });
 				break;
 			}
 
-			opponent.change_intelligence(Screen_OptionsTournament::option_intelligence);
+			match.right.intelligence = Screen_OptionsTournament::option_intelligence;
 			if(Screen_OptionsTournament::option_intelligence == DUMB)
-				opponent.set_reaction_time(1.0);
+				match.right.set_reaction_time(1.0);
 			else
-				opponent.set_reaction_time(0.9);
+				match.right.set_reaction_time(0.9);
 
 			textbox.active = true;
 			paused = true;
@@ -206,29 +322,87 @@ namespace Screen_Main
 		{
 			portrait_right.load(Screen_OptionsEndless::option_personality);
 			portrait_right.change_character(Screen_OptionsEndless::option_personality);
-			opponent.change_personality( Screen_OptionsEndless::option_personality );
-			opponent.change_intelligence( Screen_OptionsEndless::option_intelligence );
-			opponent.set_reaction_time( (double)Screen_OptionsEndless::option_t_react );
+			match.right.personality = Screen_OptionsEndless::option_personality;
+			match.right.intelligence = Screen_OptionsEndless::option_intelligence;
+			match.right.set_reaction_time( (double)Screen_OptionsEndless::option_t_react );
 
 			textbox.active = false;
 			paused = false;
 		}
-		opponent.reset_position();
 
 		ball.load();
-		ball.reset();
-		ball.update_graphics();
+		match.ball.reset(match.time());
 
 		score_board.load();
 		score_board.reset_score();
+		show_state();
 	}
 
-	void process_inputs()
+	//Zwei-Spieler-Modus: Beide Schlger werden von Spielern gesteuert, der Gegner ber die Netplay-Session.
+	void load_netplay(Netplay_Session& session)
+	{
+		netplay = &session;
+		recorded_ticks = 0;
+		tournament_mode = false;
+		load();
+
+		match.right = Sim_Schlaeger{ 0.8, PLAYER };
+		portrait_right.change_character();
+		show_state();
+
+		txt_waiting.load();
+		txt_waiting.centre_text_horizontally();
+	}
+
+	//Im Netzwerkmodus luft das Spiel weiter, auch wenn das Quit-Fenster offen ist, da sonst der Gegner warten msste.
+	void process_inputs_netplay()
+	{
+		netplay->poll();
+		if (netplay->has_failed())
+		{
+			std::cerr << "Error: Lost the connection to the opponent!\n";
+			window.is_open = false;
+		}
+
+		if ((keystate[key.KEY_ESCAPE] && !keystate_old[key.KEY_ESCAPE]) || (keystate[key.KEY_PAUSE] && !keystate_old[key.KEY_PAUSE]))
+		{
+			if (cb_quit.active)
+				window.is_open = false;
+			else
+				cb_quit.active = true;
+		}
+
+		if (cb_quit.active)
+		{
+			cb_quit.check_mouse();
+			cb_quit.check_keyboard();
+
+			if (cb_quit.yes_button_pressed())
+				window.is_open = false;
+			else if (cb_quit.no_button_pressed())
+			{
+				cb_quit.active = false;
+				cb_quit.reset_buttons();
+			}
+			input_player = INPUT_NONE;
+		}
+		else
+			input_player = Obj_Schlaeger::read_input();
+	}
+
+	void process_inputs_locked()
 	{
+		if (netplay != nullptr)
+		{
+			process_inputs_netplay();
+			return;
+		}
+
 		if ( (keystate[key.KEY_ESCAPE] && !keystate_old[key.KEY_ESCAPE]) || (keystate[key.KEY_PAUSE] && !keystate_old[key.KEY_PAUSE]))
 		{
 			if (cb_quit.active)
 			{
+				save_replay();
 				menu = SCREEN_START;
 			}
 			else
@@ -245,6 +419,7 @@ namespace Screen_Main
 
 			if (cb_quit.yes_button_pressed())
 			{
+				save_replay();
 				menu = SCREEN_START;
 
 			}
@@ -266,17 +441,17 @@ namespace Screen_Main
 				switch (progress)
 				{
 				case 1:
-					player.reset_position();
-					opponent.reset_position();
-					opponent.change_personality(AGGRESSIVE);
+					match.left.reset_position();
+					match.right.reset_position();
+					match.right.personality = AGGRESSIVE;
 					portrait_right.change_character(AGGRESSIVE);
 					portrait_right.change_to_neutral();
 					break;
 
 				case 2:
-					player.reset_position();
-					opponent.reset_position();
-					opponent.change_personality(STRATEGIC);
+					match.left.reset_position();
+					match.right.reset_position();
+					match.right.personality = STRATEGIC;
 					portrait_right.change_character(STRATEGIC);
 					portrait_right.change_to_neutral();
 					break;
@@ -293,7 +468,7 @@ namespace Screen_Main
 				if ( start1 || start2 || start3 || end )
 				{
 					textbox.centre_text();
-					score_board.reset_score();
+					match.reset_score();
 				}
 				else
 					textbox.uncentre_text();
@@ -301,18 +476,20 @@ namespace Screen_Main
 				if (progress == 3 && textbox.txt_position == 2)
 					portrait_right.change_to_neutral();
 
-				ball.soft_reset();
+				match.ball.soft_reset(match.time());
 			}
+			show_state();
 		}
 		else if(!paused)
 		{
-			player.process_input();
+			input_player = Obj_Schlaeger::read_input();
 
 			if (tournament_mode && progress == 3)
 				menu = SCREEN_START;
 
-			if(tournament_mode && score_board.score_left == max_score && !just_won)
+			if(tournament_mode && match.score_left == max_score && !just_won)
 			{
+				save_replay();
 				just_won = true;
 				paused = true;
 				switch(progress)
@@ -332,8 +509,9 @@ namespace Screen_Main
 				textbox.active = true;
 				progress += 1;
 			}
-			else if(tournament_mode && score_board.score_right == max_score && !just_lost)
+			else if(tournament_mode && match.score_right == max_score && !just_lost)
 			{
+				save_replay();
 				just_lost = true;
 				paused = true;
 				switch (progress)
@@ -354,9 +532,10 @@ namespace Screen_Main
 			}
 			else if (tournament_mode && just_lost == true)
 			{
-				player.reset_position();
-				opponent.reset_position();
-				score_board.reset_score();
+				match.left.reset_position();
+				match.right.reset_position();
+				match.reset_score();
+				show_state();
 				cb_quit.active = true;
 				paused = true;
 				just_lost = false;
@@ -364,22 +543,88 @@ namespace Screen_Main
 		}
 	}
 
-	void update_physics(double dt)
+	void process_inputs()
 	{
-		if(!paused)
 		{
-			//player.react_to_Ball(ball);
-			player.update_physics(dt,player,opponent);
-			opponent.react_to_Ball(ball);
-			opponent.update_physics(dt, player, opponent);
-			ball.update_physics(dt,player,opponent,score_board,portrait_left,portrait_right);
+			std::lock_guard<std::mutex> lock{ match_mutex };
+			process_inputs_locked();
 		}
+		write_finished_replay();
 	}
 
-	void update_graphics(double alpha)
+	//Ein Tick im Simulations-Thread. Sounds und Portraits holt der Haupt-Thread ber pending_events nach.
+	void simulate_tick()
+	{
+		std::lock_guard<std::mutex> lock{ match_mutex };
+		unsigned events{ 0 };
+		if (netplay != nullptr)
+		{
+			//Vorhergesagte Ticks knnen beim Rckspulen noch ndern, darum kommen nur besttigte Ticks ins Replay.
+			netplay->advance(match, input_player, events);
+			for (; recorded_ticks < netplay->confirmed_ticks(); recorded_ticks++)
+				record_replay_frame(netplay->confirmed_state(recorded_ticks, match));
+		}
+		else if(!paused)
+		{
+			events = match.step(input_player, INPUT_NONE);
+			record_replay_frame(match);
+		}
+		pending_events.fetch_or(events, std::memory_order_relaxed);
+
+		//Auch pausiert wird jeden Tick verffentlicht, damit nderungen aus process_inputs nach sptestens einem Tick sichtbar sind.
+		Match_Snapshot& snapshot{ snapshots.write_buffer() };
+		snapshot.match = match;
+		snapshot.time = std::chrono::steady_clock::now();
+		snapshot.connected = (netplay == nullptr || netplay->is_connected());
+		snapshots.publish();
+	}
+
+	//Startet den Simulations-Thread. Vorher darf match ohne match_mutex verndert werden (z.B. in load).
+	void start_simulation()
 	{
-		if(!paused)
+		snapshots.update();	//Ein alter, nie gelesener Snapshot vom letzten Match wird verworfen.
+		snapshot_latest.match = match;
+		snapshot_latest.time = std::chrono::steady_clock::now();
+		snapshot_latest.connected = (netplay == nullptr || netplay->is_connected());
+		snapshot_previous = snapshot_latest;
+		pending_events = 0;
+		simulation.start(Simulation::dt, simulate_tick);
+	}
+
+	void stop_simulation()
+	{
+		simulation.stop();
+	}
+
+	//Interpoliert zwischen den beiden neuesten Snapshots. Gezeichnet wird einen Tick in der Vergangenheit:
+	//So liegt die Zeit fast immer zwischen zwei Snapshots, auch wenn Simulation oder Zeichnen kurz hngen.
+	void update_graphics()
+	{
+		if (snapshots.update())
 		{
+			snapshot_previous = snapshot_latest;
+			snapshot_latest = snapshots.read();
+		}
+		handle_events(pending_events.exchange(0, std::memory_order_relaxed), snapshot_latest.match);
+
+		if(!paused || netplay != nullptr)
+		{
+			using seconds = std::chrono::duration<double>;
+			const double span{ seconds(snapshot_latest.time - snapshot_previous.time).count() };
+			const double since_previous{ seconds(std::chrono::steady_clock::now() - snapshot_previous.time).count() - Simulation::dt };
+			const double alpha{ span > 0.0 ? std::clamp(since_previous / span, 0.0, 1.0) : 1.0 };
+
+			//Die _old-Positionen der Simulation gehren zum Tick direkt davor. Wurden Ticks bersprungen oder stand
+			//die Simulation still, wird stattdessen vom vorherigen Snapshot aus interpoliert.
+			Sim_Match shown{ snapshot_latest.match };
+			if (shown.tick != snapshot_previous.match.tick + 1)
+			{
+				shown.left.y_old = snapshot_previous.match.left.y;
+				shown.right.y_old = snapshot_previous.match.right.y;
+				shown.ball.x_old = snapshot_previous.match.ball.x;
+				shown.ball.y_old = snapshot_previous.match.ball.y;
+			}
+			sync_objects(shown);
 			player.update_graphics(alpha);
 			opponent.update_graphics(alpha);
 			ball.update_graphics(alpha);
@@ -396,8 +641,29 @@ namespace Screen_Main
 		textbox.draw();
 		portrait_left.draw();
 		portrait_right.draw();
+		if (netplay != nullptr && !snapshot_latest.connected)
+			txt_waiting.draw();
 		cb_quit.draw();
 	}
+
+	//Bereite den Bildschirm fr das Abspielen eines Replays vor: Gleicher Gegner wie im aufgenommenen Match.
+	void load_replay(const Replay_Info& info)
+	{
+		Screen_OptionsEndless::option_personality = static_cast<Personality>(info.personality);
+		Screen_OptionsEndless::option_intelligence = static_cast<Intelligence>(info.intelligence);
+		Screen_OptionsEndless::option_t_react = info.t_react_multiplier;
+		tournament_mode = false;
+		load();
+	}
+
+	//Zeige ein Bild aus dem Replay an, anstatt die Physik laufen zu lassen.
+	void show_replay_frame(const Replay_Frame& frame)
+	{
+		player.move_to(frame.y_player);
+		opponent.move_to(frame.y_opponent);
+		ball.move_to(frame.x_ball, frame.y_ball);
+		score_board.set_score(frame.score_left, frame.score_right);
+	}
 }
 
 namespace Screen_Options
@@ -891,4 +1157,51 @@ namespace Screen_OptionsEndless
 		slider_text.draw();
 		slider_treact.draw();
 	}
+}
+
+//Rendert ein Replay aus dem Archiv Bild fr Bild in eine Videodatei. Luft so schnell wie mglich, unabhngig von der Bildrate des Spiels.
+namespace Replay_Export
+{
+	int run(const std::string& archive_path, std::size_t match, const std::string& output_path)
+	{
+		Replay_Archive archive{};
+		std::vector<Replay_Frame> frames;
+		if (!archive.open(archive_path) || match >= archive.size() || !archive.load_frames(match, frames))
+		{
+			std::cerr << "Error: Could not load match " << match << " from " << archive_path << '\n';
+			return -1;
+		}
+
+		window.hide();
+		Screen_Main::load_replay(archive.get_info(match));
+		menu = SCREEN_MAIN;
+
+		Framebuffer framebuffer{};
+		framebuffer.load(window.width(), window.height());
+		Video_Writer video{};
+		if (!video.open(output_path, framebuffer.get_width(), framebuffer.get_height(), target_fps))
+			return -1;
+
+		Stoppuhr stopwatch{};
+		std::vector<uint8_t> pixels;
+		framebuffer.bind();
+		for (const Replay_Frame& frame : frames)
+		{
+			Screen_Main::show_replay_frame(frame);
+			Game::gl.clear();
+			Screen_Main::draw();
+			if (framebuffer.read_pixels(pixels))
+				video.write_frame(pixels);
+			Game::quads.end_frame();
+		}
+		if (framebuffer.finish_reading(pixels))
+			video.write_frame(pixels);
+		framebuffer.unbind();
+		video.close();
+
+		const double t_export{ stopwatch.get_time() };
+		std::cout << "Exported " << video.number_of_frames() << " frames (" << video.number_of_frames() * dt << " s of play) in "
+			<< t_export << " s to " << output_path << '\n';
+		return 0;
+	}
 }
\ No newline at end of file
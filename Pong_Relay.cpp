@@ -0,0 +1,132 @@
+//Relay fr Zuschauer eines Matches auf dem dedizierten Server, nur fr Linux:
+//  g++ -std=c++20 -O2 -pthread Pong_Relay.cpp -o pong_relay
+//Relay:      pong_relay --match 1 [--server 127.0.0.1:7100] [--port 7200] [--ticks-per-packet 4]
+//Zuschauer:  pong_relay --spectators 10000 [--connect 127.0.0.1:7200]
+//Schlechtes Netzwerk, fr Relay oder Zuschauer: --net-out latency=50,jitter=10,loss=2 --net-in loss=2 --net-seed 7
+#include "Pong_Relay.h"
+#include <csignal>
+
+namespace Relay_Tool
+{
+	std::atomic<bool> running{ true };
+
+	void stop(int)
+	{
+		running = false;
+	}
+
+	void print_usage()
+	{
+		std::cerr << "Usage: pong_relay [options]\n"
+			<< "Relay options:\n"
+			<< "  --match ID            Match to relay (required).\n"
+			<< "  --server HOST:PORT    Join port of the server (default 127.0.0.1:7100).\n"
+			<< "  --port PORT           UDP port for spectators (default 7200).\n"
+			<< "  --keyframe-interval N Ticks between two keyframes, at most 31 (default 30).\n"
+			<< "  --ticks-per-packet N  Snapshots bundled into one packet per spectator, at most 6 (default 1).\n"
+			<< "  --report SECONDS      Seconds between two reports, 0 for none (default 5).\n"
+			<< "Spectator options:\n"
+			<< "  --spectators N        Run N synthetic spectators instead of a relay.\n"
+			<< "  --connect HOST:PORT   Relay for the spectators (default 127.0.0.1:7200).\n"
+			<< "Network emulation (relay or spectators):\n"
+			<< "  --net-out SPEC        Conditions for outgoing packets, e.g. latency=50,jitter=10,loss=2,duplicate=1,reorder=5\n"
+			<< "                        (times in ms, probabilities in %).\n"
+			<< "  --net-in SPEC         Conditions for incoming packets.\n"
+			<< "  --net-seed N          Seed for the emulator (default 1).\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Spectator_Relay::Config config{};
+	int n_spectators{ 0 };
+	bool has_match{ false };
+	std::string relay{ "127.0.0.1:7200" };
+	for (int i{ 1 }; i < argc; i++)
+	{
+		const std::string option{ argv[i] };
+		if (option == "--match" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.match))
+				return -1;
+			has_match = true;
+		}
+		else if (option == "--server" && i + 1 < argc)
+			config.server = argv[++i];
+		else if (option == "--port" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.port))
+				return -1;
+		}
+		else if (option == "--keyframe-interval" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.keyframe_interval))
+				return -1;
+		}
+		else if (option == "--ticks-per-packet" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.ticks_per_packet))
+				return -1;
+		}
+		else if (option == "--report" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.report_interval))
+				return -1;
+		}
+		else if (option == "--spectators" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], n_spectators))
+				return -1;
+		}
+		else if (option == "--connect" && i + 1 < argc)
+			relay = argv[++i];
+		else if (option == "--net-out" && i + 1 < argc)
+		{
+			if (!Network_Conditions::parse(argv[++i], config.emulate_out))
+				return -1;
+		}
+		else if (option == "--net-in" && i + 1 < argc)
+		{
+			if (!Network_Conditions::parse(argv[++i], config.emulate_in))
+				return -1;
+		}
+		else if (option == "--net-seed" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.emulate_seed))
+				return -1;
+		}
+		else
+		{
+			Relay_Tool::print_usage();
+			return -1;
+		}
+	}
+
+	std::signal(SIGINT, Relay_Tool::stop);
+	std::signal(SIGTERM, Relay_Tool::stop);
+	initialize_sockets();
+
+	if (n_spectators > 0)
+	{
+		Spectator_Swarm spectators{};
+		if (!spectators.open(relay, n_spectators))
+			return -1;
+		if (config.is_emulated())
+			spectators.emulate(config.emulate_out, config.emulate_in, config.emulate_seed);
+		spectators.run(Relay_Tool::running, config.report_interval);
+	}
+	else if (has_match)
+	{
+		Spectator_Relay spectator_relay{};
+		if (!spectator_relay.open(config))
+			return -1;
+		std::cout << "Relaying match " << config.match << " on port " << config.port << '\n';
+		spectator_relay.run(Relay_Tool::running);
+	}
+	else
+	{
+		Relay_Tool::print_usage();
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,634 @@
+#pragma once
+
+//Relay fr Zuschauer: Empfngt die Snapshots eines Matches vom Server und verteilt sie an viele Zuschauer,
+//damit der Server selbst nur ein Paket pro Tick mehr schicken muss. Nur fr Linux, wie der Server.
+#include "Pong_Server.h"
+#include <memory>
+#include <sys/resource.h>
+
+//Ein fertiges Paket. Wird einmal gebaut und danach nicht mehr verndert, alle Empfnger teilen sich denselben Puffer.
+using Shared_Packet = std::shared_ptr<const std::vector<uint8_t>>;
+
+//Schickt dasselbe Paket an viele Empfnger. Alle Nachrichten von sendmmsg zeigen auf denselben Puffer
+//und direkt auf die Adressen der Empfnger, kopiert wird pro Empfnger nichts.
+class Fanout_Sender
+{
+public:
+	static constexpr int batch_size{ 1024 };	//Mehr nimmt sendmmsg nicht auf einmal (UIO_MAXIOV).
+
+	//socket_batch gehrt zum selben Socket. ber ihn gehen die Pakete, falls er ein Netzwerk emuliert.
+	void attach(int socket_handle, UDP_Batch& socket_batch)
+	{
+		handle = socket_handle;
+		batch = &socket_batch;
+	}
+
+	//Gibt die Anzahl gesendeter Pakete zurck.
+	std::size_t send(const Shared_Packet& packet, const UDP_Address* receivers, std::size_t n_receivers)
+	{
+		//Mit Emulator wird jedes Paket einzeln zurckgehalten, wie alle anderen Pakete des Sockets.
+		if (batch->is_emulated())
+		{
+			for (std::size_t i{ 0 }; i < n_receivers; i++)
+				batch->send(packet->data(), packet->size(), receivers[i]);
+			batch->flush();
+			packets_out += n_receivers;
+			return n_receivers;
+		}
+
+		iovec iov{ const_cast<uint8_t*>(packet->data()), packet->size() };
+		std::size_t sent{ 0 };
+		for (std::size_t start{ 0 }; start < n_receivers; start += batch_size)
+		{
+			const int count{ static_cast<int>(std::min<std::size_t>(batch_size, n_receivers - start)) };
+			for (int i{ 0 }; i < count; i++)
+			{
+				messages[i].msg_hdr = {};
+				messages[i].msg_hdr.msg_name = const_cast<sockaddr_in*>(&receivers[start + i].addr);
+				messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+				messages[i].msg_hdr.msg_iov = &iov;
+				messages[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			int done{ 0 };
+			while (done < count)
+			{
+				int n{ sendmmsg(handle, messages + done, static_cast<unsigned>(count - done), 0) };
+				if (n <= 0)
+					break;	//Socket-Puffer voll: Der Rest verpasst dieses Paket.
+				done += n;
+			}
+			sent += static_cast<std::size_t>(done);
+		}
+		packets_out += sent;
+		return sent;
+	}
+
+	uint64_t packets_out{ 0 };
+
+private:
+	int handle{ -1 };
+	UDP_Batch* batch{ nullptr };
+	mmsghdr messages[batch_size]{};
+};
+
+//Das Relay meldet sich beim Server fr ein Match an (MSG_WATCH), besttigt die Snapshots wie ein Client
+//und baut daraus einen eigenen Strom fr die Zuschauer: Alle keyframe_interval Ticks ein Keyframe,
+//dazwischen Deltas zum letzten Keyframe. So kann jeder Zuschauer jedes Paket dekodieren, solange er den
+//letzten Keyframe hat, auch wenn einzelne Pakete verloren gehen. Neue Zuschauer bekommen sofort den letzten Keyframe.
+class Spectator_Relay
+{
+public:
+	struct Config
+	{
+		std::string server{ "127.0.0.1:7100" };	//Haupt-Port des Servers
+		uint32_t match{ 0 };
+		uint16_t port{ 7200 };					//Port fr die Zuschauer
+		uint32_t keyframe_interval{ 30 };		//Hchstens Snapshot_Codec::max_distance
+		uint32_t ticks_per_packet{ 1 };			//Snapshots pro Paket an die Zuschauer, hchstens Server_Protocol::max_snapshots_per_packet.
+		double subscriber_timeout{ 10.0 };		//Sekunden ohne MSG_SUBSCRIBE, bis ein Zuschauer entfernt wird.
+		double report_interval{ 5.0 };
+		Network_Conditions emulate_out{}, emulate_in{};	//Simuliertes Netzwerk unter beiden Sockets des Relays.
+		uint64_t emulate_seed{ 1 };
+
+		bool is_emulated() const
+		{
+			return emulate_out.is_active() || emulate_in.is_active();
+		}
+	};
+
+	Spectator_Relay() {}
+
+	bool open(const Config& new_config)
+	{
+		config = new_config;
+		config.keyframe_interval = std::clamp(config.keyframe_interval, 1u, Snapshot_Codec::max_distance);
+		config.ticks_per_packet = std::clamp(config.ticks_per_packet, 1u, Server_Protocol::max_snapshots_per_packet);
+		if (!UDP_Address::resolve(config.server, server_address))
+			return false;
+		if (!upstream.open(0) || !downstream.open(config.port))
+			return false;
+
+		const int buffer_size{ 4 << 20 };
+		setsockopt(downstream.native_handle(), SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+		setsockopt(downstream.native_handle(), SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+		upstream_batch.attach(upstream.native_handle());
+		downstream_batch.attach(downstream.native_handle());
+		if (config.is_emulated())
+		{
+			upstream_batch.emulate(config.emulate_out, config.emulate_in, config.emulate_seed);
+			downstream_batch.emulate(config.emulate_out, config.emulate_in, config.emulate_seed + 1);
+		}
+		fanout.attach(downstream.native_handle(), downstream_batch);
+
+		epoll_handle = epoll_create1(0);
+		timer_handle = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+		if (epoll_handle < 0 || timer_handle < 0)
+		{
+			std::cerr << "Error: Could not create epoll or timer!\n";
+			return false;
+		}
+
+		//10 Mal pro Sekunde: Beim Server anmelden, falls noch keine Snapshots kommen, und alte Zuschauer entfernen.
+		//Mit Emulator jeden Tick, damit zurckgehaltene Pakete rechtzeitig weitergehen.
+		itimerspec interval{};
+		interval.it_interval.tv_nsec = config.is_emulated() ? 1000000000L / Simulation::tick_rate : 100000000L;
+		interval.it_value = interval.it_interval;
+		timerfd_settime(timer_handle, 0, &interval, nullptr);
+
+		for (int handle : { upstream.native_handle(), downstream.native_handle(), timer_handle })
+		{
+			epoll_event event{};
+			event.events = EPOLLIN;
+			event.data.fd = handle;
+			epoll_ctl(epoll_handle, EPOLL_CTL_ADD, handle, &event);
+		}
+		return true;
+	}
+
+	//Luft, bis running false wird oder das Match zu Ende ist.
+	void run(const std::atomic<bool>& running)
+	{
+		time_last_report = time_last_snapshot = clock::now() - std::chrono::seconds(1);
+		while (running && !ended)
+		{
+			epoll_event events[3];
+			const auto time_wait{ clock::now() };
+			int n{ epoll_wait(epoll_handle, events, 3, 100) };
+			idle_time += seconds_since(time_wait);
+
+			for (int i{ 0 }; i < n; i++)
+			{
+				if (events[i].data.fd == upstream.native_handle())
+					receive_upstream();
+				else if (events[i].data.fd == downstream.native_handle())
+					receive_downstream();
+				else
+				{
+					uint64_t expirations{ 0 };
+					if (read(timer_handle, &expirations, sizeof(expirations)) == sizeof(expirations))
+					{
+						//Der Emulator gibt zurckgehaltene Pakete nur weiter, wenn jemand fragt.
+						if (config.is_emulated())
+						{
+							receive_upstream();
+							receive_downstream();
+						}
+						maintain();
+					}
+				}
+			}
+
+			if (config.report_interval > 0.0 && seconds_since(time_last_report) >= config.report_interval)
+				report();
+		}
+		if (ended)
+			std::cout << "Match " << config.match << " ended " << score_left << ':' << score_right << '\n';
+	}
+
+	~Spectator_Relay()
+	{
+		if (timer_handle >= 0)
+			::close(timer_handle);
+		if (epoll_handle >= 0)
+			::close(epoll_handle);
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	Config config{};
+	UDP_Address server_address{}, shard_address{};
+	UDP_Socket upstream{}, downstream{};
+	UDP_Batch upstream_batch{}, downstream_batch{};
+	Fanout_Sender fanout{};
+	int epoll_handle{ -1 }, timer_handle{ -1 };
+
+	//Vom Server
+	Snapshot_History history{};
+	uint32_t newest_tick{ 0 };
+	uint16_t n_received{ 0 };
+	bool ended{ false };
+	uint16_t score_left{ 0 }, score_right{ 0 };
+
+	//An die Zuschauer. Mit ticks_per_packet > 1 werden die Snapshots in bundle gesammelt.
+	Snapshot keyframe{};
+	Shared_Packet keyframe_packet{};
+	std::vector<uint8_t> bundle;
+	uint32_t bundle_count{ 0 };
+	std::vector<Snapshot> fresh;	//Seit dem letzten receive_upstream() neu angekommen
+	std::vector<UDP_Address> subscribers;
+	std::vector<clock::time_point> subscribers_last_seen;
+	std::unordered_map<uint64_t, uint32_t> subscriber_index;	//Adresse -> Index in subscribers
+
+	//Statistik seit dem letzten Bericht
+	clock::time_point time_last_report{}, time_last_snapshot{};
+	double idle_time{ 0.0 }, fanout_time{ 0.0 }, fanout_time_max{ 0.0 }, fanout_cpu_time{ 0.0 }, cpu_time_reported{ 0.0 };
+	uint64_t n_snapshots{ 0 }, n_packets{ 0 }, n_keyframes{ 0 }, n_late_joins{ 0 }, bytes_out{ 0 }, packets_out_reported{ 0 };
+
+	static double seconds_since(clock::time_point t)
+	{
+		return std::chrono::duration<double>(clock::now() - t).count();
+	}
+
+	//CPU-Zeit dieses Threads in Sekunden. Anders als die Wanduhr zhlt sie nicht mit, wenn andere Prozesse
+	//(z.B. die Zuschauer beim Messen) auf demselben Kern laufen.
+	static double thread_cpu_time()
+	{
+		timespec t{};
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+		return static_cast<double>(t.tv_sec) + 1e-9 * static_cast<double>(t.tv_nsec);
+	}
+
+	static uint64_t address_key(const UDP_Address& address)
+	{
+		return (static_cast<uint64_t>(address.addr.sin_addr.s_addr) << 16) | address.addr.sin_port;
+	}
+
+	//Kommen mehrere Snapshots auf einmal (etwa weil das Verteilen lnger gedauert hat), wird nur der neuste verteilt.
+	//Die Deltas beziehen sich auf den Keyframe, nicht auf den vorherigen Snapshot, darum darf das Relay Snapshots auslassen.
+	//Mit ticks_per_packet > 1 gehen alle neuen in die Bndel, das kostet kaum zustzliche Pakete.
+	void receive_upstream()
+	{
+		int n;
+		while ((n = upstream_batch.receive()) > 0)
+		{
+			for (int i{ 0 }; i < n; i++)
+			{
+				const uint8_t* packet{ upstream_batch.packet(i) };
+				const std::size_t size{ upstream_batch.size(i) };
+				if (!Server_Protocol::check_header(packet, size, 7) || Packet::read_u32(packet + 3) != config.match)
+					continue;
+
+				if (packet[2] == Server_Protocol::MSG_SNAPSHOT && size > Server_Protocol::size_snapshot_header)
+				{
+					Snapshot snapshot{};
+					if (!Snapshot_Codec::decode(packet + Server_Protocol::size_snapshot_header, size - Server_Protocol::size_snapshot_header, history, snapshot))
+						continue;
+					history.insert(snapshot);
+					n_received++;
+					shard_address = upstream_batch.from(i);
+					time_last_snapshot = clock::now();
+
+					if (snapshot.tick > newest_tick)
+					{
+						newest_tick = snapshot.tick;
+						if (config.ticks_per_packet == 1)
+							fresh.clear();
+						fresh.push_back(snapshot);
+					}
+
+					uint8_t* p{ Server_Protocol::write_header(upstream_batch.prepare(shard_address), Server_Protocol::MSG_ACK) };
+					Packet::write_u32(p, config.match);
+					p[4] = Server_Protocol::side_spectator;
+					Packet::write_u32(p + 5, newest_tick);
+					Server_Protocol::write_u16(p + 9, n_received);
+					upstream_batch.commit(Server_Protocol::size_ack);
+				}
+				else if (packet[2] == Server_Protocol::MSG_END && size >= Server_Protocol::size_end)
+				{
+					//Das Ende geht an alle Zuschauer, ebenfalls als ein gemeinsamer Puffer.
+					score_left = Server_Protocol::read_u16(packet + 7);
+					score_right = Server_Protocol::read_u16(packet + 9);
+					fanout.send(std::make_shared<const std::vector<uint8_t>>(packet, packet + Server_Protocol::size_end), subscribers.data(), subscribers.size());
+					ended = true;
+				}
+			}
+			if (n < UDP_Batch::batch_size)
+				break;
+		}
+		upstream_batch.flush();
+
+		if (!ended)
+		{
+			for (const Snapshot& snapshot : fresh)
+				broadcast(snapshot);
+		}
+		fresh.clear();
+	}
+
+	//Jeder Snapshot wird einmal kodiert. Mit ticks_per_packet > 1 geht er erst mit den nchsten zusammen in einem
+	//MSG_SNAPSHOTS weg: Das Senden kostet pro Paket und Zuschauer, kaum pro Byte, darum teilen sich mehrere Ticks die Kosten.
+	//Die Zuschauer sehen trotzdem jeden Tick, nur um bis zu ticks_per_packet - 1 Ticks spter.
+	void broadcast(const Snapshot& snapshot)
+	{
+		const bool is_keyframe{ keyframe_packet == nullptr || snapshot.tick - keyframe.tick >= config.keyframe_interval };
+
+		std::vector<uint8_t> data(Server_Protocol::size_snapshot_header + 64);
+		uint8_t* p{ Server_Protocol::write_header(data.data(), Server_Protocol::MSG_SNAPSHOT) };
+		Packet::write_u32(p, config.match);
+		p[4] = Server_Protocol::side_spectator;
+		const std::size_t size{ Snapshot_Codec::encode(snapshot, is_keyframe ? nullptr : &keyframe,
+			data.data() + Server_Protocol::size_snapshot_header, data.size() - Server_Protocol::size_snapshot_header) };
+		data.resize(Server_Protocol::size_snapshot_header + size);
+		n_snapshots++;
+
+		if (config.ticks_per_packet > 1)
+		{
+			if (bundle_count == 0)
+			{
+				bundle.assign(Server_Protocol::size_snapshot_header, 0);
+				Packet::write_u32(Server_Protocol::write_header(bundle.data(), Server_Protocol::MSG_SNAPSHOTS), config.match);
+			}
+			bundle.push_back(static_cast<uint8_t>(size));
+			bundle.insert(bundle.end(), data.begin() + Server_Protocol::size_snapshot_header, data.end());
+			bundle_count++;
+		}
+
+		Shared_Packet packet{ std::make_shared<const std::vector<uint8_t>>(std::move(data)) };
+		if (is_keyframe)
+		{
+			keyframe = snapshot;
+			keyframe_packet = packet;
+			n_keyframes++;
+		}
+
+		if (config.ticks_per_packet > 1)
+		{
+			if (bundle_count < config.ticks_per_packet)
+				return;
+			bundle[7] = static_cast<uint8_t>(bundle_count);
+			packet = std::make_shared<const std::vector<uint8_t>>(bundle);
+			bundle_count = 0;
+		}
+
+		const auto t0{ clock::now() };
+		const double cpu0{ thread_cpu_time() };
+		fanout.send(packet, subscribers.data(), subscribers.size());
+		fanout_cpu_time += thread_cpu_time() - cpu0;
+		const double t_fanout{ seconds_since(t0) };
+		fanout_time += t_fanout;
+		fanout_time_max = std::max(fanout_time_max, t_fanout);
+		n_packets++;
+		bytes_out += packet->size() * subscribers.size();
+	}
+
+	void receive_downstream()
+	{
+		int n;
+		while ((n = downstream_batch.receive()) > 0)
+		{
+			for (int i{ 0 }; i < n; i++)
+			{
+				const uint8_t* packet{ downstream_batch.packet(i) };
+				if (!Server_Protocol::check_header(packet, downstream_batch.size(i), Server_Protocol::size_subscribe))
+					continue;
+
+				const UDP_Address& from{ downstream_batch.from(i) };
+				auto found{ subscriber_index.find(address_key(from)) };
+				if (packet[2] == Server_Protocol::MSG_SUBSCRIBE)
+				{
+					if (found != subscriber_index.end())
+					{
+						subscribers_last_seen[found->second] = clock::now();
+						continue;
+					}
+
+					//Neuer Zuschauer: Sofort den letzten Keyframe, die nchsten Deltas beziehen sich darauf.
+					subscriber_index[address_key(from)] = static_cast<uint32_t>(subscribers.size());
+					subscribers.push_back(from);
+					subscribers_last_seen.push_back(clock::now());
+					if (keyframe_packet != nullptr)
+					{
+						fanout.send(keyframe_packet, &subscribers.back(), 1);
+						n_late_joins++;
+					}
+				}
+				else if (packet[2] == Server_Protocol::MSG_UNSUBSCRIBE && found != subscriber_index.end())
+					remove_subscriber(found->second);
+			}
+			if (n < UDP_Batch::batch_size)
+				break;
+		}
+		downstream_batch.flush();
+	}
+
+	void remove_subscriber(uint32_t i)
+	{
+		subscriber_index.erase(address_key(subscribers[i]));
+		if (i + 1 < subscribers.size())
+		{
+			subscribers[i] = subscribers.back();
+			subscribers_last_seen[i] = subscribers_last_seen.back();
+			subscriber_index[address_key(subscribers[i])] = i;
+		}
+		subscribers.pop_back();
+		subscribers_last_seen.pop_back();
+	}
+
+	void maintain()
+	{
+		if (seconds_since(time_last_snapshot) > 1.0)
+		{
+			uint8_t* p{ Server_Protocol::write_header(upstream_batch.prepare(server_address), Server_Protocol::MSG_WATCH) };
+			Packet::write_u32(p, config.match);
+			upstream_batch.commit(Server_Protocol::size_watch);
+			upstream_batch.flush();
+		}
+
+		const auto now{ clock::now() };
+		for (uint32_t i{ 0 }; i < subscribers.size();)
+		{
+			if (std::chrono::duration<double>(now - subscribers_last_seen[i]).count() > config.subscriber_timeout)
+				remove_subscriber(i);
+			else
+				i++;
+		}
+	}
+
+	void report()
+	{
+		const double elapsed{ seconds_since(time_last_report) };
+		const double cpu_time{ thread_cpu_time() };
+		const uint64_t packets_out{ fanout.packets_out - packets_out_reported };
+		printf("[relay] match %u, tick %u, %zu spectators | %.0f snapshots/s, %llu keyframes, %llu late joins"
+			" | out %.0f packets/s, %.2f MB/s | fanout avg %.3f ms, max %.3f ms, CPU %.2f us per packet"
+			" | load %.1f%%, CPU %.1f%% of a core\n",
+			config.match, newest_tick, subscribers.size(), n_snapshots / elapsed,
+			static_cast<unsigned long long>(n_keyframes), static_cast<unsigned long long>(n_late_joins),
+			packets_out / elapsed, bytes_out / elapsed / 1e6,
+			n_packets > 0 ? 1e3 * fanout_time / n_packets : 0.0, 1e3 * fanout_time_max, packets_out > 0 ? 1e6 * fanout_cpu_time / packets_out : 0.0,
+			100.0 * (1.0 - idle_time / elapsed), 100.0 * (cpu_time - cpu_time_reported) / elapsed);
+		fflush(stdout);
+
+		packets_out_reported = fanout.packets_out;
+		cpu_time_reported = cpu_time;
+		idle_time = fanout_time = fanout_time_max = fanout_cpu_time = 0.0;
+		n_snapshots = n_packets = n_keyframes = n_late_joins = bytes_out = 0;
+		time_last_report = clock::now();
+	}
+};
+
+//Synthetische Zuschauer, um das Relay zu testen. Jeder braucht seinen eigenen Socket, weil das Relay
+//die Zuschauer an ihrer Adresse unterscheidet.
+class Spectator_Swarm
+{
+public:
+	Spectator_Swarm() {}
+
+	bool open(const std::string& relay_host_and_port, int n_spectators)
+	{
+		if (!UDP_Address::resolve(relay_host_and_port, relay_address))
+			return false;
+
+		//Fr zehntausend Sockets reicht das Standardlimit an offenen Dateien oft nicht.
+		rlimit limit{};
+		getrlimit(RLIMIT_NOFILE, &limit);
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+
+		epoll_handle = epoll_create1(0);
+		spectators.resize(static_cast<std::size_t>(n_spectators));
+		for (int i{ 0 }; i < n_spectators; i++)
+		{
+			if (!spectators[i].socket.open(0))
+				return false;
+			epoll_event event{};
+			event.events = EPOLLIN;
+			event.data.u32 = static_cast<uint32_t>(i);
+			epoll_ctl(epoll_handle, EPOLL_CTL_ADD, spectators[i].socket.native_handle(), &event);
+		}
+		return true;
+	}
+
+	//Simuliere ein schlechtes Netzwerk unter den Sockets aller Zuschauer, jeder Socket mit eigenem Seed. Nach open().
+	void emulate(const Network_Conditions& out, const Network_Conditions& in, uint64_t seed)
+	{
+		for (std::size_t i{ 0 }; i < spectators.size(); i++)
+			spectators[i].socket.emulate(out, in, seed + i);
+		emulated = true;
+	}
+
+	void run(const std::atomic<bool>& running, double report_interval = 5.0)
+	{
+		auto time_last_report{ clock::now() }, time_last_subscribe{ clock::now() - std::chrono::seconds(10) };
+		auto time_last_poll{ clock::now() };
+		while (running)
+		{
+			//Alle 2 Sekunden anmelden, das hlt die Anmeldung beim Relay am Leben.
+			if (clock::now() - time_last_subscribe > std::chrono::seconds(2))
+			{
+				for (Spectator& spectator : spectators)
+				{
+					if (spectator.time_subscribed == clock::time_point{})
+						spectator.time_subscribed = clock::now();
+					subscribe(spectator, Server_Protocol::MSG_SUBSCRIBE);
+				}
+				time_last_subscribe = clock::now();
+			}
+
+			epoll_event events[256];
+			int n{ epoll_wait(epoll_handle, events, 256, emulated ? 2 : 100) };
+			for (int i{ 0 }; i < n; i++)
+				receive(spectators[events[i].data.u32]);
+
+			//Mit Emulator mssen alle Sockets regelmssig gefragt werden, auch ohne neue Pakete.
+			//Bei zehntausend Sockets aber nur einmal pro Tick.
+			if (emulated && clock::now() - time_last_poll >= std::chrono::microseconds(1000000 / Simulation::tick_rate))
+			{
+				for (Spectator& spectator : spectators)
+					receive(spectator);
+				time_last_poll = clock::now();
+			}
+
+			const double elapsed{ std::chrono::duration<double>(clock::now() - time_last_report).count() };
+			if (report_interval > 0.0 && elapsed >= report_interval)
+			{
+				std::size_t n_watching{ 0 };
+				for (const Spectator& spectator : spectators)
+					n_watching += (spectator.newest_tick != 0);
+				printf("[spectators] %zu of %zu watching | %.0f snapshots/s decoded, %llu without keyframe"
+					" | late join: first picture after avg %.1f ms, max %.1f ms\n",
+					n_watching, spectators.size(), n_decoded / elapsed, static_cast<unsigned long long>(n_missing_keyframe),
+					n_joined > 0 ? 1e3 * join_time / n_joined : 0.0, 1e3 * join_time_max);
+				fflush(stdout);
+				n_decoded = n_missing_keyframe = n_joined = 0;
+				join_time = join_time_max = 0.0;
+				time_last_report = clock::now();
+			}
+		}
+
+		for (Spectator& spectator : spectators)
+			subscribe(spectator, Server_Protocol::MSG_UNSUBSCRIBE);
+	}
+
+	~Spectator_Swarm()
+	{
+		if (epoll_handle >= 0)
+			::close(epoll_handle);
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	struct Spectator
+	{
+		UDP_Socket socket{};
+		Snapshot_History history{};
+		uint32_t newest_tick{ 0 };
+		clock::time_point time_subscribed{};
+	};
+
+	UDP_Address relay_address{};
+	std::deque<Spectator> spectators;
+	int epoll_handle{ -1 };
+	bool emulated{ false };
+	uint64_t n_decoded{ 0 }, n_missing_keyframe{ 0 }, n_joined{ 0 };
+	double join_time{ 0.0 }, join_time_max{ 0.0 };
+
+	void subscribe(Spectator& spectator, Server_Protocol::Message type)
+	{
+		uint8_t packet[Server_Protocol::size_subscribe];
+		Server_Protocol::write_header(packet, type);
+		spectator.socket.send_to(packet, sizeof(packet), relay_address);
+	}
+
+	void receive(Spectator& spectator)
+	{
+		uint8_t packet[UDP_Batch::max_packet_size];
+		UDP_Address from{};
+		int size;
+		while ((size = spectator.socket.receive(packet, sizeof(packet), from)) > 0)
+		{
+			if (!Server_Protocol::check_header(packet, static_cast<std::size_t>(size), Server_Protocol::size_snapshot_header + 1))
+				continue;
+
+			if (packet[2] == Server_Protocol::MSG_SNAPSHOT)
+				decode(spectator, packet + Server_Protocol::size_snapshot_header, size - Server_Protocol::size_snapshot_header);
+			else if (packet[2] == Server_Protocol::MSG_SNAPSHOTS)
+			{
+				//Pro Snapshot ein Byte Grsse, dann der Snapshot. Ein abgeschnittenes Bndel wird nur bis dahin gelesen.
+				int offset{ Server_Protocol::size_snapshot_header };
+				for (uint8_t i{ 0 }; i < packet[7] && offset < size; i++)
+				{
+					const int length{ packet[offset] };
+					if (offset + 1 + length > size)
+						break;
+					decode(spectator, packet + offset + 1, length);
+					offset += 1 + length;
+				}
+			}
+		}
+	}
+
+	void decode(Spectator& spectator, const uint8_t* data, int size)
+	{
+		Snapshot snapshot{};
+		if (!Snapshot_Codec::decode(data, size, spectator.history, snapshot))
+		{
+			n_missing_keyframe++;
+			return;
+		}
+		spectator.history.insert(snapshot);
+		n_decoded++;
+
+		if (spectator.newest_tick == 0)
+		{
+			const double t{ std::chrono::duration<double>(clock::now() - spectator.time_subscribed).count() };
+			join_time += t;
+			join_time_max = std::max(join_time_max, t);
+			n_joined++;
+		}
+		spectator.newest_tick = std::max(spectator.newest_tick, snapshot.tick);
+	}
+};
@@ -0,0 +1,601 @@
+#pragma once
+
+//C++ Libraries. Bewusst ohne SDL, damit auch Kommandozeilen-Tools (Pong_Archive_Tool.cpp) diesen Header nutzen knnen.
+#include <iostream>		//Fr Fehlermeldungen.
+#include <fstream>		//Fr das Archiv.
+#include <string>
+#include <vector>
+#include <cstdint>		//Fr Ganzzahlen mit fester Grsse.
+#include <cstring>		//Fr std::memcpy und std::memcmp.
+#include <cmath>		//Fr std::lround.
+#include <algorithm>	//Fr std::sort, std::lower_bound etc.
+#include <filesystem>	//Um den Ordner fr das Archiv zu erstellen.
+
+//Ein Zeitschritt (dt) einer Aufnahme. Enthlt alles, was man braucht, um das Spiel wieder zu zeichnen.
+struct Replay_Frame
+{
+	float x_ball{}, y_ball{};
+	float y_player{}, y_opponent{};
+	uint16_t score_left{}, score_right{};
+};
+
+//Metadaten eines Matches. Jedes Feld ist im Archiv eine eigene Spalte.
+struct Replay_Info
+{
+	//Gegner (Obj_Schlaeger)
+	uint8_t personality{};
+	uint8_t intelligence{};
+	float t_react_multiplier{ 1.0f };
+
+	//Endstand (Obj_ScoreBoard)
+	uint16_t score_left{}, score_right{};
+
+	uint16_t rally_length{};	//Lngster Ballwechsel, gemessen in Schlgertreffern.
+	uint32_t n_frames{};		//Lnge der Aufnahme in Zeitschritten.
+};
+
+//Kodiert die Frames eines Matches: Positionen werden auf 16 bit quantisiert, gegenber dem letzten Frame
+//als Differenz gespeichert und als Varint geschrieben. Ein Frame braucht so meistens 6-8 Bytes statt 20.
+namespace Replay_Codec
+{
+	//Bereich der Positionen. Der Ball wird whrend der Pause bei y = 2.0 geparkt.
+	constexpr float position_range{ 2.0f };
+
+	inline int32_t quantize(float v)
+	{
+		float t = (std::clamp(v, -position_range, position_range) + position_range) / (2.0f * position_range);
+		return static_cast<int32_t>(std::lround(t * 65535.0f));
+	}
+
+	inline float dequantize(int32_t q)
+	{
+		return static_cast<float>(q) / 65535.0f * (2.0f * position_range) - position_range;
+	}
+
+	inline void write_varint(std::vector<uint8_t>& out, int32_t value)
+	{
+		//Zigzag, damit kleine negative Zahlen auch wenig Platz brauchen.
+		uint32_t v = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+		while (v >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(v | 0x80));
+			v >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(v));
+	}
+
+	inline bool read_varint(const std::vector<uint8_t>& in, std::size_t& pos, int32_t& value)
+	{
+		uint32_t v{ 0 };
+		for (int shift{ 0 }; shift < 35; shift += 7)
+		{
+			if (pos >= in.size())
+				return false;
+			uint8_t byte = in[pos++];
+			v |= static_cast<uint32_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				value = static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline std::vector<uint8_t> encode(const std::vector<Replay_Frame>& frames)
+	{
+		std::vector<uint8_t> out;
+		out.reserve(8 * frames.size() + 8);
+		write_varint(out, static_cast<int32_t>(frames.size()));
+
+		int32_t last[6]{};
+		for (const Replay_Frame& frame : frames)
+		{
+			const int32_t current[6]{ quantize(frame.x_ball), quantize(frame.y_ball), quantize(frame.y_player), quantize(frame.y_opponent),
+				frame.score_left, frame.score_right };
+			for (int i{ 0 }; i < 6; i++)
+			{
+				write_varint(out, current[i] - last[i]);
+				last[i] = current[i];
+			}
+		}
+		return out;
+	}
+
+	inline bool decode(const std::vector<uint8_t>& in, std::vector<Replay_Frame>& frames)
+	{
+		std::size_t pos{ 0 };
+		int32_t n{};
+		if (!read_varint(in, pos, n) || n < 0)
+			return false;
+
+		frames.resize(n);
+		int32_t last[6]{};
+		for (Replay_Frame& frame : frames)
+		{
+			for (int i{ 0 }; i < 6; i++)
+			{
+				int32_t delta{};
+				if (!read_varint(in, pos, delta))
+					return false;
+				last[i] += delta;
+			}
+			frame.x_ball = dequantize(last[0]);
+			frame.y_ball = dequantize(last[1]);
+			frame.y_player = dequantize(last[2]);
+			frame.y_opponent = dequantize(last[3]);
+			frame.score_left = static_cast<uint16_t>(last[4]);
+			frame.score_right = static_cast<uint16_t>(last[5]);
+		}
+		return true;
+	}
+};
+
+//Nimmt ein Match auf und bestimmt dabei den lngsten Ballwechsel.
+class Replay_Recorder
+{
+public:
+	void start()
+	{
+		frames.clear();
+		rally_length = 0;
+		hits_rally_start = 0;
+	}
+
+	//n_hits: Bisherige Anzahl Schlgertreffer des Balls.
+	void record(const Replay_Frame& frame, int n_hits)
+	{
+		//Neuer Ballwechsel zu Beginn und sobald ein Punkt gemacht wurde.
+		if (frames.empty() || frame.score_left != frames.back().score_left || frame.score_right != frames.back().score_right)
+			hits_rally_start = n_hits;
+
+		rally_length = std::max(rally_length, n_hits - hits_rally_start);
+		frames.push_back(frame);
+	}
+
+	bool empty() const
+	{
+		return frames.empty();
+	}
+
+	//Fllt Endstand, Lnge und Ballwechsel in info ein und gibt den kodierten Body zurck.
+	std::vector<uint8_t> finish(Replay_Info& info) const
+	{
+		if (!frames.empty())
+		{
+			info.score_left = frames.back().score_left;
+			info.score_right = frames.back().score_right;
+		}
+		info.rally_length = static_cast<uint16_t>(std::min(rally_length, 0xFFFF));
+		info.n_frames = static_cast<uint32_t>(frames.size());
+		return Replay_Codec::encode(frames);
+	}
+
+private:
+	std::vector<Replay_Frame> frames;
+	int rally_length{ 0 }, hits_rally_start{ 0 };
+};
+
+//Spalten der Metadaten. Eine Zeile pro Match.
+struct Replay_Columns
+{
+	std::vector<uint8_t> personality, intelligence;
+	std::vector<float> t_react_multiplier;
+	std::vector<uint16_t> score_left, score_right, rally_length;
+	std::vector<uint32_t> n_frames, body_size;
+
+	std::size_t size() const
+	{
+		return personality.size();
+	}
+
+	void resize(std::size_t n)
+	{
+		personality.resize(n);
+		intelligence.resize(n);
+		t_react_multiplier.resize(n);
+		score_left.resize(n);
+		score_right.resize(n);
+		rally_length.resize(n);
+		n_frames.resize(n);
+		body_size.resize(n);
+	}
+
+	void push_back(const Replay_Info& info, uint32_t size)
+	{
+		personality.push_back(info.personality);
+		intelligence.push_back(info.intelligence);
+		t_react_multiplier.push_back(info.t_react_multiplier);
+		score_left.push_back(info.score_left);
+		score_right.push_back(info.score_right);
+		rally_length.push_back(info.rally_length);
+		n_frames.push_back(info.n_frames);
+		body_size.push_back(size);
+	}
+
+	Replay_Info get(std::size_t row) const
+	{
+		return { personality[row], intelligence[row], t_react_multiplier[row], score_left[row], score_right[row], rally_length[row], n_frames[row] };
+	}
+
+	//Bytes pro Zeile ber alle Spalten.
+	static constexpr std::size_t row_bytes{ 2 * sizeof(uint8_t) + sizeof(float) + 3 * sizeof(uint16_t) + 2 * sizeof(uint32_t) };
+};
+
+//Suchkriterien. Ein Bereich [min,max] pro Spalte, -1 heisst "egal".
+struct Replay_Query
+{
+	int personality{ -1 }, intelligence{ -1 };
+	float t_react_min{ -1.0e9f }, t_react_max{ 1.0e9f };
+	int score_left_min{ 0 }, score_left_max{ 0xFFFF };
+	int score_right_min{ 0 }, score_right_max{ 0xFFFF };
+	int rally_min{ 0 }, rally_max{ 0xFFFF };
+
+	bool matches(const Replay_Columns& c, std::size_t row) const
+	{
+		return (personality < 0 || c.personality[row] == personality)
+			&& (intelligence < 0 || c.intelligence[row] == intelligence)
+			&& c.t_react_multiplier[row] >= t_react_min && c.t_react_multiplier[row] <= t_react_max
+			&& c.score_left[row] >= score_left_min && c.score_left[row] <= score_left_max
+			&& c.score_right[row] >= score_right_min && c.score_right[row] <= score_right_max
+			&& c.rally_length[row] >= rally_min && c.rally_length[row] <= rally_max;
+	}
+};
+
+//Append-only Archiv fr Replays.
+//Datei:   "PONGARC1", danach beliebig viele Segmente. Jedes append() schreibt ein neues Segment ans Ende.
+//Segment: Segment_Header | Spalten | sortierter Index | Bodies
+//Die Spalten liegen vor den Bodies, damit man beim Suchen nur die Metadaten lesen muss und die Bodies berspringen kann.
+//Der Index enthlt die Zeilen des Segments sortiert nach (personality, intelligence, t_react_multiplier).
+//Zahlen werden in der Byte-Reihenfolge des Rechners (little-endian) geschrieben.
+class Replay_Archive
+{
+public:
+	static constexpr char file_magic[8]{ 'P','O','N','G','A','R','C','1' };
+	static constexpr char segment_magic[4]{ 'S','E','G','1' };
+
+	struct Segment_Header
+	{
+		char magic[4];
+		uint32_t n_rows;
+		uint64_t body_bytes;
+	};
+
+	//Schreibt mehrere Matches als ein Segment ans Ende des Archivs.
+	static bool append(const std::filesystem::path& path, const std::vector<Replay_Info>& infos, const std::vector<std::vector<uint8_t>>& bodies)
+	{
+		if (infos.empty() || infos.size() != bodies.size())
+			return false;
+
+		std::error_code error;
+		if (path.has_parent_path())
+			std::filesystem::create_directories(path.parent_path(), error);
+		bool new_file = !std::filesystem::exists(path, error) || std::filesystem::file_size(path, error) == 0;
+
+		std::ofstream file{ path, std::ios::binary | std::ios::app };
+		if (!file)
+		{
+			std::cerr << "Error: Could not open replay archive! " << path.string() << '\n';
+			return false;
+		}
+		if (new_file)
+			file.write(file_magic, sizeof(file_magic));
+
+		//Spalten
+		Replay_Columns columns{};
+		Segment_Header header{ {}, static_cast<uint32_t>(infos.size()), 0 };
+		std::memcpy(header.magic, segment_magic, sizeof(segment_magic));
+		for (std::size_t i{ 0 }; i < infos.size(); i++)
+		{
+			columns.push_back(infos[i], static_cast<uint32_t>(bodies[i].size()));
+			header.body_bytes += bodies[i].size();
+		}
+
+		//Sortierter Index
+		std::vector<uint32_t> index(infos.size());
+		for (uint32_t i{ 0 }; i < index.size(); i++)
+			index[i] = i;
+		std::sort(index.begin(), index.end(), [&columns](uint32_t a, uint32_t b) { return index_less(columns, a, b); });
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		write_columns(file, columns);
+		write_column(file, index);
+		for (const std::vector<uint8_t>& body : bodies)
+			file.write(reinterpret_cast<const char*>(body.data()), body.size());
+
+		if (!file)
+		{
+			std::cerr << "Error: Could not write to replay archive! " << path.string() << '\n';
+			return false;
+		}
+		return true;
+	}
+
+	static bool append(const std::filesystem::path& path, const Replay_Info& info, const std::vector<uint8_t>& body)
+	{
+		return append(path, std::vector<Replay_Info>{ info }, std::vector<std::vector<uint8_t>>{ body });
+	}
+
+	//Liest nur die Metadaten aller Segmente ein. Die Bodies werden bersprungen.
+	bool open(const std::filesystem::path& archive_path)
+	{
+		path = archive_path;
+		columns = {};
+		segments.clear();
+
+		std::ifstream file{ path, std::ios::binary };
+		char magic[sizeof(file_magic)]{};
+		if (!file || !file.read(magic, sizeof(magic)) || std::memcmp(magic, file_magic, sizeof(file_magic)) != 0)
+		{
+			std::cerr << "Error: Not a replay archive! " << path.string() << '\n';
+			return false;
+		}
+
+		std::error_code error;
+		const uint64_t file_size = std::filesystem::file_size(path, error);
+		uint64_t position{ sizeof(file_magic) };
+		Segment_Header header{};
+		while (file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		{
+			const uint64_t meta_bytes = header.n_rows * (Replay_Columns::row_bytes + sizeof(uint32_t));
+			const uint64_t segment_end = position + sizeof(header) + meta_bytes + header.body_bytes;
+
+			//Ein unvollstndiges Segment am Ende (z.B. Absturz beim Schreiben) zhlt nicht.
+			if (std::memcmp(header.magic, segment_magic, sizeof(segment_magic)) != 0 || segment_end > file_size)
+			{
+				std::cerr << "Warning: Ignoring incomplete segment at the end of the replay archive.\n";
+				break;
+			}
+
+			Segment segment{};
+			segment.first_row = columns.size();
+			segment.n_rows = header.n_rows;
+			segment.body_offset = segment_end - header.body_bytes;
+			segment.body_bytes = header.body_bytes;
+			segment.index.resize(header.n_rows);
+			if (!read_columns(file, columns, header.n_rows) || !read_column(file, segment.index.data(), header.n_rows))
+			{
+				columns.resize(segment.first_row);
+				break;
+			}
+
+			//Offsets der Bodies innerhalb des Segments.
+			segment.body_offsets.resize(header.n_rows);
+			uint64_t offset{ 0 };
+			for (uint32_t i{ 0 }; i < header.n_rows; i++)
+			{
+				segment.body_offsets[i] = offset;
+				offset += columns.body_size[segment.first_row + i];
+			}
+
+			segments.push_back(std::move(segment));
+			file.seekg(header.body_bytes, std::ios::cur);
+			position = segment_end;
+		}
+		return true;
+	}
+
+	std::size_t size() const
+	{
+		return columns.size();
+	}
+
+	std::size_t number_of_segments() const
+	{
+		return segments.size();
+	}
+
+	const Replay_Columns& get_columns() const
+	{
+		return columns;
+	}
+
+	Replay_Info get_info(std::size_t row) const
+	{
+		return columns.get(row);
+	}
+
+	//Gibt die Nummern aller passenden Matches zurck. Falls personality gesetzt ist, wird ber den sortierten Index
+	//nur der passende Bereich durchsucht, ansonsten werden die Spalten ganz durchlaufen.
+	std::vector<std::size_t> query(const Replay_Query& q) const
+	{
+		std::vector<std::size_t> result;
+		for (const Segment& segment : segments)
+		{
+			if (q.personality >= 0)
+			{
+				//Vergleicht eine Zeile mit dem Suchschlssel (personality, intelligence, t_react_min).
+				//Ist intelligence nicht gesetzt, wird nur nach personality gesucht.
+				const bool by_intelligence = q.intelligence >= 0;
+				auto key_less = [this, &segment, by_intelligence](uint32_t row, const Replay_Query& key)
+				{
+					std::size_t r = segment.first_row + row;
+					if (columns.personality[r] != key.personality)
+						return columns.personality[r] < key.personality;
+					if (!by_intelligence)
+						return false;
+					if (columns.intelligence[r] != key.intelligence)
+						return columns.intelligence[r] < key.intelligence;
+					return columns.t_react_multiplier[r] < key.t_react_min;
+				};
+				auto it = std::lower_bound(segment.index.begin(), segment.index.end(), q, key_less);
+				for (; it != segment.index.end(); ++it)
+				{
+					std::size_t r = segment.first_row + *it;
+					if (columns.personality[r] != q.personality)
+						break;
+					if (by_intelligence && (columns.intelligence[r] != q.intelligence || columns.t_react_multiplier[r] > q.t_react_max))
+						break;
+					if (q.matches(columns, r))
+						result.push_back(r);
+				}
+			}
+			else
+			{
+				for (std::size_t r{ segment.first_row }; r < segment.first_row + segment.n_rows; r++)
+				{
+					if (q.matches(columns, r))
+						result.push_back(r);
+				}
+			}
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+	//Liest und dekodiert die Frames eines einzelnen Matches.
+	bool load_frames(std::size_t row, std::vector<Replay_Frame>& frames) const
+	{
+		std::vector<uint8_t> body;
+		return load_body(row, body) && Replay_Codec::decode(body, frames);
+	}
+
+	bool load_body(std::size_t row, std::vector<uint8_t>& body) const
+	{
+		const Segment* segment = find_segment(row);
+		if (segment == nullptr)
+			return false;
+
+		std::ifstream file{ path, std::ios::binary };
+		body.resize(columns.body_size[row]);
+		file.seekg(segment->body_offset + segment->body_offsets[row - segment->first_row]);
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(body.data()), body.size()));
+	}
+
+	//Schreibt alle Segmente zu einem einzigen zusammen, damit Suchen nicht ber viele kleine Segmente gehen mssen.
+	//Die Metadaten sind schon im Speicher; die Bodies werden Segment fr Segment direkt aus dem Archiv umkopiert.
+	//Danach wird das neue Archiv wieder eingelesen.
+	bool compact()
+	{
+		if (size() == 0)
+			return true;
+
+		std::filesystem::path temp_path{ path };
+		temp_path += ".tmp";
+		std::ofstream output{ temp_path, std::ios::binary | std::ios::trunc };
+		std::ifstream input{ path, std::ios::binary };
+		if (!output || !input)
+		{
+			std::cerr << "Error: Could not open replay archive for compacting! " << path.string() << '\n';
+			return false;
+		}
+
+		Segment_Header header{ {}, static_cast<uint32_t>(size()), 0 };
+		std::memcpy(header.magic, segment_magic, sizeof(segment_magic));
+		for (const Segment& segment : segments)
+			header.body_bytes += segment.body_bytes;
+
+		std::vector<uint32_t> index(size());
+		for (uint32_t i{ 0 }; i < index.size(); i++)
+			index[i] = i;
+		std::sort(index.begin(), index.end(), [this](uint32_t a, uint32_t b) { return index_less(columns, a, b); });
+
+		output.write(file_magic, sizeof(file_magic));
+		output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		write_columns(output, columns);
+		write_column(output, index);
+
+		//Die Bodies eines Segments liegen am Stck und in der Reihenfolge der Zeilen.
+		std::vector<char> buffer(1 << 16);
+		for (const Segment& segment : segments)
+		{
+			input.seekg(segment.body_offset);
+			for (uint64_t remaining{ segment.body_bytes }; remaining > 0;)
+			{
+				const std::size_t n = static_cast<std::size_t>(std::min<uint64_t>(remaining, buffer.size()));
+				if (!input.read(buffer.data(), n))
+				{
+					std::cerr << "Error: Could not read replay archive! " << path.string() << '\n';
+					return false;
+				}
+				output.write(buffer.data(), n);
+				remaining -= n;
+			}
+		}
+
+		input.close();
+		output.close();
+		if (!output)
+		{
+			std::cerr << "Error: Could not write to replay archive! " << temp_path.string() << '\n';
+			return false;
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temp_path, path, error);
+		if (error)
+			return false;
+		return open(path);
+	}
+
+private:
+	struct Segment
+	{
+		std::size_t first_row{}, n_rows{};
+		uint64_t body_offset{}, body_bytes{};
+		std::vector<uint32_t> index;
+		std::vector<uint64_t> body_offsets;
+	};
+
+	std::filesystem::path path;
+	Replay_Columns columns;
+	std::vector<Segment> segments;
+
+	const Segment* find_segment(std::size_t row) const
+	{
+		for (const Segment& segment : segments)
+		{
+			if (segment.first_row <= row && row < segment.first_row + segment.n_rows)
+				return &segment;
+		}
+		return nullptr;
+	}
+
+	static bool index_less(const Replay_Columns& c, uint32_t a, uint32_t b)
+	{
+		if (c.personality[a] != c.personality[b])
+			return c.personality[a] < c.personality[b];
+		if (c.intelligence[a] != c.intelligence[b])
+			return c.intelligence[a] < c.intelligence[b];
+		return c.t_react_multiplier[a] < c.t_react_multiplier[b];
+	}
+
+	template<typename T>
+	static void write_column(std::ofstream& file, const std::vector<T>& column)
+	{
+		file.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+	}
+
+	template<typename T>
+	static bool read_column(std::ifstream& file, T* data, std::size_t n)
+	{
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(data), n * sizeof(T)));
+	}
+
+	static void write_columns(std::ofstream& file, const Replay_Columns& c)
+	{
+		write_column(file, c.personality);
+		write_column(file, c.intelligence);
+		write_column(file, c.t_react_multiplier);
+		write_column(file, c.score_left);
+		write_column(file, c.score_right);
+		write_column(file, c.rally_length);
+		write_column(file, c.n_frames);
+		write_column(file, c.body_size);
+	}
+
+	//Hngt n Zeilen an die bestehenden Spalten an.
+	static bool read_columns(std::ifstream& file, Replay_Columns& c, std::size_t n)
+	{
+		std::size_t first = c.size();
+		c.resize(first + n);
+		return read_column(file, c.personality.data() + first, n)
+			&& read_column(file, c.intelligence.data() + first, n)
+			&& read_column(file, c.t_react_multiplier.data() + first, n)
+			&& read_column(file, c.score_left.data() + first, n)
+			&& read_column(file, c.score_right.data() + first, n)
+			&& read_column(file, c.rally_length.data() + first, n)
+			&& read_column(file, c.n_frames.data() + first, n)
+			&& read_column(file, c.body_size.data() + first, n);
+	}
+};
@@ -0,0 +1,194 @@
+//Dedizierter Pong-Server ohne SDL oder OpenGL, nur fr Linux:
+//  g++ -std=c++20 -O2 -pthread Pong_Server.cpp -o pong_server
+//Server:  pong_server [--port 7100] [--max-score 11] [--report 5]
+//Bots:    pong_server --bots 2000 [--bot-threads 2] [--connect 127.0.0.1:7100]
+//Matchmaking unter Last: pong_server --arrivals 100000 [--connect 127.0.0.1:7100]
+//Schlechtes Netzwerk, fr Server oder Bots: --net-out latency=50,jitter=10,loss=2 --net-in loss=2 --net-seed 7
+#include "Pong_Server.h"
+#include <csignal>
+#include <cstdlib>
+#include <new>
+
+//Zhlt jede Allokation fr die Metriken (Pong_Metrics.h), pro Thread.
+//noinline: Sonst sieht GCC malloc und free nicht als Paar und warnt bei jedem Container.
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+	Allocation_Counter::count(size);
+	if (void* memory{ std::malloc(size ? size : 1) })
+		return memory;
+	throw std::bad_alloc{};
+}
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+namespace Server_Tool
+{
+	std::atomic<bool> running{ true };
+
+	void stop(int)
+	{
+		running = false;
+	}
+
+	void print_usage()
+	{
+		std::cerr << "Usage: pong_server [options]\n"
+			<< "Server options:\n"
+			<< "  --port PORT         UDP port for joining (default 7100). Shard i uses PORT+1+i.\n"
+			<< "  --shards N          Number of shards, each on its own thread and core (default: one per core).\n"
+			<< "  --max-score N       A match ends when one side has N points (default 11).\n"
+			<< "  --client-bandwidth B Snapshot budget per client in bytes/s, 0 to adapt to loss only (default 0).\n"
+			<< "  --report SECONDS    Seconds between two reports, 0 for none (default 5).\n"
+			<< "  --rebalance LOAD    Move matches when two shards differ by more than LOAD (default 0.15).\n"
+			<< "  --metrics PORT      Serve Prometheus metrics on http://127.0.0.1:PORT/metrics (default: off).\n"
+			<< "Bot options:\n"
+			<< "  --bots N            Run N synthetic clients instead of a server.\n"
+			<< "  --connect HOST:PORT Server for the bots (default 127.0.0.1:7100).\n"
+			<< "  --bots-per-socket N Bots sharing one UDP socket (default 256).\n"
+			<< "  --bot-threads N     Threads the bots are split across (default 1).\n"
+			<< "  --arrivals N        Instead of bots, N new players per minute with random rating and latency,\n"
+			<< "                      who leave as soon as they are matched, to measure the matchmaking.\n"
+			<< "Network emulation (server or bots):\n"
+			<< "  --net-out SPEC      Conditions for outgoing packets, e.g. latency=50,jitter=10,loss=2,duplicate=1,reorder=5\n"
+			<< "                      (times in ms, probabilities in %).\n"
+			<< "  --net-in SPEC       Conditions for incoming packets.\n"
+			<< "  --net-seed N        Seed for the emulator (default 1).\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Server_Config config{};
+	int n_bots{ 0 }, bots_per_socket{ 256 }, bot_threads{ 1 };
+	double arrivals{ 0.0 };
+	std::string server{ "127.0.0.1:7100" };
+	for (int i{ 1 }; i < argc; i++)
+	{
+		const std::string option{ argv[i] };
+		if (option == "--port" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.port))
+				return -1;
+		}
+		else if (option == "--shards" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.shards))
+				return -1;
+		}
+		else if (option == "--max-score" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.max_score))
+				return -1;
+		}
+		else if (option == "--client-bandwidth" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.client_bandwidth))
+				return -1;
+		}
+		else if (option == "--report" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.report_interval))
+				return -1;
+		}
+		else if (option == "--rebalance" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.rebalance_threshold))
+				return -1;
+		}
+		else if (option == "--metrics" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.metrics_port))
+				return -1;
+		}
+		else if (option == "--bots" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], n_bots))
+				return -1;
+		}
+		else if (option == "--connect" && i + 1 < argc)
+			server = argv[++i];
+		else if (option == "--bots-per-socket" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], bots_per_socket))
+				return -1;
+			bots_per_socket = std::max(1, bots_per_socket);
+		}
+		else if (option == "--bot-threads" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], bot_threads))
+				return -1;
+			bot_threads = std::max(1, bot_threads);
+		}
+		else if (option == "--arrivals" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], arrivals))
+				return -1;
+		}
+		else if (option == "--net-out" && i + 1 < argc)
+		{
+			if (!Network_Conditions::parse(argv[++i], config.emulate_out))
+				return -1;
+		}
+		else if (option == "--net-in" && i + 1 < argc)
+		{
+			if (!Network_Conditions::parse(argv[++i], config.emulate_in))
+				return -1;
+		}
+		else if (option == "--net-seed" && i + 1 < argc)
+		{
+			if (!parse_number(argv[++i], config.emulate_seed))
+				return -1;
+		}
+		else
+		{
+			Server_Tool::print_usage();
+			return -1;
+		}
+	}
+
+	std::signal(SIGINT, Server_Tool::stop);
+	std::signal(SIGTERM, Server_Tool::stop);
+	initialize_sockets();
+
+	if (arrivals > 0.0)
+	{
+		Join_Generator generator{};
+		if (!generator.open(server, arrivals))
+			return -1;
+		generator.run(Server_Tool::running, config.report_interval);
+	}
+	else if (n_bots > 0)
+	{
+		//Jeder Thread hat seinen eigenen Schwarm. Nur der erste schreibt Berichte.
+		std::deque<Bot_Swarm> swarms(static_cast<std::size_t>(bot_threads));
+		for (int i{ 0 }; i < bot_threads; i++)
+		{
+			if (!swarms[i].open(server, n_bots / bot_threads + (i < n_bots % bot_threads), bots_per_socket))
+				return -1;
+			if (config.is_emulated())
+				swarms[i].emulate(config.emulate_out, config.emulate_in, config.emulate_seed + 1000 * static_cast<uint64_t>(i));
+		}
+		std::vector<std::thread> threads;
+		for (int i{ 0 }; i < bot_threads; i++)
+			threads.emplace_back([&swarms, &config, i]() { swarms[i].run(Server_Tool::running, i == 0 ? config.report_interval : 0.0); });
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+	else
+	{
+		Match_Server match_server{};
+		if (!match_server.open(config))
+			return -1;
+		std::cout << "Pong server listening on port " << config.port << ", " << (config.shards ? config.shards : std::thread::hardware_concurrency()) << " shards\n";
+		match_server.run(Server_Tool::running);
+	}
+	return 0;
+}
@@ -0,0 +1,1741 @@
+#pragma once
+
+//Dedizierter Server: Hostet viele Matches gleichzeitig in einem Prozess, ohne SDL oder OpenGL.
+//Der Server ist autoritativ: Die Clients schicken nur ihren Input, der Server simuliert und schickt den Zustand zurck.
+//Nur fr Linux (epoll, timerfd, recvmmsg/sendmmsg).
+//Die Matches sind auf Shards verteilt, einen pro Kern. Jeder Shard hat seinen eigenen Thread, Socket und Takt.
+
+#include "Pong_Simulation.h"
+#include "Pong_Network.h"
+#include "Pong_Snapshot.h"
+#include "Pong_Matchmaking.h"
+#include "Pong_Metrics.h"
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sched.h>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <random>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <pthread.h>
+
+//Pakete zwischen Server und Clients. Alle beginnen mit Magic und Typ.
+namespace Server_Protocol
+{
+	constexpr uint8_t magic[2]{ 'P', 'S' };
+
+	enum Message : uint8_t
+	{
+		MSG_JOIN = 1,		//Client -> Server: Nonce, optional Rating und Latenz zum Server in ms
+		MSG_JOINED = 2,		//Server -> Client: Nonce, Match, Seite, Token
+		MSG_INPUT = 3,		//Client -> Server: Match, Seite, Token, Sequenz, Input, neuster empfangener Snapshot, Anzahl empfangene Snapshots
+		MSG_SNAPSHOT = 4,	//Server -> Client: Match, Seite, Snapshot (Pong_Snapshot.h)
+		MSG_END = 5,		//Server -> Client: Match, Punktestand
+		MSG_LEAVE = 6,		//Client -> Server: Match, Seite, Token
+		MSG_WATCH = 7,		//Relay -> Server: Match. Der Server schickt dem Relay danach die Snapshots des Matches.
+		MSG_ACK = 8,		//Relay -> Server: Match, Seite, neuster empfangener Snapshot, Anzahl empfangene Snapshots
+		MSG_SUBSCRIBE = 9,	//Zuschauer -> Relay, alle paar Sekunden, um angemeldet zu bleiben.
+		MSG_UNSUBSCRIBE = 10,	//Zuschauer -> Relay
+		MSG_SNAPSHOTS = 11,	//Relay -> Zuschauer: Match, Anzahl, dann pro Snapshot seine Grsse (1 Byte) und der Snapshot.
+	};
+
+	constexpr uint8_t side_spectator{ 2 };	//Seite in den Snapshots fr Relays und Zuschauer.
+
+	inline uint8_t* write_header(uint8_t* out, Message type)
+	{
+		out[0] = magic[0];
+		out[1] = magic[1];
+		out[2] = type;
+		return out + 3;
+	}
+
+	inline bool check_header(const uint8_t* in, std::size_t size, std::size_t min_size)
+	{
+		return size >= min_size && in[0] == magic[0] && in[1] == magic[1];
+	}
+
+	inline void write_u16(uint8_t* out, uint16_t value)
+	{
+		out[0] = static_cast<uint8_t>(value);
+		out[1] = static_cast<uint8_t>(value >> 8);
+	}
+
+	inline uint16_t read_u16(const uint8_t* in)
+	{
+		return static_cast<uint16_t>(in[0] | (in[1] << 8));
+	}
+
+	constexpr std::size_t size_join{ 7 }, size_joined{ 16 }, size_input{ 23 }, size_snapshot_header{ 8 }, size_end{ 11 }, size_leave{ 12 };
+	constexpr std::size_t size_watch{ 7 }, size_ack{ 14 }, size_subscribe{ 3 }, size_join_rated{ 11 };
+	constexpr uint16_t default_rating{ 1500 };	//Fr JOIN ohne Rating.
+	constexpr uint32_t max_snapshots_per_packet{ 6 };	//Fr MSG_SNAPSHOTS.
+}
+
+//Sammelt Pakete, um viele mit einem Systemaufruf zu empfangen oder zu senden (recvmmsg/sendmmsg).
+class UDP_Batch
+{
+public:
+	static constexpr int batch_size{ 64 };
+	static constexpr std::size_t max_packet_size{ 512 };
+
+	UDP_Batch() {}
+
+	void attach(int socket_handle)
+	{
+		handle = socket_handle;
+		for (int i{ 0 }; i < batch_size; i++)
+		{
+			in_iov[i] = { in_buffers[i], max_packet_size };
+			out_iov[i] = { out_buffers[i], 0 };
+		}
+	}
+
+	//Simuliere ein schlechtes Netzwerk unter diesem Socket (siehe Network_Emulator). Zurckgehaltene Pakete werden nur
+	//bei receive() und flush() weitergegeben, die Verzgerung ist also so fein wie die Aufrufe.
+	void emulate(const Network_Conditions& out, const Network_Conditions& in, uint64_t seed)
+	{
+		emulator = std::make_unique<Network_Emulator>(out, in, seed);
+	}
+
+	bool is_emulated() const
+	{
+		return emulator != nullptr;
+	}
+
+	const Network_Emulator* get_emulator() const
+	{
+		return emulator.get();
+	}
+
+	//Empfange bis zu batch_size Pakete. Gibt die Anzahl zurck.
+	int receive()
+	{
+		if (!emulator)
+			return receive_now();
+
+		//Alles vom Socket in den Emulator, dann nur die flligen Pakete in die Puffer.
+		int n;
+		while ((n = receive_now()) > 0)
+			for (int i{ 0 }; i < n; i++)
+				emulator->arrive(in_buffers[i], in_messages[i].msg_len, in_addresses[i]);
+		int count{ 0 };
+		while (count < batch_size)
+		{
+			const int size{ emulator->next_incoming(in_buffers[count], max_packet_size, in_addresses[count]) };
+			if (size < 0)
+				break;
+			in_messages[count].msg_len = static_cast<unsigned>(size);
+			count++;
+		}
+		return count;
+	}
+
+	const uint8_t* packet(int i) const
+	{
+		return in_buffers[i];
+	}
+
+	std::size_t size(int i) const
+	{
+		return in_messages[i].msg_len;
+	}
+
+	const UDP_Address& from(int i) const
+	{
+		return in_addresses[i];
+	}
+
+	//Gibt einen Puffer fr das nchste Paket an to zurck. Danach commit() mit der Grsse aufrufen.
+	uint8_t* prepare(const UDP_Address& to)
+	{
+		if (n_out == batch_size)
+			flush();
+		out_addresses[n_out] = to;
+		return out_buffers[n_out];
+	}
+
+	void commit(std::size_t size)
+	{
+		out_iov[n_out].iov_len = size;
+		n_out++;
+	}
+
+	void send(const uint8_t* data, std::size_t size, const UDP_Address& to)
+	{
+		memcpy(prepare(to), data, size);
+		commit(size);
+	}
+
+	void flush()
+	{
+		if (emulator)
+		{
+			//Die neuen Pakete zurckhalten und statt ihnen die flligen senden.
+			for (int i{ 0 }; i < n_out; i++)
+				emulator->send(out_buffers[i], out_iov[i].iov_len, out_addresses[i]);
+			n_out = 0;
+			int size;
+			while ((size = emulator->next_outgoing(out_buffers[n_out], max_packet_size, out_addresses[n_out])) >= 0)
+			{
+				out_iov[n_out].iov_len = static_cast<std::size_t>(size);
+				if (++n_out == batch_size)
+					send_now();
+			}
+		}
+		send_now();
+	}
+
+	uint64_t packets_in{ 0 }, packets_out{ 0 };
+
+private:
+	int handle{ -1 };
+	int n_out{ 0 };
+
+	mmsghdr in_messages[batch_size]{}, out_messages[batch_size]{};
+	iovec in_iov[batch_size]{}, out_iov[batch_size]{};
+	UDP_Address in_addresses[batch_size]{}, out_addresses[batch_size]{};
+	uint8_t in_buffers[batch_size][max_packet_size]{}, out_buffers[batch_size][max_packet_size]{};
+	std::unique_ptr<Network_Emulator> emulator;
+
+	int receive_now()
+	{
+		for (int i{ 0 }; i < batch_size; i++)
+		{
+			in_messages[i].msg_hdr = {};
+			in_messages[i].msg_hdr.msg_name = &in_addresses[i].addr;
+			in_messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			in_messages[i].msg_hdr.msg_iov = &in_iov[i];
+			in_messages[i].msg_hdr.msg_iovlen = 1;
+		}
+		int n{ recvmmsg(handle, in_messages, batch_size, MSG_DONTWAIT, nullptr) };
+		if (n < 0)
+			return 0;
+		packets_in += static_cast<uint64_t>(n);
+		return n;
+	}
+
+	void send_now()
+	{
+		int sent{ 0 };
+		while (sent < n_out)
+		{
+			for (int i{ sent }; i < n_out; i++)
+			{
+				out_messages[i].msg_hdr = {};
+				out_messages[i].msg_hdr.msg_name = &out_addresses[i].addr;
+				out_messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+				out_messages[i].msg_hdr.msg_iov = &out_iov[i];
+				out_messages[i].msg_hdr.msg_iovlen = 1;
+			}
+			int n{ sendmmsg(handle, out_messages + sent, static_cast<unsigned>(n_out - sent), 0) };
+			if (n <= 0)
+				break;	//Socket-Puffer voll: Die restlichen Pakete gehen verloren, wie bei UDP blich.
+			sent += n;
+		}
+		packets_out += static_cast<uint64_t>(sent);
+		n_out = 0;
+	}
+};
+
+//Ein Match auf dem Server mit seinen zwei Clients. Trivial kopierbar, damit es als Schnappschuss zwischen Shards wandern kann.
+struct Server_Match
+{
+	struct Client
+	{
+		UDP_Address address{};
+		uint32_t nonce{ 0 }, token{ 0 }, last_sequence{ 0 };
+		uint8_t input{ INPUT_NONE };
+		std::chrono::steady_clock::time_point last_seen{};
+		uint32_t acked_tick{ 0 };	//Neuster Snapshot, den der Client besttigt hat: Baseline fr die Deltas.
+		Snapshot_Rate rate{};
+	};
+
+	uint32_t id{ 0 };
+	Sim_Match sim{};
+	Client clients[2]{};
+	Snapshot_History history{};	//Gesendete Snapshots
+
+	//Ein Relay, das die Snapshots an Zuschauer weiterverteilt (Pong_Relay.h). Braucht kein Token, steuert ja nichts.
+	bool watched{ false };
+	Client watcher{};
+
+	//Rechenzeit der Ticks seit dem letzten Bericht.
+	double tick_time_sum{ 0.0 }, tick_time_max{ 0.0 };
+	uint32_t n_ticks{ 0 };
+};
+
+//Briefkasten zwischen zwei Threads. Die Threads teilen sonst keine vernderlichen Daten:
+//Ein Match gehrt immer genau einem Shard und wird nur als Kopie verschickt.
+template<typename T>
+class Mailbox
+{
+public:
+	void push(const T& message)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		messages.push_back(message);
+	}
+
+	//Holt alle Nachrichten auf einmal. Die Vektoren werden getauscht, damit im Betrieb nichts alloziert wird.
+	void take_all(std::vector<T>& received)
+	{
+		received.clear();
+		std::lock_guard<std::mutex> lock{ mutex };
+		std::swap(received, messages);
+	}
+
+private:
+	std::mutex mutex;
+	std::vector<T> messages;
+};
+
+//Nachricht an einen Shard.
+struct Shard_Command
+{
+	enum Type : uint8_t
+	{
+		ADD_MATCH,	//Neues oder migriertes Match bernehmen.
+		MIGRATE,	//count Matches an den Shard target abgeben.
+		WATCH,		//Falls das Match match_id hier luft: Snapshots auch an address schicken.
+	};
+
+	Type type{ ADD_MATCH };
+	uint32_t target{ 0 }, count{ 0 }, match_id{ 0 };
+	UDP_Address address{};
+	Server_Match match{};
+};
+
+//Nachricht von einem Shard an den Koordinator.
+struct Shard_Report
+{
+	enum Type : uint8_t
+	{
+		MATCH_ENDED,
+		MATCHES_MOVED,
+	};
+
+	Type type{ MATCH_ENDED };
+	uint32_t shard{ 0 }, target{ 0 }, count{ 0 };
+	Join_Key clients[2]{};
+};
+
+struct Server_Config
+{
+	uint16_t port{ 7100 };				//Port fr JOIN. Die Shards benutzen die Ports danach.
+	unsigned shards{ 0 };				//Anzahl Shards (0: einer pro Kern).
+	int max_score{ 11 };				//Das Match endet, sobald ein Spieler so viele Punkte hat.
+	double client_bandwidth{ 0.0 };		//Bytes pro Sekunde fr die Snapshots eines Clients (0: nur durch Verluste begrenzt).
+	double client_timeout{ 5.0 };		//Sekunden ohne Paket, bis ein Client als getrennt gilt. Gilt auch fr wartende Clients.
+	Matchmaking_Config matchmaking{};
+	uint16_t metrics_port{ 0 };			//HTTP-Port fr die Metriken, nur auf 127.0.0.1 (0: keine Metriken).
+	double report_interval{ 5.0 };		//Sekunden zwischen zwei Berichten auf der Konsole (0: keine Berichte).
+	double rebalance_interval{ 2.0 };	//Sekunden zwischen zwei Prfungen der Auslastung.
+	double rebalance_threshold{ 0.15 };	//Ab diesem Unterschied der Auslastung werden Matches verschoben.
+	Network_Conditions emulate_out{}, emulate_in{};	//Simuliertes Netzwerk unter allen Sockets des Servers.
+	uint64_t emulate_seed{ 1 };
+
+	bool is_emulated() const
+	{
+		return emulate_out.is_active() || emulate_in.is_active();
+	}
+};
+
+//Ein Shard simuliert seine Matches in einem eigenen Thread auf einem festen Kern, mit eigenem Socket und Timer.
+//Die Clients schicken ihren Input an die Adresse, von der der Zustand kommt, also direkt an den Shard.
+class Server_Shard
+{
+public:
+	//Vom Shard geschrieben, vom Koordinator gelesen.
+	struct Statistics
+	{
+		std::atomic<double> load{ 0.0 };	//Anteil der Zeit ausserhalb von epoll_wait in der letzten Sekunde.
+		std::atomic<double> match_tick_p50{ 0.0 }, match_tick_p99{ 0.0 }, match_tick_max{ 0.0 };
+		std::atomic<double> loop_tick_p50{ 0.0 }, loop_tick_p99{ 0.0 }, loop_tick_max{ 0.0 };
+		std::atomic<uint64_t> packets_in{ 0 }, packets_out{ 0 };
+		std::atomic<double> snapshot_bytes_per_tick{ 0.0 }, snapshot_bytes{ 0.0 };	//Pro Client und Tick bzw. pro Snapshot.
+		std::atomic<uint64_t> keyframes{ 0 };
+		std::atomic<uint32_t> matches{ 0 };
+		std::atomic<int> core{ -1 };
+
+		//Fr die Metriken, seit dem Start. Die Paketzhler oben werden dafr nach jedem Tick nachgefhrt.
+		Histogram tick_seconds{}, match_tick_seconds{};	//Alle Matches eines Ticks bzw. ein Match.
+		std::atomic<uint64_t> keyframes_total{ 0 }, stale_inputs_total{ 0 };
+	};
+
+	Mailbox<Shard_Command> inbox;
+	Statistics statistics;
+
+	Server_Shard() {}
+
+	bool open(unsigned shard_index, unsigned n_shards, const Server_Config& new_config, std::deque<Server_Shard>& all_shards, Mailbox<Shard_Report>& coordinator_inbox)
+	{
+		index = shard_index;
+		config = new_config;
+		shards = &all_shards;
+		coordinator = &coordinator_inbox;
+
+		if (!socket.open(static_cast<uint16_t>(config.port + 1 + index)))
+			return false;
+		const int buffer_size{ 4 << 20 };
+		setsockopt(socket.native_handle(), SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+		setsockopt(socket.native_handle(), SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+		batch.attach(socket.native_handle());
+		if (config.is_emulated())
+			batch.emulate(config.emulate_out, config.emulate_in, config.emulate_seed + 1 + index);
+
+		epoll_handle = epoll_create1(0);
+		timer_handle = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+		if (epoll_handle < 0 || timer_handle < 0)
+		{
+			std::cerr << "Error: Could not create epoll or timer!\n";
+			return false;
+		}
+
+		//Die Shards ticken versetzt, damit nicht alle gleichzeitig senden.
+		itimerspec interval{};
+		interval.it_interval.tv_nsec = 1000000000L / Simulation::tick_rate;
+		interval.it_value.tv_nsec = interval.it_interval.tv_nsec * (1 + static_cast<long>(index)) / static_cast<long>(n_shards);
+		timerfd_settime(timer_handle, 0, &interval, nullptr);
+
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.fd = socket.native_handle();
+		epoll_ctl(epoll_handle, EPOLL_CTL_ADD, socket.native_handle(), &event);
+		event.data.fd = timer_handle;
+		epoll_ctl(epoll_handle, EPOLL_CTL_ADD, timer_handle, &event);
+
+		const std::size_t ticks_per_report{ static_cast<std::size_t>(std::max(1.0, config.report_interval) * Simulation::tick_rate) };
+		loop_tick_times.reserve(ticks_per_report + Simulation::tick_rate);
+		return true;
+	}
+
+	//Hauptschleife des Threads, bis running false wird.
+	void run(const std::atomic<bool>& running, int core)
+	{
+		if (core >= 0)
+		{
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			CPU_SET(core, &cpus);
+			pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+		}
+		Allocation_Counter::register_thread(2 + static_cast<int>(index));
+
+		time_last_second = time_last_report = clock::now();
+		while (running)
+		{
+			epoll_event events[2];
+			const auto time_wait{ clock::now() };
+			int n{ epoll_wait(epoll_handle, events, 2, 100) };
+			idle_time += seconds_since(time_wait);
+
+			for (int i{ 0 }; i < n; i++)
+			{
+				if (events[i].data.fd == timer_handle)
+				{
+					uint64_t expirations{ 0 };
+					if (read(timer_handle, &expirations, sizeof(expirations)) == sizeof(expirations))
+					{
+						//Der Emulator gibt zurckgehaltene Pakete nur weiter, wenn jemand fragt.
+						if (batch.is_emulated())
+							receive_packets();
+						//Falls der Shard zu langsam war, hole hchstens 5 Ticks nach.
+						for (uint64_t k{ 0 }; k < std::min<uint64_t>(expirations, 5); k++)
+							tick_matches();
+					}
+				}
+				else
+					receive_packets();
+			}
+
+			if (seconds_since(time_last_second) >= 1.0)
+				publish_load();
+			if (config.report_interval > 0.0 && seconds_since(time_last_report) >= config.report_interval)
+				publish_timing();
+		}
+	}
+
+	~Server_Shard()
+	{
+		if (timer_handle >= 0)
+			::close(timer_handle);
+		if (epoll_handle >= 0)
+			::close(epoll_handle);
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	unsigned index{ 0 };
+	Server_Config config{};
+	std::deque<Server_Shard>* shards{ nullptr };
+	Mailbox<Shard_Report>* coordinator{ nullptr };
+
+	UDP_Socket socket{};
+	UDP_Batch batch{};
+	int epoll_handle{ -1 }, timer_handle{ -1 };
+
+	//Die Matches liegen dicht im Speicher. Beim Entfernen rckt das letzte Match nach.
+	std::vector<Server_Match> matches;
+	std::unordered_map<uint32_t, uint32_t> match_index;	//ID -> Index in matches
+	std::vector<Shard_Command> commands;
+
+	//Statistik
+	clock::time_point time_last_second{}, time_last_report{};
+	double idle_time{ 0.0 };
+	std::vector<double> loop_tick_times, match_tick_times;
+	uint64_t snapshot_bytes{ 0 }, n_snapshots{ 0 }, n_keyframes{ 0 }, n_client_ticks{ 0 };
+
+	static double seconds_since(clock::time_point t)
+	{
+		return std::chrono::duration<double>(clock::now() - t).count();
+	}
+
+	void add_match(const Server_Match& match)
+	{
+		match_index[match.id] = static_cast<uint32_t>(matches.size());
+		matches.push_back(match);
+	}
+
+	void remove_match(uint32_t i)
+	{
+		match_index.erase(matches[i].id);
+		if (i + 1 < matches.size())
+		{
+			matches[i] = matches.back();
+			match_index[matches[i].id] = i;
+		}
+		matches.pop_back();
+	}
+
+	void process_commands()
+	{
+		inbox.take_all(commands);
+		for (const Shard_Command& command : commands)
+		{
+			if (command.type == Shard_Command::ADD_MATCH)
+				add_match(command.match);
+			else if (command.type == Shard_Command::MIGRATE && command.target < shards->size())
+			{
+				//Schnappschsse der letzten Matches an den anderen Shard schicken und hier vergessen.
+				Shard_Report report{};
+				report.type = Shard_Report::MATCHES_MOVED;
+				report.shard = index;
+				report.target = command.target;
+				Server_Shard& target{ (*shards)[command.target] };
+				while (report.count < command.count && !matches.empty())
+				{
+					Shard_Command add{};
+					add.type = Shard_Command::ADD_MATCH;
+					add.match = matches.back();
+					target.inbox.push(add);
+					remove_match(static_cast<uint32_t>(matches.size() - 1));
+					report.count++;
+				}
+				coordinator->push(report);
+			}
+			else if (command.type == Shard_Command::WATCH)
+			{
+				auto found{ match_index.find(command.match_id) };
+				if (found != match_index.end())
+				{
+					Server_Match& match{ matches[found->second] };
+					if (!match.watched || !(match.watcher.address == command.address))
+					{
+						match.watched = true;
+						match.watcher = Server_Match::Client{};
+						match.watcher.address = command.address;
+					}
+					match.watcher.last_seen = clock::now();
+				}
+			}
+		}
+	}
+
+	void receive_packets()
+	{
+		int n;
+		while ((n = batch.receive()) > 0)
+		{
+			for (int i{ 0 }; i < n; i++)
+			{
+				const uint8_t* packet{ batch.packet(i) };
+				const std::size_t size{ batch.size(i) };
+				if (!Server_Protocol::check_header(packet, size, 3))
+					continue;
+
+				if (packet[2] == Server_Protocol::MSG_INPUT && size >= Server_Protocol::size_input)
+				{
+					Server_Match::Client* client{ find_client(batch.from(i), packet) };
+					if (client == nullptr)
+						continue;
+
+					//ltere Pakete (Reihenfolge vertauscht) werden ignoriert.
+					const uint32_t sequence{ Packet::read_u32(packet + 12) };
+					if (sequence > client->last_sequence)
+					{
+						client->last_sequence = sequence;
+						client->input = packet[16];
+						client->acked_tick = std::max(client->acked_tick, Packet::read_u32(packet + 17));
+						client->rate.received(Server_Protocol::read_u16(packet + 21));
+					}
+					else
+						Metrics::increment(statistics.stale_inputs_total);
+					client->last_seen = clock::now();
+				}
+				else if (packet[2] == Server_Protocol::MSG_LEAVE && size >= Server_Protocol::size_leave)
+				{
+					if (find_client(batch.from(i), packet) != nullptr)
+						end_match(match_index[Packet::read_u32(packet + 3)]);
+				}
+				else if (packet[2] == Server_Protocol::MSG_ACK && size >= Server_Protocol::size_ack)
+				{
+					auto found{ match_index.find(Packet::read_u32(packet + 3)) };
+					if (found == match_index.end())
+						continue;
+					Server_Match::Client& watcher{ matches[found->second].watcher };
+					if (!matches[found->second].watched || !(watcher.address == batch.from(i)))
+						continue;
+					watcher.acked_tick = std::max(watcher.acked_tick, Packet::read_u32(packet + 8));
+					watcher.rate.received(Server_Protocol::read_u16(packet + 12));
+					watcher.last_seen = clock::now();
+				}
+			}
+			if (n < UDP_Batch::batch_size)
+				break;
+		}
+		batch.flush();
+	}
+
+	//Match, Seite und Token folgen bei INPUT und LEAVE direkt auf den Header.
+	Server_Match::Client* find_client(const UDP_Address& from, const uint8_t* packet)
+	{
+		auto found{ match_index.find(Packet::read_u32(packet + 3)) };
+		const uint8_t side{ packet[7] };
+		if (found == match_index.end() || side > 1)
+			return nullptr;
+		Server_Match::Client& client{ matches[found->second].clients[side] };
+		if (client.token != Packet::read_u32(packet + 8) || !(client.address == from))
+			return nullptr;
+		return &client;
+	}
+
+	//Jeder Client bekommt den Snapshot in seiner eigenen Rate, als Delta zur letzten besttigten Baseline
+	//oder als Keyframe, falls er noch nichts besttigt hat oder die Baseline zu alt ist.
+	void send_snapshots(Server_Match& match)
+	{
+		const Snapshot current{ Snapshot_Codec::capture(match.sim) };
+		match.history.insert(current);
+		const uint8_t n_receivers{ static_cast<uint8_t>(match.watched ? 3 : 2) };	//Beide Spieler und ein Zuschauer bzw. Relay.
+		for (uint8_t side{ 0 }; side < n_receivers; side++)
+		{
+			Server_Match::Client& client{ side < 2 ? match.clients[side] : match.watcher };
+			client.rate.update(current.tick, config.client_bandwidth);
+			if (!client.rate.due(current.tick))
+				continue;
+
+			const Snapshot* baseline{ current.tick - client.acked_tick <= Snapshot_Codec::max_distance ? match.history.find(client.acked_tick) : nullptr };
+			uint8_t* out{ batch.prepare(client.address) };
+			uint8_t* p{ Server_Protocol::write_header(out, Server_Protocol::MSG_SNAPSHOT) };
+			Packet::write_u32(p, match.id);
+			p[4] = side;
+			const std::size_t size{ Snapshot_Codec::encode(current, baseline, out + Server_Protocol::size_snapshot_header,
+				UDP_Batch::max_packet_size - Server_Protocol::size_snapshot_header) };
+			batch.commit(Server_Protocol::size_snapshot_header + size);
+
+			client.rate.sent(current.tick, Server_Protocol::size_snapshot_header + size);
+			snapshot_bytes += size;
+			n_snapshots++;
+			if (baseline == nullptr)
+			{
+				n_keyframes++;
+				Metrics::increment(statistics.keyframes_total);
+			}
+		}
+		n_client_ticks += n_receivers;
+	}
+
+	void end_match(uint32_t i)
+	{
+		const Server_Match& match{ matches[i] };
+		Shard_Report report{};
+		report.type = Shard_Report::MATCH_ENDED;
+		report.shard = index;
+		for (int side{ 0 }; side < (match.watched ? 3 : 2); side++)
+		{
+			const Server_Match::Client& client{ side < 2 ? match.clients[side] : match.watcher };
+			uint8_t* p{ Server_Protocol::write_header(batch.prepare(client.address), Server_Protocol::MSG_END) };
+			Packet::write_u32(p, match.id);
+			Server_Protocol::write_u16(p + 4, match.sim.score_left);
+			Server_Protocol::write_u16(p + 6, match.sim.score_right);
+			batch.commit(Server_Protocol::size_end);
+			if (side < 2)
+				report.clients[side] = Join_Key{ client.address, client.nonce };
+		}
+		coordinator->push(report);
+		remove_match(i);
+	}
+
+	void tick_matches()
+	{
+		const auto time_start{ clock::now() };
+		process_commands();
+
+		const bool check_timeouts{ time_start - time_last_second >= std::chrono::milliseconds(500) };
+		for (uint32_t i{ 0 }; i < matches.size();)
+		{
+			Server_Match& match{ matches[i] };
+			const auto t0{ clock::now() };
+			match.sim.step(match.clients[0].input, match.clients[1].input);
+			const double t_tick{ seconds_since(t0) };
+			match.tick_time_sum += t_tick;
+			match.tick_time_max = std::max(match.tick_time_max, t_tick);
+			match.n_ticks++;
+			statistics.match_tick_seconds.observe(t_tick);
+
+			send_snapshots(match);
+
+			bool ended{ match.sim.score_left >= config.max_score || match.sim.score_right >= config.max_score };
+			if (check_timeouts)
+			{
+				for (const Server_Match::Client& client : match.clients)
+					ended = ended || std::chrono::duration<double>(time_start - client.last_seen).count() > config.client_timeout;
+				if (match.watched && std::chrono::duration<double>(time_start - match.watcher.last_seen).count() > config.client_timeout)
+					match.watched = false;
+			}
+
+			//Beim Entfernen rckt das letzte Match an die Stelle i.
+			if (ended)
+				end_match(i);
+			else
+				i++;
+		}
+		batch.flush();
+		const double t_loop{ seconds_since(time_start) };
+		loop_tick_times.push_back(t_loop);
+		statistics.tick_seconds.observe(t_loop);
+		statistics.packets_in.store(batch.packets_in, std::memory_order_relaxed);
+		statistics.packets_out.store(batch.packets_out, std::memory_order_relaxed);
+	}
+
+	void publish_load()
+	{
+		const double elapsed{ seconds_since(time_last_second) };
+		statistics.load = std::clamp(1.0 - idle_time / elapsed, 0.0, 1.0);
+		statistics.matches = static_cast<uint32_t>(matches.size());
+		statistics.core = sched_getcpu();
+		idle_time = 0.0;
+		time_last_second = clock::now();
+	}
+
+	//Median, 99. Perzentil und Maximum der Tick-Zeiten seit dem letzten Bericht.
+	static void percentiles(std::vector<double>& values, std::atomic<double>& p50, std::atomic<double>& p99)
+	{
+		if (values.empty())
+		{
+			p50 = p99 = 0.0;
+			return;
+		}
+		auto at = [&values](double q)
+		{
+			auto nth{ values.begin() + static_cast<std::ptrdiff_t>(q * (values.size() - 1)) };
+			std::nth_element(values.begin(), nth, values.end());
+			return *nth;
+		};
+		p50 = at(0.5);
+		p99 = at(0.99);
+	}
+
+	void publish_timing()
+	{
+		//Pro Match die durchschnittliche Zeit fr einen Tick, pro Tick die Zeit fr alle Matches des Shards.
+		match_tick_times.clear();
+		double match_tick_max{ 0.0 };
+		for (Server_Match& match : matches)
+		{
+			if (match.n_ticks > 0)
+			{
+				match_tick_times.push_back(match.tick_time_sum / match.n_ticks);
+				match_tick_max = std::max(match_tick_max, match.tick_time_max);
+			}
+			match.tick_time_sum = 0.0;
+			match.tick_time_max = 0.0;
+			match.n_ticks = 0;
+		}
+		percentiles(match_tick_times, statistics.match_tick_p50, statistics.match_tick_p99);
+		statistics.match_tick_max = match_tick_max;
+
+		statistics.loop_tick_max = loop_tick_times.empty() ? 0.0 : *std::max_element(loop_tick_times.begin(), loop_tick_times.end());
+		percentiles(loop_tick_times, statistics.loop_tick_p50, statistics.loop_tick_p99);
+		loop_tick_times.clear();
+
+		statistics.snapshot_bytes_per_tick = n_client_ticks > 0 ? static_cast<double>(snapshot_bytes) / n_client_ticks : 0.0;
+		statistics.snapshot_bytes = n_snapshots > 0 ? static_cast<double>(snapshot_bytes) / n_snapshots : 0.0;
+		statistics.keyframes = n_keyframes;
+		snapshot_bytes = n_snapshots = n_keyframes = n_client_ticks = 0;
+		time_last_report = clock::now();
+	}
+};
+
+//Koordinator: Nimmt auf dem Haupt-Port JOIN-Pakete an, bildet Paare und gibt jedes neue Match dem am wenigsten ausgelasteten Shard.
+//Ist ein Shard deutlich strker ausgelastet als ein anderer, verschiebt er einen Teil seiner Matches dorthin.
+class Match_Server
+{
+public:
+	Match_Server() {}
+
+	bool open(const Server_Config& new_config)
+	{
+		config = new_config;
+		const unsigned n_cores{ std::max(1u, std::thread::hardware_concurrency()) };
+		if (config.shards == 0)
+			config.shards = n_cores;
+
+		if (!socket.open(config.port))
+			return false;
+		batch.attach(socket.native_handle());
+		if (config.is_emulated())
+			batch.emulate(config.emulate_out, config.emulate_in, config.emulate_seed);
+
+		epoll_handle = epoll_create1(0);
+		timer_handle = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+		if (epoll_handle < 0 || timer_handle < 0)
+		{
+			std::cerr << "Error: Could not create epoll or timer!\n";
+			return false;
+		}
+
+		//Der Koordinator hat wenig zu tun und prft 10 Mal pro Sekunde seinen Briefkasten.
+		//Mit Emulator so oft wie die Shards ticken, damit zurckgehaltene Pakete rechtzeitig weitergehen.
+		itimerspec interval{};
+		interval.it_interval.tv_nsec = config.is_emulated() ? 1000000000L / Simulation::tick_rate : 100000000L;
+		interval.it_value = interval.it_interval;
+		timerfd_settime(timer_handle, 0, &interval, nullptr);
+
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.fd = socket.native_handle();
+		epoll_ctl(epoll_handle, EPOLL_CTL_ADD, socket.native_handle(), &event);
+		event.data.fd = timer_handle;
+		epoll_ctl(epoll_handle, EPOLL_CTL_ADD, timer_handle, &event);
+		if (config.metrics_port != 0)
+		{
+			if (!metrics.open(config.metrics_port))
+				return false;
+			event.data.fd = metrics.native_handle();
+			epoll_ctl(epoll_handle, EPOLL_CTL_ADD, metrics.native_handle(), &event);
+		}
+
+		for (unsigned i{ 0 }; i < config.shards; i++)
+		{
+			shards.emplace_back();
+			if (!shards.back().open(i, config.shards, config, shards, inbox))
+				return false;
+		}
+		shard_matches.assign(config.shards, 0);
+		shard_packets_reported.assign(config.shards, { 0, 0 });
+
+		config.matchmaking.timeout = config.client_timeout;
+		matchmaker.configure(config.matchmaking);
+		time_start = clock::now();
+
+		std::random_device seed;
+		random_engine.seed(seed());
+		return true;
+	}
+
+	//Startet die Shards und luft, bis running false wird.
+	void run(const std::atomic<bool>& running)
+	{
+		const unsigned n_cores{ std::max(1u, std::thread::hardware_concurrency()) };
+		std::vector<std::thread> threads;
+		for (unsigned i{ 0 }; i < shards.size(); i++)
+			threads.emplace_back([this, &running, i, n_cores]() { shards[i].run(running, static_cast<int>(i % n_cores)); });
+
+		Allocation_Counter::register_thread(1);
+		time_last_report = time_last_rebalance = clock::now();
+		while (running)
+		{
+			epoll_event events[3];
+			int n{ epoll_wait(epoll_handle, events, 3, 100) };
+			for (int i{ 0 }; i < n; i++)
+			{
+				if (events[i].data.fd == timer_handle)
+				{
+					uint64_t expirations{ 0 };
+					if (read(timer_handle, &expirations, sizeof(expirations)) == sizeof(expirations))
+					{
+						if (batch.is_emulated())
+							receive_packets();
+						process_reports();
+					}
+				}
+				else if (metrics.is_open() && events[i].data.fd == metrics.native_handle())
+					metrics.poll([this](std::string& out) { write_metrics(out); });
+				else
+					receive_packets();
+			}
+
+			if (seconds_since(time_last_rebalance) >= config.rebalance_interval)
+				rebalance();
+			if (config.report_interval > 0.0 && seconds_since(time_last_report) >= config.report_interval)
+				report();
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	~Match_Server()
+	{
+		if (timer_handle >= 0)
+			::close(timer_handle);
+		if (epoll_handle >= 0)
+			::close(epoll_handle);
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	struct Join_Entry
+	{
+		uint32_t match{ 0 }, token{ 0 };
+		uint8_t side{ 0 };
+	};
+
+	Server_Config config{};
+	UDP_Socket socket{};
+	UDP_Batch batch{};
+	int epoll_handle{ -1 }, timer_handle{ -1 };
+	std::mt19937 random_engine{};
+	Metrics_Server metrics{};
+
+	std::deque<Server_Shard> shards;
+	Mailbox<Shard_Report> inbox;
+	std::vector<Shard_Report> reports;
+	std::vector<uint32_t> shard_matches;	//Sicht des Koordinators, nachgefhrt ber die Berichte der Shards.
+
+	std::unordered_map<Join_Key, Join_Entry, Join_Key_Hash> joined_clients;
+	Matchmaker matchmaker{};
+	std::vector<Matchmaker::Pair> pairs;
+	clock::time_point time_start{};		//Nullpunkt der Zeit fr den Matchmaker.
+	uint32_t next_match_id{ 1 };
+
+	//Statistik seit dem letzten Bericht
+	clock::time_point time_last_report{}, time_last_rebalance{};
+	uint64_t n_matches_started{ 0 }, n_matches_finished{ 0 }, n_matches_migrated{ 0 };
+	double matchmaking_time{ 0.0 };		//Sekunden im Matchmaker
+
+	//Seit dem Start, fr die Metriken
+	uint64_t total_matches_started{ 0 }, total_matches_finished{ 0 }, total_matches_migrated{ 0 }, total_players_paired{ 0 };
+	std::vector<std::pair<uint64_t, uint64_t>> shard_packets_reported;
+
+	static double seconds_since(clock::time_point t)
+	{
+		return std::chrono::duration<double>(clock::now() - t).count();
+	}
+
+	void receive_packets()
+	{
+		int n;
+		while ((n = batch.receive()) > 0)
+		{
+			for (int i{ 0 }; i < n; i++)
+			{
+				const uint8_t* packet{ batch.packet(i) };
+				if (!Server_Protocol::check_header(packet, batch.size(i), Server_Protocol::size_join))
+					continue;
+				if (packet[2] == Server_Protocol::MSG_JOIN)
+				{
+					const bool rated{ batch.size(i) >= Server_Protocol::size_join_rated };
+					handle_join(batch.from(i), Packet::read_u32(packet + 3),
+						rated ? Server_Protocol::read_u16(packet + 7) : Server_Protocol::default_rating, rated ? Server_Protocol::read_u16(packet + 9) : 0);
+				}
+				//Der Koordinator weiss nicht, auf welchem Shard ein Match gerade luft: Alle Shards fragen, nur der richtige reagiert.
+				else if (packet[2] == Server_Protocol::MSG_WATCH)
+				{
+					Shard_Command command{};
+					command.type = Shard_Command::WATCH;
+					command.match_id = Packet::read_u32(packet + 3);
+					command.address = batch.from(i);
+					for (Server_Shard& shard : shards)
+						shard.inbox.push(command);
+				}
+			}
+			if (n < UDP_Batch::batch_size)
+				break;
+		}
+		batch.flush();
+	}
+
+	void handle_join(const UDP_Address& from, uint32_t nonce, uint16_t rating, uint16_t latency)
+	{
+		auto found{ joined_clients.find(Join_Key{ from, nonce }) };
+		if (found != joined_clients.end())
+		{
+			//Die Antwort ging verloren: Schicke sie nochmals.
+			send_joined(from, nonce, found->second);
+			return;
+		}
+
+		//Die Paare bildet der Matchmaker erst in process_reports(), mit allen bis dann angekommenen Clients.
+		const auto time_enqueue{ clock::now() };
+		matchmaker.enqueue(Matchmaker::Player{ from, nonce, rating, latency }, std::chrono::duration<double>(time_enqueue - time_start).count());
+		matchmaking_time += seconds_since(time_enqueue);
+	}
+
+	//Neues Match fr ein Paar vom Matchmaker, auf dem Shard mit der kleinsten geschtzten Auslastung.
+	void start_match(const Matchmaker::Pair& pair)
+	{
+		Shard_Command command{};
+		command.type = Shard_Command::ADD_MATCH;
+		Server_Match& match{ command.match };
+		match.id = next_match_id++;
+		match.sim.left = Sim_Schlaeger{ -0.8, PLAYER };
+		match.sim.right = Sim_Schlaeger{ 0.8, PLAYER };
+		match.sim.ball.reset(match.sim.time());
+
+		for (uint8_t side{ 0 }; side < 2; side++)
+		{
+			Server_Match::Client& client{ match.clients[side] };
+			client.address = pair.players[side].address;
+			client.nonce = pair.players[side].nonce;
+			client.token = static_cast<uint32_t>(random_engine());
+			client.last_seen = clock::now();
+
+			const Join_Entry entry{ match.id, client.token, side };
+			joined_clients[Join_Key{ client.address, client.nonce }] = entry;
+			send_joined(client.address, client.nonce, entry);
+		}
+
+		const unsigned shard{ least_loaded_shard() };
+		shards[shard].inbox.push(command);
+		shard_matches[shard]++;
+		n_matches_started++;
+		total_matches_started++;
+	}
+
+	void send_joined(const UDP_Address& to, uint32_t nonce, const Join_Entry& entry)
+	{
+		uint8_t* p{ Server_Protocol::write_header(batch.prepare(to), Server_Protocol::MSG_JOINED) };
+		Packet::write_u32(p, nonce);
+		Packet::write_u32(p + 4, entry.match);
+		p[8] = entry.side;
+		Packet::write_u32(p + 9, entry.token);
+		batch.commit(Server_Protocol::size_joined);
+	}
+
+	//Geschtzte Auslastung mit einem Match mehr: Die zuletzt gemessene Auslastung plus die Kosten der seither
+	//hinzugekommenen Matches, mit den durchschnittlichen Kosten pro Match ber alle Shards.
+	//Bei Gleichstand (etwa ganz am Anfang) entscheidet die Anzahl Matches.
+	unsigned least_loaded_shard() const
+	{
+		double total_load{ 0.0 }, total_matches{ 0.0 };
+		for (const Server_Shard& shard : shards)
+		{
+			total_load += shard.statistics.load;
+			total_matches += shard.statistics.matches;
+		}
+		const double cost_per_match{ total_matches > 0.0 ? total_load / total_matches : 0.0 };
+
+		unsigned best{ 0 };
+		double best_load{ 0.0 };
+		for (unsigned i{ 0 }; i < shards.size(); i++)
+		{
+			const double new_matches{ static_cast<double>(shard_matches[i]) + 1.0 - shards[i].statistics.matches };
+			const double load{ shards[i].statistics.load + cost_per_match * new_matches };
+			if (i == 0 || load < best_load || (load == best_load && shard_matches[i] < shard_matches[best]))
+			{
+				best = i;
+				best_load = load;
+			}
+		}
+		return best;
+	}
+
+	void process_reports()
+	{
+		inbox.take_all(reports);
+		for (const Shard_Report& report : reports)
+		{
+			if (report.type == Shard_Report::MATCH_ENDED)
+			{
+				joined_clients.erase(report.clients[0]);
+				joined_clients.erase(report.clients[1]);
+				shard_matches[report.shard]--;
+				n_matches_finished++;
+				total_matches_finished++;
+			}
+			else if (report.type == Shard_Report::MATCHES_MOVED)
+			{
+				shard_matches[report.shard] -= report.count;
+				shard_matches[report.target] += report.count;
+				n_matches_migrated += report.count;
+				total_matches_migrated += report.count;
+			}
+		}
+
+		const auto time_match{ clock::now() };
+		pairs.clear();
+		matchmaker.match(std::chrono::duration<double>(time_match - time_start).count(), pairs);
+		matchmaking_time += seconds_since(time_match);
+		for (const Matchmaker::Pair& pair : pairs)
+			start_match(pair);
+		total_players_paired += 2 * pairs.size();
+		batch.flush();
+	}
+
+	//Verschiebe Matches vom am strksten zum am wenigsten ausgelasteten Shard, so dass sich die Auslastung ungefhr angleicht.
+	void rebalance()
+	{
+		time_last_rebalance = clock::now();
+		if (shards.size() < 2)
+			return;
+
+		unsigned busiest{ 0 }, idlest{ 0 };
+		for (unsigned i{ 1 }; i < shards.size(); i++)
+		{
+			if (shards[i].statistics.load > shards[busiest].statistics.load)
+				busiest = i;
+			if (shards[i].statistics.load < shards[idlest].statistics.load)
+				idlest = i;
+		}
+
+		const double load_busiest{ shards[busiest].statistics.load }, load_idlest{ shards[idlest].statistics.load };
+		if (load_busiest - load_idlest < config.rebalance_threshold || shard_matches[busiest] < 2)
+			return;
+
+		const double fraction{ (load_busiest - load_idlest) / (2.0 * load_busiest) };
+		Shard_Command command{};
+		command.type = Shard_Command::MIGRATE;
+		command.target = idlest;
+		command.count = std::clamp(static_cast<uint32_t>(fraction * shard_matches[busiest]), 1u, shard_matches[busiest] / 2);
+		shards[busiest].inbox.push(command);
+	}
+
+	void report()
+	{
+		const double elapsed{ seconds_since(time_last_report) };
+		uint32_t n_playing{ 0 };
+		for (uint32_t n : shard_matches)
+			n_playing += n;
+
+		printf("[server] %u matches on %zu shards, %zu waiting | started %.0f/s, finished %.0f/s, migrated %llu\n",
+			n_playing, shards.size(), matchmaker.size(),
+			n_matches_started / elapsed, n_matches_finished / elapsed, static_cast<unsigned long long>(n_matches_migrated));
+		const Matchmaker::Statistics& m{ matchmaker.get_statistics() };
+		printf("[matchmaking] joined %.0f/s, paired %.0f/s (%.1f%% with neighbour buckets), timed out %llu | wait avg %.3f s, max %.3f s"
+			" | rating difference avg %.1f | %.2f us per client, %.2f%% of a core\n",
+			m.enqueued / elapsed, 2.0 * m.paired / elapsed, m.paired ? 100.0 * m.widened / m.paired : 0.0, static_cast<unsigned long long>(m.timed_out),
+			m.paired ? m.wait_sum / (2.0 * m.paired) : 0.0, m.wait_max, m.paired ? m.rating_difference_sum / m.paired : 0.0,
+			m.enqueued ? 1e6 * matchmaking_time / m.enqueued : 0.0, 100.0 * matchmaking_time / elapsed);
+		for (unsigned i{ 0 }; i < shards.size(); i++)
+		{
+			const Server_Shard::Statistics& s{ shards[i].statistics };
+			const uint64_t packets_in{ s.packets_in }, packets_out{ s.packets_out };
+			printf("[shard %u] core %d, %u matches, load %.1f%% | tick per match p50 %.2f us, p99 %.2f us, max %.2f us"
+				" | all matches per tick p50 %.3f ms, p99 %.3f ms, max %.3f ms | packets in %.0f/s out %.0f/s"
+				" | snapshots %.2f bytes per client and tick, %.2f bytes each, %llu keyframes\n",
+				i, s.core.load(), s.matches.load(), 100.0 * s.load,
+				1e6 * s.match_tick_p50, 1e6 * s.match_tick_p99, 1e6 * s.match_tick_max,
+				1e3 * s.loop_tick_p50, 1e3 * s.loop_tick_p99, 1e3 * s.loop_tick_max,
+				(packets_in - shard_packets_reported[i].first) / elapsed, (packets_out - shard_packets_reported[i].second) / elapsed,
+				s.snapshot_bytes_per_tick.load(), s.snapshot_bytes.load(), static_cast<unsigned long long>(s.keyframes.load()));
+			shard_packets_reported[i] = { packets_in, packets_out };
+		}
+		fflush(stdout);
+
+		n_matches_started = 0;
+		n_matches_finished = 0;
+		n_matches_migrated = 0;
+		matchmaker.reset_statistics();
+		matchmaking_time = 0.0;
+		time_last_report = clock::now();
+	}
+
+	//Alle Metriken fr eine Abfrage. Die Histogramme der Shards werden erst hier zusammengezhlt.
+	void write_metrics(std::string& out)
+	{
+		Metrics_Text text{ out };
+		auto shard_label = [](unsigned i) { return "shard=\"" + std::to_string(i) + "\""; };
+
+		text.family("pong_shard_tick_seconds", "histogram", "Time to tick all matches of a shard once.");
+		for (unsigned i{ 0 }; i < shards.size(); i++)
+		{
+			Histogram::Counts counts{};
+			counts.add(shards[i].statistics.tick_seconds);
+			text.histogram("pong_shard_tick_seconds", shard_label(i), counts);
+		}
+		text.family("pong_match_tick_seconds", "histogram", "Time to simulate one tick of one match, over all shards.");
+		Histogram::Counts match_counts{};
+		for (const Server_Shard& shard : shards)
+			match_counts.add(shard.statistics.match_tick_seconds);
+		text.histogram("pong_match_tick_seconds", "", match_counts);
+
+		text.family("pong_shard_matches", "gauge", "Matches hosted by a shard.");
+		for (unsigned i{ 0 }; i < shards.size(); i++)
+			text.sample("pong_shard_matches", shard_label(i), shards[i].statistics.matches);
+		text.family("pong_shard_load", "gauge", "Fraction of the last second a shard was busy.");
+		for (unsigned i{ 0 }; i < shards.size(); i++)
+			text.sample("pong_shard_load", shard_label(i), shards[i].statistics.load);
+		text.family("pong_shard_packets_received_total", "counter", "UDP packets received by a shard.");
+		for (unsigned i{ 0 }; i < shards.size(); i++)
+			text.sample("pong_shard_packets_received_total", shard_label(i), static_cast<double>(shards[i].statistics.packets_in.load()));
+		text.family("pong_shard_packets_sent_total", "counter", "UDP packets sent by a shard.");
+		for (unsigned i{ 0 }; i < shards.size(); i++)
+			text.sample("pong_shard_packets_sent_total", shard_label(i), static_cast<double>(shards[i].statistics.packets_out.load()));
+		text.family("pong_shard_keyframes_total", "counter", "Snapshots sent without a baseline, because the client fell too far behind.");
+		for (unsigned i{ 0 }; i < shards.size(); i++)
+			text.sample("pong_shard_keyframes_total", shard_label(i), static_cast<double>(shards[i].statistics.keyframes_total.load()));
+		text.family("pong_shard_stale_inputs_total", "counter", "Inputs dropped because a newer one had already arrived.");
+		for (unsigned i{ 0 }; i < shards.size(); i++)
+			text.sample("pong_shard_stale_inputs_total", shard_label(i), static_cast<double>(shards[i].statistics.stale_inputs_total.load()));
+
+		text.family("pong_coordinator_packets_received_total", "counter", "UDP packets received by the coordinator.");
+		text.sample("pong_coordinator_packets_received_total", "", static_cast<double>(batch.packets_in));
+		text.family("pong_coordinator_packets_sent_total", "counter", "UDP packets sent by the coordinator.");
+		text.sample("pong_coordinator_packets_sent_total", "", static_cast<double>(batch.packets_out));
+		text.family("pong_matches_started_total", "counter", "Matches started.");
+		text.sample("pong_matches_started_total", "", static_cast<double>(total_matches_started));
+		text.family("pong_matches_finished_total", "counter", "Matches finished.");
+		text.sample("pong_matches_finished_total", "", static_cast<double>(total_matches_finished));
+		text.family("pong_matches_migrated_total", "counter", "Matches moved to another shard.");
+		text.sample("pong_matches_migrated_total", "", static_cast<double>(total_matches_migrated));
+		text.family("pong_matchmaking_waiting", "gauge", "Players waiting for an opponent.");
+		text.sample("pong_matchmaking_waiting", "", static_cast<double>(matchmaker.size()));
+		text.family("pong_matchmaking_paired_total", "counter", "Players given an opponent.");
+		text.sample("pong_matchmaking_paired_total", "", static_cast<double>(total_players_paired));
+
+		//Platz 0: alle anderen Threads, 1: Koordinator, ab 2: Shards.
+		auto thread_label = [](int slot) -> std::string
+		{
+			if (slot == 0)
+				return "thread=\"other\"";
+			if (slot == 1)
+				return "thread=\"coordinator\"";
+			return "thread=\"shard" + std::to_string(slot - 2) + "\"";
+		};
+		const int n_slots{ std::min(Allocation_Counter::max_slots, 2 + static_cast<int>(shards.size())) };
+		text.family("pong_allocations_total", "counter", "Calls to operator new.");
+		for (int slot{ 0 }; slot < n_slots; slot++)
+			text.sample("pong_allocations_total", thread_label(slot), static_cast<double>(Allocation_Counter::slots[slot].allocations.load(std::memory_order_relaxed)));
+		text.family("pong_allocated_bytes_total", "counter", "Bytes requested from operator new.");
+		for (int slot{ 0 }; slot < n_slots; slot++)
+			text.sample("pong_allocated_bytes_total", thread_label(slot), static_cast<double>(Allocation_Counter::slots[slot].bytes.load(std::memory_order_relaxed)));
+	}
+};
+
+//Synthetische Clients, um den Server zu testen. Viele Bots teilen sich wenige Sockets.
+//Ein Bot folgt dem Ball, aber mit einem zuflligen Fehler pro Ballwechsel, damit die Matches auch enden.
+class Bot_Swarm
+{
+public:
+	Bot_Swarm() {}
+
+	bool open(const std::string& server_host_and_port, int n_bots, int bots_per_socket = 256)
+	{
+		if (!UDP_Address::resolve(server_host_and_port, server_address))
+			return false;
+
+		epoll_handle = epoll_create1(0);
+		const int n_sockets{ (n_bots + bots_per_socket - 1) / bots_per_socket };
+		for (int i{ 0 }; i < n_sockets; i++)
+		{
+			sockets.emplace_back();
+			batches.emplace_back();
+			if (!sockets.back().open(0))
+				return false;
+			batches.back().attach(sockets.back().native_handle());
+
+			epoll_event event{};
+			event.events = EPOLLIN;
+			event.data.u32 = static_cast<uint32_t>(i);
+			epoll_ctl(epoll_handle, EPOLL_CTL_ADD, sockets.back().native_handle(), &event);
+		}
+
+		std::random_device seed;
+		random_engine.seed(seed());
+		bots.resize(static_cast<std::size_t>(n_bots));
+		for (int i{ 0 }; i < n_bots; i++)
+		{
+			bots[i].socket = i / bots_per_socket;
+			bots[i].nonce = static_cast<uint32_t>(i);
+		}
+		return true;
+	}
+
+	//Simuliere ein schlechtes Netzwerk unter allen Sockets der Bots, jeder Socket mit eigenem Seed.
+	void emulate(const Network_Conditions& out, const Network_Conditions& in, uint64_t seed)
+	{
+		for (std::size_t i{ 0 }; i < batches.size(); i++)
+			batches[i].emulate(out, in, seed + i);
+		emulated = true;
+	}
+
+	void run(const std::atomic<bool>& running, double report_interval = 5.0)
+	{
+		auto time_last_report{ clock::now() };
+		while (running)
+		{
+			send_joins();
+
+			//Mit Emulator mssen alle Sockets regelmssig gefragt werden, auch ohne neue Pakete.
+			epoll_event events[16];
+			int n{ epoll_wait(epoll_handle, events, 16, emulated ? 2 : 50) };
+			if (emulated)
+			{
+				for (uint32_t i{ 0 }; i < batches.size(); i++)
+					receive_packets(i);
+			}
+			else
+			{
+				for (int i{ 0 }; i < n; i++)
+					receive_packets(events[i].data.u32);
+			}
+
+			const double elapsed{ std::chrono::duration<double>(clock::now() - time_last_report).count() };
+			if (report_interval > 0.0 && elapsed >= report_interval)
+			{
+				std::size_t n_playing{ 0 };
+				for (const Bot& bot : bots)
+					n_playing += (bot.status == Bot::PLAYING);
+				printf("[bots] %zu of %zu bots playing | states %.0f/s | matches finished %llu\n",
+					n_playing, bots.size(), n_states / elapsed, static_cast<unsigned long long>(n_matches_finished));
+				fflush(stdout);
+				n_states = 0;
+				n_matches_finished = 0;
+				time_last_report = clock::now();
+			}
+		}
+
+		//Melde alle Bots ab, damit der Server die Matches sofort beendet.
+		for (const Bot& bot : bots)
+		{
+			if (bot.status == Bot::PLAYING)
+			{
+				uint8_t* p{ Server_Protocol::write_header(batches[bot.socket].prepare(bot.shard_address), Server_Protocol::MSG_LEAVE) };
+				Packet::write_u32(p, bot.match);
+				p[4] = bot.side;
+				Packet::write_u32(p + 5, bot.token);
+				batches[bot.socket].commit(Server_Protocol::size_leave);
+			}
+		}
+		for (UDP_Batch& batch : batches)
+			batch.flush();
+	}
+
+	~Bot_Swarm()
+	{
+		if (epoll_handle >= 0)
+			::close(epoll_handle);
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	struct Bot
+	{
+		enum Status : uint8_t
+		{
+			JOINING,
+			PLAYING,
+		};
+
+		Status status{ JOINING };
+		int socket{ 0 };
+		uint32_t nonce{ 0 }, match{ 0 }, token{ 0 }, sequence{ 0 };
+		uint8_t side{ 0 };
+		UDP_Address shard_address{};	//Absender des letzten Zustands: Dorthin geht der Input.
+		Snapshot_History history{};		//Empfangene Snapshots, Baselines fr die Deltas.
+		uint32_t newest_tick{ 0 };
+		uint16_t n_received{ 0 };
+		float aim_error{ 0.0f }, x_ball_old{ 0.0f };
+		clock::time_point time_last_join{}, time_last_state{};
+	};
+
+	UDP_Address server_address{};
+	std::deque<UDP_Socket> sockets;
+	std::deque<UDP_Batch> batches;
+	std::vector<Bot> bots;
+	std::unordered_map<uint64_t, uint32_t> bot_by_match;	//(Match, Seite) -> Bot
+	int epoll_handle{ -1 };
+	bool emulated{ false };
+	std::mt19937 random_engine{};
+	uint64_t n_states{ 0 }, n_matches_finished{ 0 };
+
+	static uint64_t match_key(uint32_t match, uint8_t side)
+	{
+		return (static_cast<uint64_t>(match) << 1) | side;
+	}
+
+	//Bots ohne Match schicken alle 500 ms ein JOIN, bis der Server antwortet.
+	//Ging das END-Paket verloren, sucht der Bot nach 5 s ohne Zustand ein neues Match.
+	void send_joins()
+	{
+		const auto now{ clock::now() };
+		for (Bot& bot : bots)
+		{
+			if (bot.status == Bot::PLAYING && now - bot.time_last_state > std::chrono::seconds(5))
+			{
+				auto found{ bot_by_match.find(match_key(bot.match, bot.side)) };
+				if (found != bot_by_match.end() && &bots[found->second] == &bot)
+					bot_by_match.erase(found);
+				bot.status = Bot::JOINING;
+				bot.nonce += static_cast<uint32_t>(bots.size());
+			}
+			if (bot.status == Bot::JOINING && now - bot.time_last_join > std::chrono::milliseconds(500))
+			{
+				uint8_t* p{ Server_Protocol::write_header(batches[bot.socket].prepare(server_address), Server_Protocol::MSG_JOIN) };
+				Packet::write_u32(p, bot.nonce);
+				batches[bot.socket].commit(Server_Protocol::size_join);
+				bot.time_last_join = now;
+			}
+		}
+		for (UDP_Batch& batch : batches)
+			batch.flush();
+	}
+
+	void receive_packets(uint32_t socket_index)
+	{
+		UDP_Batch& batch{ batches[socket_index] };
+		int n;
+		while ((n = batch.receive()) > 0)
+		{
+			for (int i{ 0 }; i < n; i++)
+			{
+				const uint8_t* packet{ batch.packet(i) };
+				const std::size_t size{ batch.size(i) };
+				if (!Server_Protocol::check_header(packet, size, 3))
+					continue;
+
+				if (packet[2] == Server_Protocol::MSG_JOINED && size >= Server_Protocol::size_joined)
+				{
+					const uint32_t nonce{ Packet::read_u32(packet + 3) };
+					Bot* bot{ find_bot_by_nonce(nonce) };
+					if (bot != nullptr && bot->status == Bot::JOINING)
+					{
+						bot->status = Bot::PLAYING;
+						bot->match = Packet::read_u32(packet + 7);
+						bot->side = packet[11];
+						bot->token = Packet::read_u32(packet + 12);
+						bot->sequence = 0;
+						bot->history = Snapshot_History{};
+						bot->newest_tick = 0;
+						bot->n_received = 0;
+						bot->time_last_state = clock::now();
+						bot_by_match[match_key(bot->match, bot->side)] = static_cast<uint32_t>(bot - bots.data());
+					}
+				}
+				else if (packet[2] == Server_Protocol::MSG_SNAPSHOT && size > Server_Protocol::size_snapshot_header)
+				{
+					auto found{ bot_by_match.find(match_key(Packet::read_u32(packet + 3), packet[7])) };
+					if (found == bot_by_match.end())
+						continue;
+
+					Bot& bot{ bots[found->second] };
+					Snapshot snapshot{};
+					if (!Snapshot_Codec::decode(packet + Server_Protocol::size_snapshot_header, size - Server_Protocol::size_snapshot_header, bot.history, snapshot))
+						continue;
+					bot.history.insert(snapshot);
+					bot.n_received++;
+					bot.shard_address = batch.from(i);
+
+					//Versptete Snapshots dienen nur noch als Baseline.
+					if (snapshot.tick > bot.newest_tick)
+					{
+						bot.newest_tick = snapshot.tick;
+						play(bot, snapshot, batch);
+					}
+				}
+				else if (packet[2] == Server_Protocol::MSG_END && size >= Server_Protocol::size_end)
+				{
+					const uint32_t match{ Packet::read_u32(packet + 3) };
+					for (uint8_t side{ 0 }; side < 2; side++)
+					{
+						auto found{ bot_by_match.find(match_key(match, side)) };
+						if (found != bot_by_match.end() && bots[found->second].socket == static_cast<int>(socket_index))
+						{
+							Bot& bot{ bots[found->second] };
+							bot.status = Bot::JOINING;
+							bot.nonce += static_cast<uint32_t>(bots.size());	//Neuer Nonce fr das nchste Match.
+							bot_by_match.erase(found);
+							n_matches_finished++;
+						}
+					}
+				}
+			}
+			if (n < UDP_Batch::batch_size)
+				break;
+		}
+		batch.flush();
+	}
+
+	Bot* find_bot_by_nonce(uint32_t nonce)
+	{
+		const std::size_t index{ nonce % bots.size() };
+		return (bots[index].nonce == nonce) ? &bots[index] : nullptr;
+	}
+
+	//Entscheide den Input anhand des Zustands und schicke ihn, zusammen mit der Besttigung des Snapshots.
+	void play(Bot& bot, const Snapshot& snapshot, UDP_Batch& batch)
+	{
+		n_states++;
+		bot.time_last_state = clock::now();
+		const float x_ball{ Snapshot_Codec::dequantize(snapshot.x_ball) }, y_ball{ Snapshot_Codec::dequantize(snapshot.y_ball) };
+		const float y_self{ Snapshot_Codec::dequantize(bot.side == 0 ? snapshot.y_left : snapshot.y_right) };
+
+		//Neuer Fehler, sobald der Ball die Richtung wechselt.
+		const bool coming{ bot.side == 0 ? x_ball < bot.x_ball_old : x_ball > bot.x_ball_old };
+		if (!coming)
+			bot.aim_error = std::uniform_real_distribution<float>{ -0.2f, 0.2f }(random_engine);
+		bot.x_ball_old = x_ball;
+
+		const float target{ y_ball + bot.aim_error };
+		uint8_t input{ INPUT_NONE };
+		if (target > y_self + 0.03f)
+			input = INPUT_UP;
+		else if (target < y_self - 0.03f)
+			input = INPUT_DOWN;
+
+		uint8_t* p{ Server_Protocol::write_header(batch.prepare(bot.shard_address), Server_Protocol::MSG_INPUT) };
+		Packet::write_u32(p, bot.match);
+		p[4] = bot.side;
+		Packet::write_u32(p + 5, bot.token);
+		Packet::write_u32(p + 9, ++bot.sequence);
+		p[13] = input;
+		Packet::write_u32(p + 14, bot.newest_tick);
+		Server_Protocol::write_u16(p + 18, bot.n_received);
+		batch.commit(Server_Protocol::size_input);
+	}
+};
+
+//Erzeugt neue Spieler mit einer festen Rate (Poisson-Prozess), um das Matchmaking unter Last zu messen.
+//Jeder Spieler meldet sich mit zuflligem Rating und zuflliger Latenz an und verlsst sein Match wieder,
+//sobald der erste Zustand kommt. So bleiben die Shards leer und nur der Koordinator wird belastet.
+class Join_Generator
+{
+public:
+	Join_Generator() {}
+
+	bool open(const std::string& server_host_and_port, double players_per_minute, int n_sockets = 4)
+	{
+		if (!UDP_Address::resolve(server_host_and_port, server_address))
+			return false;
+
+		epoll_handle = epoll_create1(0);
+		for (int i{ 0 }; i < n_sockets; i++)
+		{
+			sockets.emplace_back();
+			batches.emplace_back();
+			if (!sockets.back().open(0))
+				return false;
+			batches.back().attach(sockets.back().native_handle());
+
+			epoll_event event{};
+			event.events = EPOLLIN;
+			event.data.u32 = static_cast<uint32_t>(i);
+			epoll_ctl(epoll_handle, EPOLL_CTL_ADD, sockets.back().native_handle(), &event);
+		}
+
+		std::random_device seed;
+		random_engine.seed(seed());
+		arrival_distribution = std::exponential_distribution<double>{ players_per_minute / 60.0 };
+		return true;
+	}
+
+	void run(const std::atomic<bool>& running, double report_interval = 5.0)
+	{
+		auto time_last_report{ clock::now() }, time_last_check{ clock::now() };
+		auto time_next_arrival{ clock::now() };
+		while (running)
+		{
+			//Alle flligen Anknfte, auch wenn die Schleife einmal zu spt dran ist.
+			const auto now{ clock::now() };
+			while (time_next_arrival <= now)
+			{
+				add_player(now);
+				time_next_arrival += std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(arrival_distribution(random_engine)));
+			}
+			if (now - time_last_check > std::chrono::milliseconds(100))
+			{
+				check_players(now);
+				time_last_check = now;
+			}
+			for (UDP_Batch& batch : batches)
+				batch.flush();
+
+			epoll_event events[16];
+			int n{ epoll_wait(epoll_handle, events, 16, 1) };
+			for (int i{ 0 }; i < n; i++)
+				receive_packets(events[i].data.u32);
+
+			const double elapsed{ std::chrono::duration<double>(clock::now() - time_last_report).count() };
+			if (report_interval > 0.0 && elapsed >= report_interval)
+			{
+				report(elapsed);
+				time_last_report = clock::now();
+			}
+		}
+	}
+
+	~Join_Generator()
+	{
+		if (epoll_handle >= 0)
+			::close(epoll_handle);
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	struct Player
+	{
+		uint32_t socket{ 0 }, match{ 0 }, token{ 0 };
+		uint16_t rating{ 0 }, latency{ 0 };
+		uint8_t side{ 0 };
+		bool matched{ false };
+		clock::time_point time_arrival{}, time_last_join{};
+	};
+
+	UDP_Address server_address{};
+	std::deque<UDP_Socket> sockets;
+	std::deque<UDP_Batch> batches;
+	int epoll_handle{ -1 };
+	std::mt19937 random_engine{};
+	std::exponential_distribution<double> arrival_distribution{ 1.0 };
+	std::normal_distribution<double> rating_distribution{ 1500.0, 350.0 };
+	std::lognormal_distribution<double> latency_distribution{ std::log(40.0), 0.7 };	//Median 40 ms
+
+	std::unordered_map<uint32_t, Player> players;			//Nonce -> Spieler
+	std::unordered_map<uint64_t, uint32_t> player_by_match;	//(Match, Seite) -> Nonce
+	uint32_t next_nonce{ 1 };
+
+	//Statistik seit dem letzten Bericht
+	uint64_t n_arrivals{ 0 }, n_matched{ 0 }, n_lost{ 0 };
+	std::vector<double> waits;
+
+	static uint64_t match_key(uint32_t match, uint8_t side)
+	{
+		return (static_cast<uint64_t>(match) << 1) | side;
+	}
+
+	void add_player(clock::time_point now)
+	{
+		const uint32_t nonce{ next_nonce++ };
+		Player& player{ players[nonce] };
+		player.socket = nonce % static_cast<uint32_t>(batches.size());
+		player.rating = static_cast<uint16_t>(std::clamp(rating_distribution(random_engine), 0.0, 3000.0));
+		player.latency = static_cast<uint16_t>(std::min(latency_distribution(random_engine), 999.0));
+		player.time_arrival = now;
+		send_join(nonce, player, now);
+		n_arrivals++;
+	}
+
+	void send_join(uint32_t nonce, Player& player, clock::time_point now)
+	{
+		uint8_t* p{ Server_Protocol::write_header(batches[player.socket].prepare(server_address), Server_Protocol::MSG_JOIN) };
+		Packet::write_u32(p, nonce);
+		Server_Protocol::write_u16(p + 4, player.rating);
+		Server_Protocol::write_u16(p + 6, player.latency);
+		batches[player.socket].commit(Server_Protocol::size_join_rated);
+		player.time_last_join = now;
+	}
+
+	//Wartende schicken alle 500 ms ein JOIN. Wer nach 5 s noch keinen Zustand hat, gilt als verloren.
+	void check_players(clock::time_point now)
+	{
+		for (auto it{ players.begin() }; it != players.end();)
+		{
+			Player& player{ it->second };
+			const bool lost{ player.matched ? now - player.time_last_join > std::chrono::seconds(5) : now - player.time_arrival > std::chrono::seconds(30) };
+			if (lost)
+			{
+				if (player.matched)
+					player_by_match.erase(match_key(player.match, player.side));
+				it = players.erase(it);
+				n_lost++;
+				continue;
+			}
+			if (!player.matched && now - player.time_last_join > std::chrono::milliseconds(500))
+				send_join(it->first, player, now);
+			++it;
+		}
+	}
+
+	void receive_packets(uint32_t socket_index)
+	{
+		UDP_Batch& batch{ batches[socket_index] };
+		int n;
+		while ((n = batch.receive()) > 0)
+		{
+			for (int i{ 0 }; i < n; i++)
+			{
+				const uint8_t* packet{ batch.packet(i) };
+				const std::size_t size{ batch.size(i) };
+				if (!Server_Protocol::check_header(packet, size, 3))
+					continue;
+
+				if (packet[2] == Server_Protocol::MSG_JOINED && size >= Server_Protocol::size_joined)
+				{
+					auto found{ players.find(Packet::read_u32(packet + 3)) };
+					if (found == players.end() || found->second.matched)
+						continue;
+					Player& player{ found->second };
+					player.matched = true;
+					player.match = Packet::read_u32(packet + 7);
+					player.side = packet[11];
+					player.token = Packet::read_u32(packet + 12);
+					player.time_last_join = clock::now();
+					player_by_match[match_key(player.match, player.side)] = found->first;
+					waits.push_back(std::chrono::duration<double>(clock::now() - player.time_arrival).count());
+					n_matched++;
+				}
+				//Der erste Zustand kommt vom Shard: Dorthin geht das LEAVE.
+				else if (packet[2] == Server_Protocol::MSG_SNAPSHOT && size >= Server_Protocol::size_snapshot_header)
+				{
+					auto found{ player_by_match.find(match_key(Packet::read_u32(packet + 3), packet[7])) };
+					if (found == player_by_match.end())
+						continue;
+					const Player& player{ players[found->second] };
+					uint8_t* p{ Server_Protocol::write_header(batch.prepare(batch.from(i)), Server_Protocol::MSG_LEAVE) };
+					Packet::write_u32(p, player.match);
+					p[4] = player.side;
+					Packet::write_u32(p + 5, player.token);
+					batch.commit(Server_Protocol::size_leave);
+					players.erase(found->second);
+					player_by_match.erase(found);
+				}
+			}
+			if (n < UDP_Batch::batch_size)
+				break;
+		}
+		batch.flush();
+	}
+
+	void report(double elapsed)
+	{
+		double p50{ 0.0 }, p99{ 0.0 }, max{ 0.0 };
+		if (!waits.empty())
+		{
+			std::sort(waits.begin(), waits.end());
+			p50 = waits[waits.size() / 2];
+			p99 = waits[std::min(waits.size() - 1, waits.size() * 99 / 100)];
+			max = waits.back();
+		}
+		std::size_t n_waiting{ 0 };
+		for (const auto& entry : players)
+			n_waiting += !entry.second.matched;
+		printf("[arrivals] %.0f/min arrived, %.0f/min matched, %zu waiting, %llu lost | time to match p50 %.1f ms, p99 %.1f ms, max %.1f ms\n",
+			60.0 * n_arrivals / elapsed, 60.0 * n_matched / elapsed, n_waiting, static_cast<unsigned long long>(n_lost), 1e3 * p50, 1e3 * p99, 1e3 * max);
+		fflush(stdout);
+		n_arrivals = 0;
+		n_matched = 0;
+		n_lost = 0;
+		waits.clear();
+	}
+};
@@ -0,0 +1,559 @@
+#pragma once
+
+//Simulation vom Pong-Spiel ohne SDL oder OpenGL: Schlger, Ball, K.I. und Punktestand.
+//Die Zeit wird in Ticks gezhlt und nicht mit der Uhr gemessen. Zwei Programme, welche dieselben Inputs erhalten,
+//berechnen so denselben Zustand (gleicher Compiler und gleiche Fliesskomma-Einstellungen vorausgesetzt).
+//Die Strukturen enthalten keine Zeiger und knnen einfach kopiert werden.
+
+#include <cmath>		//Fr sqrt, sin und abs.
+#include <cstdint>		//Fr Integer mit fester Grsse.
+#include <cstddef>		//Fr std::size_t.
+#include <type_traits>	//Fr std::is_trivially_copyable.
+
+//K.I. Verhalten Schlger
+enum Personality
+{
+	CALM,
+	AGGRESSIVE,
+	STRATEGIC,
+};
+
+enum Intelligence
+{
+	PLAYER,
+	DUMB,
+	SMART,
+};
+
+//Input eines Spielers fr einen Tick.
+enum Paddle_Input : uint8_t
+{
+	INPUT_NONE = 0,
+	INPUT_UP = 1,
+	INPUT_DOWN = 2,
+};
+
+//Was whrend eines Ticks passiert ist, damit das Spiel Sounds abspielen und die Portraits anpassen kann.
+enum Sim_Event : unsigned
+{
+	EVENT_HIT_LEFT = 1u << 0,		//Ball trifft den linken Schlger.
+	EVENT_HIT_RIGHT = 1u << 1,		//Ball trifft den rechten Schlger.
+	EVENT_EDGE_UP = 1u << 2,		//Ball prallt vom oberen Rand ab.
+	EVENT_EDGE_DOWN = 1u << 3,		//Ball prallt vom unteren Rand ab.
+	EVENT_POINT_LEFT = 1u << 4,		//Linker Spieler macht einen Punkt.
+	EVENT_POINT_RIGHT = 1u << 5,	//Rechter Spieler macht einen Punkt.
+	EVENT_SERVE = 1u << 6,			//Ball ist nach einem Punkt wieder im Spiel.
+};
+
+namespace Simulation
+{
+	constexpr int tick_rate{ 60 };
+	constexpr double dt{ 1.0 / static_cast<double>(tick_rate) };
+	constexpr float level_border{ 0.1f };	//Der Punkt, wo der Ball vom Rand abprallt.
+}
+
+struct Sim_Ball;
+
+struct Sim_Schlaeger
+{
+	Sim_Schlaeger(double x = 0.0, Intelligence in = PLAYER, Personality p = CALM) : x{ x }, personality{ p }, intelligence{ in }
+	{}
+
+	void reset_position()
+	{
+		y = 0.0;
+		y_old = 0.0;
+	}
+
+	void process_input(uint8_t input)
+	{
+		if (input & INPUT_UP)
+			v_y = v_max;
+		else if (input & INPUT_DOWN)
+			v_y = -v_max;
+		else
+			v_y = 0.0;
+	}
+
+	void update_physics(double dt)
+	{
+		y_old = y;
+
+		bool collision_up = (y + 0.5 * height >= 1.0 - Simulation::level_border) && v_y > 0.0;
+		bool collision_down = (y - 0.5 * height <= -1.0 + Simulation::level_border) && v_y < 0.0;
+		if (collision_down || collision_up)
+			v_y = 0.0;
+
+		y += v_y * dt;
+	}
+
+	double set_reaction_time(double multiplier);
+
+	bool move_to_centre(double tiredness = 0.2, double radius = 0.001)
+	{
+		if (y < -radius)
+		{
+			v_y = tiredness * v_max;
+			return false;
+		}
+		else if (y > radius)
+		{
+			v_y = -tiredness * v_max;
+			return false;
+		}
+		else
+		{
+			v_y = 0.0;
+			return true;
+		}
+	}
+
+	void wiggle(double t, double speed = 5.0, double amplitude = 0.5)
+	{
+		double omega = speed / amplitude;
+
+		if (move_to_centre(1.0, amplitude + 0.1))
+			v_y = -1.0 * amplitude * omega * std::sin(omega * t);
+	}
+
+	double determine_Ball_path(const Sim_Ball& ball) const;
+
+	void move_to_Ball(const Sim_Ball& ball);
+
+	//t: Simulationszeit in Sekunden.
+	void react_to_Ball(const Sim_Ball& ball, double t);
+
+	//Physik-Variablen
+	double x, y{ 0.0 }, y_old{ 0.0 };
+	double v_y{ 0.0 };
+	double y_ball{ 0.0 }; //Fr die Berechnung, wo der Ball ist.
+
+	//K.I.
+	Personality personality;
+	Intelligence intelligence;
+	bool lost_last_round{ false };
+
+	//Timer. t_start < 0: Der Ball kommt noch nicht auf den Schlger zu.
+	double t_start{ -1.0 }, t_react{ 0.0 }, t_react_multiplier{ 1.0 };
+
+	static constexpr double v_max{ 2.0 };
+	static constexpr float width{ 0.05f }, height{ 4.5f * 0.05f };
+};
+
+struct Sim_Ball
+{
+	//Resette alle Variablen ausser v_x
+	void soft_reset(double t)
+	{
+		//Warte 1 Sekunde lang und starte dann den Ball neu
+		if (pause(t, 1.0))
+		{
+			x = x_start;
+			y = y_start;
+			x_old = x_start;
+			y_old = y_start;
+			v_y = -v_start / std::sqrt(2.0);
+		}
+		else
+		{
+			//Bewege in der Zwischenzeit den Ball ausserhalb des Bildschirms
+			x = 0.0;
+			x_old = 0.0;
+			y = 2.0;
+			y_old = 2.0;
+			v_y = 0.0;
+		}
+	}
+
+	//Resette alle Variablen auf die Startwerte
+	void reset(double t)
+	{
+		soft_reset(t);
+		v_x = -v_start / std::sqrt(2.0);
+	}
+
+	//Gibt event_hit zurck, falls der Ball den Schlger trifft.
+	unsigned check_collision_schlaeger(const Sim_Schlaeger& schlaeger, unsigned event_hit);
+
+	unsigned update_physics(double dt, double t, Sim_Schlaeger& left, Sim_Schlaeger& right, uint16_t& score_left, uint16_t& score_right);
+
+	//Warte duration Sekunden lang (Simulationszeit).
+	bool pause(double t, double duration)
+	{
+		//Beginne den Timer
+		if (!pausing)
+		{
+			t_pause = t;
+			pausing = true;
+			return false;
+		}
+		//Falls die Zeit vorbei ist
+		else if (t - t_pause > duration)
+		{
+			pausing = false;
+			return true;
+		}
+		else
+			return false;
+	}
+
+	static constexpr double x_start{ 0.0 }, y_start{ 1.0 - Simulation::level_border };
+	static constexpr double v_start{ 1.0 }, v_max{ 3.0 * v_start };
+	static constexpr float radius{ 0.02f }, width{ 2.0f * radius }, height{ 2.0f * radius };
+
+	//Physik-Variablen
+	double x{ x_start }, y{ y_start }, x_old{ x_start }, y_old{ y_start };
+	double v_x{ -v_start / std::sqrt(2.0) }, v_y{ -v_start / std::sqrt(2.0) };
+	int n_hits{ 0 };	//Anzahl Schlgertreffer seit dem Start.
+
+	//Timer
+	bool pausing{ false }, changed_to_neutral{ true };
+	double t_pause{ 0.0 };
+};
+
+//Ein ganzes Match. Links ist der Spieler, rechts der Gegner (K.I. oder zweiter Spieler).
+struct Sim_Match
+{
+	Sim_Schlaeger left{ -0.8, PLAYER }, right{ 0.8, SMART };
+	Sim_Ball ball{};
+	uint16_t score_left{ 0 }, score_right{ 0 };
+	uint32_t tick{ 0 };
+
+	//Simulationszeit in Sekunden.
+	double time() const
+	{
+		return static_cast<double>(tick) * Simulation::dt;
+	}
+
+	void reset_score()
+	{
+		score_left = 0;
+		score_right = 0;
+	}
+
+	//Simuliere einen Tick. Die Inputs werden nur fr Schlger verwendet, die von einem Spieler gesteuert werden.
+	//Gibt die Sim_Event zurck, die whrend des Ticks passiert sind.
+	unsigned step(uint8_t input_left, uint8_t input_right)
+	{
+		const double t{ time() };
+
+		if (left.intelligence == PLAYER)
+			left.process_input(input_left);
+		else
+			left.react_to_Ball(ball, t);
+
+		if (right.intelligence == PLAYER)
+			right.process_input(input_right);
+		else
+			right.react_to_Ball(ball, t);
+
+		left.update_physics(Simulation::dt);
+		right.update_physics(Simulation::dt);
+		unsigned events{ ball.update_physics(Simulation::dt, t, left, right, score_left, score_right) };
+
+		tick++;
+		return events;
+	}
+
+	//Prfsumme ber den Zustand (FNV-1a), um zu testen, ob zwei Simulationen auseinanderlaufen.
+	uint32_t checksum() const
+	{
+		uint32_t hash{ 2166136261u };
+		auto add = [&hash](const void* data, std::size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (std::size_t i{ 0 }; i < size; i++)
+			{
+				hash ^= bytes[i];
+				hash *= 16777619u;
+			}
+		};
+		add(&left.y, sizeof(double));
+		add(&left.v_y, sizeof(double));
+		add(&right.y, sizeof(double));
+		add(&right.v_y, sizeof(double));
+		add(&ball.x, sizeof(double));
+		add(&ball.y, sizeof(double));
+		add(&ball.v_x, sizeof(double));
+		add(&ball.v_y, sizeof(double));
+		add(&score_left, sizeof(uint16_t));
+		add(&score_right, sizeof(uint16_t));
+		add(&tick, sizeof(uint32_t));
+		return hash;
+	}
+};
+
+//Fr Rollback wird der Zustand pro Tick kopiert. Das muss ohne Allokation und ohne Konstruktoren gehen.
+static_assert(std::is_trivially_copyable<Sim_Match>::value, "Sim_Match must be trivially copyable");
+
+//Funktionen, die andere Objekte bentigen
+inline double Sim_Schlaeger::set_reaction_time(double multiplier)
+{
+	const double speed_ratio = std::abs(Sim_Ball::v_start / (std::sqrt(2.0) * v_max));
+
+	//Vertical Distance Schlaeger to Edge
+	const double distance_zero_to_edge = 1.0 - Simulation::level_border - 0.5 * height;
+	const double distance_edge_to_edge = 2.0 - 2.0 * Simulation::level_border - height;
+
+	//Horizontal Distance Ball to Schlaeger
+	const double distance_ball_to_self = speed_ratio * distance_zero_to_edge;
+	const double distance_ball_from_opponent = 2.0 * std::abs(x) - width - distance_ball_to_self;
+
+	//Maximal erlaubte Distanz fr t_react_min
+	const double max_distance_ball_to_self = speed_ratio * distance_edge_to_edge;
+	const double max_distance_ball_from_opponent = 2.0 * std::abs(x) - width - max_distance_ball_to_self;
+
+	//Minimal erlaubte Distanz fr t_react_max
+	const double min_distance_ball_to_self = 0.2;
+	const double min_distance_ball_from_opponent = 2.0 * std::abs(x) - width - min_distance_ball_to_self;
+
+	//Reaktionszeit
+	t_react_multiplier = multiplier;
+	t_react = distance_ball_from_opponent / (Sim_Ball::v_start / std::sqrt(2.0));
+	const double t_react_min = max_distance_ball_from_opponent / (Sim_Ball::v_start / std::sqrt(2.0));
+	const double t_react_max = min_distance_ball_from_opponent / (Sim_Ball::v_start / std::sqrt(2.0));
+
+	t_react = multiplier * t_react;
+	if (t_react <= t_react_min)
+		t_react = t_react_min;
+	else if (t_react >= t_react_max)
+		t_react = t_react_max;
+
+	return t_react;
+}
+
+inline double Sim_Schlaeger::determine_Ball_path(const Sim_Ball& ball) const
+{
+	double x_Ball = ball.x, y_Ball = ball.y, v_Ball = ball.v_y;
+
+	while (std::abs(x_Ball) < std::abs(x - 0.5 * (double)width))
+	{
+		x_Ball += ball.v_x * Simulation::dt;
+
+		bool collision_up = (y_Ball + 0.5 * Sim_Ball::height >= 1.0 - Simulation::level_border) && v_Ball > 0.0;
+		bool collision_down = (y_Ball - 0.5 * Sim_Ball::height <= -1.0 + Simulation::level_border) && v_Ball < 0.0;
+
+		if (collision_down || collision_up)
+			v_Ball = -1.0 * v_Ball;
+
+		y_Ball += v_Ball * Simulation::dt;
+	}
+	return y_Ball;
+}
+
+inline void Sim_Schlaeger::move_to_Ball(const Sim_Ball& ball)
+{
+	if (std::abs(x - ball.x) > 0.01 + 0.5 * width)
+	{
+		//Bewege dich direkt zum Ball hin.
+		if (intelligence == DUMB)
+		{
+			y_ball = ball.y;
+		}
+
+		if (y + 0.3 * height < y_ball)
+		{
+			v_y = v_max;
+		}
+		else if (y - 0.3 * height > y_ball)
+		{
+			v_y = -v_max;
+		}
+		else
+		{
+			v_y = 0.0;
+		}
+	}
+	//Beschleunige oder verlangsame den Ball, je nach Persnlichkeit
+	else
+	{
+		double sign = ball.v_y / std::abs(ball.v_y);
+		switch (personality)
+		{
+		case CALM:
+			v_y = -1.0 * sign * v_max;
+			break;
+
+		case AGGRESSIVE:
+			v_y = sign * v_max;
+			break;
+
+		case STRATEGIC:
+			double v_middle = (Sim_Ball::v_max + Sim_Ball::v_start) / 2.0;
+			if (ball.v_y > v_middle)
+				v_y = -1.0 * sign * v_max;
+			else
+				v_y = sign * v_max;
+			break;
+		}
+	}
+}
+
+inline void Sim_Schlaeger::react_to_Ball(const Sim_Ball& ball, double t)
+{
+	//Am Start der Runde, wenn der Ball ausserhalb des Bildschirms ist
+	if (std::abs(ball.y) >= 1.0)
+	{
+		//Setzte temporr die Reaktionszeit auf 0.5, damit am Start der Runde der Schlger den Ball erwischt.
+		if (lost_last_round)
+			t_react = 0.5;
+
+		switch (personality)
+		{
+		case CALM:
+			v_y = 0.0;
+			break;
+
+		case AGGRESSIVE:
+			wiggle(t, 4.0 * v_max, 0.2);
+			break;
+
+		case STRATEGIC:
+			move_to_centre();
+			break;
+		}
+	}
+	//Falls sich der Ball zum Schlger hin bewegt
+	else if ((ball.x < x && ball.v_x > 0.0) || (ball.x > x && ball.v_x < 0.0))
+	{
+		if (t_start < 0.0)
+		{
+			if (intelligence == SMART)
+				y_ball = determine_Ball_path(ball);
+			t_start = t;
+		}
+		else if (t - t_start >= t_react)
+		{
+			move_to_Ball(ball);
+		}
+		else
+		{
+			switch (personality)
+			{
+			case CALM:
+				v_y = 0.0;
+				break;
+
+			case AGGRESSIVE:
+				wiggle(t, v_max, 0.5);
+				break;
+
+			case STRATEGIC:
+				move_to_centre();
+				break;
+			}
+		}
+	}
+	else
+	{
+		t_start = -1.0;
+		if (lost_last_round)
+		{
+			t_react = set_reaction_time(t_react_multiplier);
+			lost_last_round = false;
+		}
+		//Was der Schlger tut, wenn der Ball nicht zu ihm geht.
+		switch (personality)
+		{
+		case CALM:
+			v_y = 0.0;
+			break;
+
+		case AGGRESSIVE:
+			wiggle(t, v_max, 0.5);
+			break;
+
+		case STRATEGIC:
+			move_to_centre();
+			break;
+		}
+	}
+}
+
+inline unsigned Sim_Ball::check_collision_schlaeger(const Sim_Schlaeger& schlaeger, unsigned event_hit)
+{
+	const double damping{ 0.5 }; //Um wie viel der Ball die Geschwindigkeit vom Schlger bernimmt.
+	const double off{ 0.01 };	 //Es fhlt sich besser an, wenn der Ball im Schlger etwas versinkt.
+
+	//Teste, ob eine Kollsion von links oder rechts erfolgt.
+	bool coll_y{ (y - 0.5 * height) <= (schlaeger.y + 0.5 * schlaeger.height) && (y + 0.5 * height) >= (schlaeger.y - 0.5 * schlaeger.height) };	//Ball und Schlger sind auf gleicher Hhe.
+	bool coll_right{ (x - 0.5 * width + off) <= (schlaeger.x + 0.5 * schlaeger.width) && (x - 0.5 * width + off) >= schlaeger.x && v_x < 0.0 };	//Kollsion rechts.
+	bool coll_left{ (x + 0.5 * width - off) >= (schlaeger.x - 0.5 * schlaeger.width) && (x + 0.5 * width - off) <= schlaeger.x && v_x > 0.0 };	//Kollision links.
+
+	//Teste, ob eine Kollsion von oben oder unten erfolgt.
+	bool coll_x{ (x - 0.5 * width) <= (schlaeger.x + 0.5 * schlaeger.width) && (x + 0.5 * width) >= (schlaeger.x - 0.5 * schlaeger.width) };		//Ball und Schlger sind bereinander.
+	bool coll_up{ (y - 0.5 * height + off) <= (schlaeger.y + 0.5 * schlaeger.height) && (y - 0.5 * height + off) >= schlaeger.y && v_y < 0.0 };		//Kollision oben.
+	bool coll_down{ (y + height - off) >= (schlaeger.y - 0.5 * schlaeger.height) && (y + 0.5 * height - off) <= schlaeger.y && v_y > 0.0 };	//Kollision unten.
+
+	//Falls es zu einer horizontalen Kollision kommt.
+	if (coll_y && (coll_left || coll_right))
+	{
+		n_hits++;
+		v_x = -v_x;
+		//Falls v_max nicht berschritten wird, erhhe v_y anhand der Geschwindigkeit des Schlgers.
+		if (v_x * v_x + v_y * v_y <= v_max * v_max)
+			v_y += damping * schlaeger.v_y;
+		return event_hit;
+	}
+	//Falls nicht, teste ob eine Kollision von oben oder unten erfolgt.
+	else if (coll_x && (coll_up || coll_down))
+	{
+		n_hits++;
+		v_y = -v_y;
+		return event_hit;
+	}
+	return 0;
+}
+
+inline unsigned Sim_Ball::update_physics(double dt, double t, Sim_Schlaeger& left, Sim_Schlaeger& right, uint16_t& score_left, uint16_t& score_right)
+{
+	unsigned events{ 0 };
+	x_old = x;
+	y_old = y;
+
+	//Kollision oberer oder unterer Rand
+	bool collision_up = (y + 0.5 * height >= 1.0 - Simulation::level_border) && v_y > 0.0;
+	bool collision_down = (y - 0.5 * height <= -1.0 + Simulation::level_border) && v_y < 0.0;
+
+	if (collision_down || collision_up)
+	{
+		v_y = -v_y;
+		events |= collision_down ? EVENT_EDGE_DOWN : EVENT_EDGE_UP;
+	}
+
+	//Falls der Ball aus dem Bildschirm herausfliegt oder die horizontale Geschwindigkeit 0 ist.
+	if (std::abs(x) >= 1.0 || std::abs(y) >= 1.0 || v_x == 0)
+	{
+		//Linker Rand
+		if (x <= -1.0)
+		{
+			score_right++;
+			right.lost_last_round = false;
+			left.lost_last_round = true;
+			events |= EVENT_POINT_RIGHT;
+		}
+		//Rechter Rand
+		else if (x >= 1.0)
+		{
+			score_left++;
+			left.lost_last_round = false;
+			right.lost_last_round = true;
+			events |= EVENT_POINT_LEFT;
+		}
+		changed_to_neutral = false;
+		soft_reset(t);
+	}
+	else if (!changed_to_neutral)
+	{
+		changed_to_neutral = true;
+		events |= EVENT_SERVE;
+	}
+
+	//Kollision Schlger
+	events |= check_collision_schlaeger(left, EVENT_HIT_LEFT);
+	events |= check_collision_schlaeger(right, EVENT_HIT_RIGHT);
+
+	x += v_x * dt;
+	y += v_y * dt;
+	return events;
+}
@@ -0,0 +1,352 @@
+#pragma once
+
+//Kompakte Zustnde fr Clients ohne eigene Simulation (Zuschauer, Thin Clients). Bewusst ohne SDL und ohne Sockets,
+//damit Server, Relay und Spiel denselben Header nutzen knnen.
+#include "Pong_Simulation.h"
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+//Schreibt Bits in einen Puffer, das niederwertigste Bit zuerst.
+class Bit_Writer
+{
+public:
+	Bit_Writer(uint8_t* buffer, std::size_t capacity) : data{ buffer }, size_bytes{ capacity }
+	{
+		memset(data, 0, size_bytes);
+	}
+
+	void write(uint32_t value, int n_bits)
+	{
+		for (int i{ 0 }; i < n_bits; i++, position++)
+		{
+			if (position >= 8 * size_bytes)
+			{
+				overflowed = true;
+				return;
+			}
+			if ((value >> i) & 1u)
+				data[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+		}
+	}
+
+	void write_signed(int32_t value, int n_bits)
+	{
+		write(static_cast<uint32_t>(value), n_bits);
+	}
+
+	//Anzahl angefangener Bytes.
+	std::size_t size() const
+	{
+		return (position + 7) / 8;
+	}
+
+	bool overflow() const
+	{
+		return overflowed;
+	}
+
+private:
+	uint8_t* data;
+	std::size_t size_bytes;
+	std::size_t position{ 0 };
+	bool overflowed{ false };
+};
+
+class Bit_Reader
+{
+public:
+	Bit_Reader(const uint8_t* buffer, std::size_t size) : data{ buffer }, size_bytes{ size } {}
+
+	uint32_t read(int n_bits)
+	{
+		uint32_t value{ 0 };
+		for (int i{ 0 }; i < n_bits; i++, position++)
+		{
+			if (position >= 8 * size_bytes)
+			{
+				overflowed = true;
+				return 0;
+			}
+			value |= static_cast<uint32_t>((data[position >> 3] >> (position & 7)) & 1u) << i;
+		}
+		return value;
+	}
+
+	int32_t read_signed(int n_bits)
+	{
+		const uint32_t value{ read(n_bits) };
+		const uint32_t sign{ 1u << (n_bits - 1) };
+		return static_cast<int32_t>((value ^ sign) - sign);
+	}
+
+	bool overflow() const
+	{
+		return overflowed;
+	}
+
+private:
+	const uint8_t* data;
+	std::size_t size_bytes;
+	std::size_t position{ 0 };
+	bool overflowed{ false };
+};
+
+//Quantisierter Zustand eines Matches nach einem Tick. Positionen in 1/2048 Lngeneinheiten (das Spielfeld ist 2 breit),
+//Geschwindigkeiten als Verschiebung im letzten Tick in 1/16 dieser Einheit.
+struct Snapshot
+{
+	uint32_t tick{ 0 };
+	int16_t x_ball{ 0 }, y_ball{ 0 }, y_left{ 0 }, y_right{ 0 };
+	int16_t vx_ball{ 0 }, vy_ball{ 0 }, vy_left{ 0 }, vy_right{ 0 };
+	uint16_t score_left{ 0 }, score_right{ 0 };
+};
+
+//Die letzten Snapshots, nach Tick. Der Server merkt sich die gesendeten, der Client die empfangenen.
+class Snapshot_History
+{
+public:
+	static constexpr uint32_t size{ 32 };
+
+	void insert(const Snapshot& snapshot)
+	{
+		entries[snapshot.tick % size] = snapshot;
+	}
+
+	//Gibt den Snapshot mit genau diesem Tick zurck, falls er noch da ist.
+	const Snapshot* find(uint32_t tick) const
+	{
+		const Snapshot& entry{ entries[tick % size] };
+		return (entry.tick == tick && tick != 0) ? &entry : nullptr;
+	}
+
+	//Wie find(), aber nur die untersten 8 Bits des Ticks sind bekannt.
+	const Snapshot* find_low_bits(uint32_t tick_low) const
+	{
+		const Snapshot& entry{ entries[tick_low % size] };
+		return ((entry.tick & 0xFF) == tick_low && entry.tick != 0) ? &entry : nullptr;
+	}
+
+private:
+	Snapshot entries[size]{};
+};
+
+//Kodiert Snapshots bitweise, entweder vollstndig (Keyframe) oder als Differenz zu einem Snapshot, den der Client
+//besttigt hat (Baseline). Positionen werden dabei mit der Geschwindigkeit der Baseline vorhergesagt, so dass ein
+//fliegender Ball meistens nur 1-2 Bits kostet. Ein Delta-Snapshot braucht so im Mittel etwa 7 Bytes (6.8-7.2 mit
+//pong_server --bots gemessen). Die 8 Bytes vom Paket-Header des Servers kommen noch dazu und sind dabei nicht gezhlt.
+namespace Snapshot_Codec
+{
+	constexpr double scale{ 2048.0 };
+	constexpr int velocity_bits{ 4 };		//Nachkommabits der Geschwindigkeit.
+	constexpr uint32_t max_distance{ 31 };	//Hchstens so viele Ticks liegt die Baseline zurck.
+
+	inline int16_t quantize(double value, double factor = scale)
+	{
+		return static_cast<int16_t>(std::clamp<long>(std::lround(value * factor), INT16_MIN, INT16_MAX));
+	}
+
+	inline float dequantize(int16_t q)
+	{
+		return static_cast<float>(q / scale);
+	}
+
+	inline Snapshot capture(const Sim_Match& match)
+	{
+		constexpr double velocity_scale{ scale * (1 << velocity_bits) };
+		Snapshot snapshot{};
+		snapshot.tick = match.tick;
+		snapshot.x_ball = quantize(match.ball.x);
+		snapshot.y_ball = quantize(match.ball.y);
+		snapshot.y_left = quantize(match.left.y);
+		snapshot.y_right = quantize(match.right.y);
+		snapshot.vx_ball = quantize(match.ball.x - match.ball.x_old, velocity_scale);
+		snapshot.vy_ball = quantize(match.ball.y - match.ball.y_old, velocity_scale);
+		snapshot.vy_left = quantize(match.left.y - match.left.y_old, velocity_scale);
+		snapshot.vy_right = quantize(match.right.y - match.right.y_old, velocity_scale);
+		snapshot.score_left = match.score_left;
+		snapshot.score_right = match.score_right;
+		return snapshot;
+	}
+
+	inline int32_t predict(int16_t position, int16_t velocity, uint32_t distance)
+	{
+		return position + ((velocity * static_cast<int32_t>(distance) + (1 << (velocity_bits - 1))) >> velocity_bits);
+	}
+
+	//Prfixcode fr Abweichungen: 0 -> 1 Bit, |r| < 8 -> 6 Bits, |r| < 128 -> 11 Bits, sonst 20 Bits.
+	inline void write_residual(Bit_Writer& out, int32_t r)
+	{
+		if (r == 0)
+			out.write(0, 1);
+		else if (r >= -8 && r < 8)
+		{
+			out.write(0b01, 2);
+			out.write_signed(r, 4);
+		}
+		else if (r >= -128 && r < 128)
+		{
+			out.write(0b011, 3);
+			out.write_signed(r, 8);
+		}
+		else
+		{
+			out.write(0b111, 3);
+			out.write_signed(r, 17);
+		}
+	}
+
+	inline int32_t read_residual(Bit_Reader& in)
+	{
+		if (in.read(1) == 0)
+			return 0;
+		if (in.read(1) == 0)
+			return in.read_signed(4);
+		if (in.read(1) == 0)
+			return in.read_signed(8);
+		return in.read_signed(17);
+	}
+
+	//Ohne Baseline (nullptr) wird ein Keyframe geschrieben. Gibt die Anzahl Bytes zurck (0, falls der Puffer zu klein ist).
+	inline std::size_t encode(const Snapshot& current, const Snapshot* baseline, uint8_t* out, std::size_t capacity)
+	{
+		Bit_Writer writer{ out, capacity };
+		if (baseline == nullptr)
+		{
+			writer.write(1, 1);
+			writer.write(current.tick, 32);
+			for (int16_t value : { current.x_ball, current.y_ball, current.y_left, current.y_right,
+				current.vx_ball, current.vy_ball, current.vy_left, current.vy_right })
+				writer.write(static_cast<uint16_t>(value), 16);
+			writer.write(current.score_left, 16);
+			writer.write(current.score_right, 16);
+		}
+		else
+		{
+			const Snapshot& base{ *baseline };
+			const uint32_t distance{ current.tick - base.tick };
+			writer.write(0, 1);
+			writer.write(base.tick & 0xFF, 8);
+			writer.write(distance - 1, 5);
+
+			write_residual(writer, current.vx_ball - base.vx_ball);
+			write_residual(writer, current.vy_ball - base.vy_ball);
+			write_residual(writer, current.vy_left - base.vy_left);
+			write_residual(writer, current.vy_right - base.vy_right);
+			write_residual(writer, current.x_ball - predict(base.x_ball, base.vx_ball, distance));
+			write_residual(writer, current.y_ball - predict(base.y_ball, base.vy_ball, distance));
+			write_residual(writer, current.y_left - predict(base.y_left, base.vy_left, distance));
+			write_residual(writer, current.y_right - predict(base.y_right, base.vy_right, distance));
+			write_residual(writer, current.score_left - base.score_left);
+			write_residual(writer, current.score_right - base.score_right);
+		}
+		return writer.overflow() ? 0 : writer.size();
+	}
+
+	//Gibt false zurck, falls das Paket kaputt ist oder die Baseline fehlt (dann muss der Client auf einen Keyframe warten).
+	inline bool decode(const uint8_t* in, std::size_t size, const Snapshot_History& history, Snapshot& snapshot)
+	{
+		Bit_Reader reader{ in, size };
+		if (reader.read(1) == 1)
+		{
+			snapshot.tick = reader.read(32);
+			for (int16_t* value : { &snapshot.x_ball, &snapshot.y_ball, &snapshot.y_left, &snapshot.y_right,
+				&snapshot.vx_ball, &snapshot.vy_ball, &snapshot.vy_left, &snapshot.vy_right })
+				*value = static_cast<int16_t>(reader.read(16));
+			snapshot.score_left = static_cast<uint16_t>(reader.read(16));
+			snapshot.score_right = static_cast<uint16_t>(reader.read(16));
+			return !reader.overflow();
+		}
+
+		const Snapshot* baseline{ history.find_low_bits(reader.read(8)) };
+		const uint32_t distance{ reader.read(5) + 1 };
+		if (baseline == nullptr)
+			return false;
+
+		const Snapshot& base{ *baseline };
+		snapshot.tick = base.tick + distance;
+		snapshot.vx_ball = static_cast<int16_t>(base.vx_ball + read_residual(reader));
+		snapshot.vy_ball = static_cast<int16_t>(base.vy_ball + read_residual(reader));
+		snapshot.vy_left = static_cast<int16_t>(base.vy_left + read_residual(reader));
+		snapshot.vy_right = static_cast<int16_t>(base.vy_right + read_residual(reader));
+		snapshot.x_ball = static_cast<int16_t>(predict(base.x_ball, base.vx_ball, distance) + read_residual(reader));
+		snapshot.y_ball = static_cast<int16_t>(predict(base.y_ball, base.vy_ball, distance) + read_residual(reader));
+		snapshot.y_left = static_cast<int16_t>(predict(base.y_left, base.vy_left, distance) + read_residual(reader));
+		snapshot.y_right = static_cast<int16_t>(predict(base.y_right, base.vy_right, distance) + read_residual(reader));
+		snapshot.score_left = static_cast<uint16_t>(base.score_left + read_residual(reader));
+		snapshot.score_right = static_cast<uint16_t>(base.score_right + read_residual(reader));
+		return !reader.overflow();
+	}
+};
+
+//Passt die Rate der Snapshots pro Client an die gemessene Bandbreite an. Der Client meldet, wie viele Snapshots
+//er empfangen hat. Gehen mehr als 5% verloren, wird halb so oft gesendet, sonst langsam wieder fter (AIMD).
+//Zustzlich kann ein Budget in Bytes pro Sekunde die Rate begrenzen.
+class Snapshot_Rate
+{
+public:
+	static constexpr uint32_t max_interval{ 8 };
+
+	bool due(uint32_t tick) const
+	{
+		return tick - tick_last_sent >= interval;
+	}
+
+	void sent(uint32_t tick, std::size_t bytes)
+	{
+		tick_last_sent = tick;
+		n_sent++;
+		bytes_sent += static_cast<uint32_t>(bytes);
+	}
+
+	//Zhler der empfangenen Snapshots vom Client (16 Bit, darf berlaufen).
+	void received(uint16_t total)
+	{
+		n_received += static_cast<uint16_t>(total - last_received_total);
+		last_received_total = total;
+	}
+
+	//Einmal pro Tick aufrufen. budget: Bytes pro Sekunde, 0 fr unbegrenzt.
+	void update(uint32_t tick, double budget)
+	{
+		if (tick - tick_window < static_cast<uint32_t>(Simulation::tick_rate))
+			return;
+		tick_window = tick;
+
+		if (n_sent > 0)
+		{
+			const double loss{ 1.0 - std::min(1.0, static_cast<double>(n_received) / n_sent) };
+			if (loss > 0.05)
+			{
+				interval = std::min(max_interval, 2 * interval);
+				good_windows = 0;
+			}
+			else if (loss < 0.01 && ++good_windows >= 2 && interval > 1)
+			{
+				interval--;
+				good_windows = 0;
+			}
+
+			if (budget > 0.0)
+			{
+				const double bytes_per_snapshot{ static_cast<double>(bytes_sent) / n_sent };
+				const double needed{ std::ceil(bytes_per_snapshot * Simulation::tick_rate / budget) };
+				interval = std::clamp(std::max(interval, static_cast<uint32_t>(needed)), 1u, max_interval);
+			}
+		}
+		n_sent = n_received = bytes_sent = 0;
+	}
+
+	uint32_t get_interval() const
+	{
+		return interval;
+	}
+
+private:
+	uint32_t interval{ 1 };
+	uint32_t tick_last_sent{ 0 }, tick_window{ 0 };
+	uint32_t n_sent{ 0 }, n_received{ 0 }, bytes_sent{ 0 };
+	uint16_t last_received_total{ 0 };
+	int good_windows{ 0 };
+};
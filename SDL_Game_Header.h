@@ -7,6 +7,16 @@
 #include <sstream>		//Fr stringstream: Erlaubt es Text zu haben, wo man leicht mehr Text hinzufgen kann.
 #include <vector>		//Fr Vektor-Klasse (dynamische Arrays).
 #include <chrono>		//Um die Zeit zu messen.
+#include <algorithm>	//Fr std::min, std::clamp etc.
+#include <cstdint>		//Fr Integer mit fester Grsse wie uint8_t.
+#include <map>			//Fr std::map.
+#include <filesystem>	//Fr den Ordner des Shader-Caches.
+#include <unordered_map>	//Fr den Uniform-Cache.
+#include <array>		//Fr std::array.
+#include <thread>		//Fr std::this_thread::sleep_for im Bildraten-Begrenzer und den Simulations-Thread.
+#include <atomic>		//Fr den Dreifach-Puffer zwischen Simulation und Zeichnen.
+#include <mutex>		//Fr std::mutex.
+#include <functional>	//Fr std::function.
 
 //SDL and GLAD libraries.
 #include <SDL.h>		//SDL Hauptheader.
@@ -89,15 +99,41 @@ class MainWindowClass
 {
 public:
 	MainWindowClass(int window_width = 1280, int window_height = 720, const std::string& window_icon_path = "Textures\\Window_Icon.png") :
-		window_width{ window_width }, window_height{ window_height }
+		window_width{ window_width }, window_height{ window_height }, icon_path{ window_icon_path }
 	{
+		//Fr die Shader: w/h als float. Wird von statischen Objekten schon vor open() gebraucht.
+		window_ratio = static_cast<float>(window_width) / static_cast<float>(window_height);
+	}
+
+	//Erstellt Fenster und OpenGL-Context. Erst in main, damit die Kommandozeile das Backend whlen kann.
+	//offscreen: Kein sichtbares Fenster. SDL holt den Context ber EGL ohne Display (Mesa surfaceless, standardmssig
+	//mit Software-Rendering), gezeichnet wird dann in ein Framebuffer-Objekt. Fr Benchmarks, Vergleichsbilder und Video-Export ohne GPU.
+	void open(bool offscreen_backend = false)
+	{
+		if (opened)
+			return;
+		offscreen = offscreen_backend;
+
+		//Muss vor SDL_Init gesetzt sein. Was der Benutzer selbst gesetzt hat, wird nicht berschrieben.
+		if (offscreen)
+		{
+			SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+			SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+			SDL_setenv("EGL_PLATFORM", "surfaceless", 0);
+			SDL_setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+		}
+
 		initialize_mainwindow();
-		set_window_icon(window_icon_path.c_str());
+		if (!offscreen)
+			set_window_icon(icon_path.c_str());
 		glViewport(0, 0, window_width, window_height);
 		glClearColor(0.0f, 0.0f, 0.2f, 1.0f);
+		opened = true;
+	}
 
-		//Fr die Shader: w/h als float.
-		window_ratio = static_cast<float>(window_width) / static_cast<float>(window_height);
+	bool is_offscreen() const
+	{
+		return offscreen;
 	}
 
 	int width() const
@@ -120,6 +156,18 @@ public:
 		return window;
 	}
 
+	//GLSL-Version, die zum OpenGL-Context passt, z.B. 460 fr OpenGL 4.6.
+	int glsl_version() const
+	{
+		return 100 * gl_major + 10 * gl_minor;
+	}
+
+	//Fr Offscreen-Rendering (z.B. Video-Export) braucht man kein sichtbares Fenster.
+	void hide() const
+	{
+		SDL_HideWindow(window);
+	}
+
 	void update_size()
 	{
 		SDL_GL_GetDrawableSize(window, &window_width, &window_height); //Achtung! SDL_GL_GetDrawableSize ist verschieden von event.window.data1 !
@@ -127,13 +175,16 @@ public:
 		window_ratio = static_cast<float>(window_width) / static_cast<float>(window_height);
 	}
 
-	void close_SDL() const
+	void close_SDL()
 	{
+		if (!opened)
+			return;
 		SDL_GL_DeleteContext(context);
 		SDL_DestroyWindow(window);
 		Mix_Quit();
 		IMG_Quit();
 		SDL_Quit();
+		opened = false;
 	}
 
 	~MainWindowClass()
@@ -141,13 +192,16 @@ public:
 		close_SDL();
 	}
 
-	bool is_minimized{ false }, is_open{ true };
+	bool is_minimized{ false }, is_open{ true }, has_focus{ true };
 
 private:
 	int window_width, window_height;
 	float window_ratio;
+	std::string icon_path;
+	bool opened{ false }, offscreen{ false };
 	SDL_Window* window{ NULL };
 	SDL_GLContext context;
+	int gl_major{ 4 }, gl_minor{ 6 };
 	void initialize_mainwindow()
 	{
 		//Initialisiere SDL
@@ -159,12 +213,11 @@ private:
 		}
 
 		//Initalisiere OpenGL
-		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
-		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
 		//Initalisiere Hauptfenster
-		window = SDL_CreateWindow("Pong", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
+		const Uint32 window_flags{ static_cast<Uint32>(offscreen ? (SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL) : (SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE)) };
+		window = SDL_CreateWindow("Pong", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, window_width, window_height, window_flags);
 		if (window == NULL)
 		{
 			std::cerr << "Error: Could not create Window! SDL_Error: " << SDL_GetError() << '\n';
@@ -173,8 +226,27 @@ private:
 		}
 
 		//SDL muss noch separat ein OpenGL-Context erstellen.
-		context = SDL_GL_CreateContext(window);
-		(void)context;
+		//Falls 4.6 nicht verfgbar ist (z.B. Software-Rendering mit Mesa llvmpipe ohne GPU), werden ltere Versionen versucht.
+		const int gl_versions[4][2]{ {4,6}, {4,5}, {4,3}, {3,3} };
+		context = NULL;
+		for (const auto& version : gl_versions)
+		{
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, version[0]);
+			SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, version[1]);
+			context = SDL_GL_CreateContext(window);
+			if (context != NULL)
+			{
+				gl_major = version[0];
+				gl_minor = version[1];
+				break;
+			}
+		}
+		if (context == NULL)
+		{
+			std::cerr << "Error: Could not create an OpenGL context! SDL_Error: " << SDL_GetError() << '\n';
+			SDL_Quit();
+			exit(-1);
+		}
 
 		//Initalisiere GLAD
 		if (!gladLoadGLLoader(SDL_GL_GetProcAddress))
@@ -220,6 +292,205 @@ namespace Game
 	MainWindowClass window{ 1280,720 };	//Hauptfenster
 };
 
+//Wie das Spiel die Bildrate begrenzt.
+enum Pacing_Mode
+{
+	PACING_VSYNC,		//Wartet beim Tauschen der Buffer auf den Bildschirm.
+	PACING_ADAPTIVE,	//Wie VSync, aber zu spte Bilder werden sofort gezeigt (Tearing statt Ruckeln).
+	PACING_LIMITER,		//Ohne VSync: Schlft bis kurz vor das nchste Bild und wartet den Rest aktiv ab.
+	PACING_UNCAPPED,	//So schnell wie mglich, fr Benchmarks.
+};
+
+//Begrenzt die Bildrate und lsst die CPU ruhen, wenn das Fenster minimiert ist oder keinen Fokus hat.
+class Frame_Pacer
+{
+public:
+	Frame_Pacer() {}
+
+	//Liest den Modus aus der Kommandozeile: vsync, adaptive, limit oder uncapped.
+	static bool parse(const std::string& text, Pacing_Mode& mode_out)
+	{
+		if (text == "vsync")
+			mode_out = PACING_VSYNC;
+		else if (text == "adaptive")
+			mode_out = PACING_ADAPTIVE;
+		else if (text == "limit")
+			mode_out = PACING_LIMITER;
+		else if (text == "uncapped")
+			mode_out = PACING_UNCAPPED;
+		else
+		{
+			std::cerr << "Error: Unknown pacing mode \"" << text << "\" (vsync, adaptive, limit, uncapped)!\n";
+			return false;
+		}
+		return true;
+	}
+
+	//Setzt das Swap-Intervall des OpenGL-Contexts. Kann der Treiber kein (adaptives) VSync, wird auf die nchste Stufe ausgewichen.
+	void set_mode(Pacing_Mode mode_new, int fps = 60)
+	{
+		mode = mode_new;
+		frame_time = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / static_cast<double>(std::max(fps, 1))));
+
+		if (mode == PACING_ADAPTIVE && SDL_GL_SetSwapInterval(-1) != 0)
+		{
+			std::cerr << "Error: Adaptive VSync is not supported, using VSync instead. SDL_Error: " << SDL_GetError() << '\n';
+			mode = PACING_VSYNC;
+		}
+		if (mode == PACING_VSYNC && SDL_GL_SetSwapInterval(1) != 0)
+		{
+			std::cerr << "Error: VSync is not supported, using the frame limiter instead. SDL_Error: " << SDL_GetError() << '\n';
+			mode = PACING_LIMITER;
+		}
+		if (mode == PACING_LIMITER || mode == PACING_UNCAPPED)
+			SDL_GL_SetSwapInterval(0);
+
+		next_frame = clock::now();
+	}
+
+	Pacing_Mode get_mode() const
+	{
+		return mode;
+	}
+
+	//Nach SDL_GL_SwapWindow aufrufen. Nur der Begrenzer wartet hier; bei VSync blockiert schon das Tauschen der Buffer.
+	void wait_for_next_frame()
+	{
+		if (mode != PACING_LIMITER)
+			return;
+
+		next_frame += frame_time;
+		clock::time_point now{ clock::now() };
+		if (next_frame <= now)
+		{
+			//Zu spt: Nicht versuchen, verlorene Bilder aufzuholen.
+			next_frame = now;
+			return;
+		}
+
+		//sleep_for wacht oft eine Millisekunde zu spt auf, darum wird der letzte Teil aktiv abgewartet.
+		if (next_frame - now > spin_time)
+			std::this_thread::sleep_for(next_frame - now - spin_time);
+		while (clock::now() < next_frame)
+			std::this_thread::yield();
+	}
+
+	//Blockiert, bis ein Event kommt oder hchstens timeout_ms vergangen sind. Fr minimierte, unfokussierte oder unvernderte Fenster.
+	void idle(int timeout_ms)
+	{
+		SDL_WaitEventTimeout(nullptr, timeout_ms);
+		next_frame = clock::now();
+	}
+
+private:
+	using clock = std::chrono::steady_clock;
+	Pacing_Mode mode{ PACING_VSYNC };
+	clock::duration frame_time{ std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / 60.0)) };
+	const clock::duration spin_time{ std::chrono::duration_cast<clock::duration>(std::chrono::microseconds(1500)) };
+	clock::time_point next_frame{ clock::now() };
+};
+
+namespace Game
+{
+	Frame_Pacer pacer{};	//Begrenzt die Bildrate.
+};
+
+//Lock-freier Dreifach-Puffer fr genau einen Schreiber und einen Leser. Der Schreiber fllt seinen Puffer und tauscht ihn
+//mit dem mittleren aus, der Leser holt sich den mittleren nur, wenn er neu ist. Keiner der beiden wartet je auf den anderen.
+template<typename T>
+class Triple_Buffer
+{
+public:
+	//Nur vom Schreiber: Der Puffer, der als nchstes verffentlicht wird.
+	T& write_buffer()
+	{
+		return buffers[back];
+	}
+
+	void publish()
+	{
+		back = middle.exchange(back | fresh_bit, std::memory_order_acq_rel) & index_mask;
+	}
+
+	bool has_update() const
+	{
+		return (middle.load(std::memory_order_acquire) & fresh_bit) != 0;
+	}
+
+	//Nur vom Leser: Holt den neuesten verffentlichten Puffer, falls seit dem letzten Aufruf einer dazugekommen ist.
+	bool update()
+	{
+		if (!has_update())
+			return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & index_mask;
+		return true;
+	}
+
+	const T& read() const
+	{
+		return buffers[front];
+	}
+
+private:
+	static constexpr unsigned index_mask{ 3u }, fresh_bit{ 4u };
+	T buffers[3]{};
+	unsigned back{ 0 }, front{ 1 };
+	std::atomic<unsigned> middle{ 2u };
+};
+
+//Ruft eine Funktion in einem eigenen Thread in festen Abstnden auf, z.B. die Simulation mit 60 Ticks pro Sekunde.
+//Die Abstnde werden ab dem Start gezhlt und nicht ab dem letzten Aufruf, damit sich keine Fehler aufsummieren.
+class Fixed_Tick_Thread
+{
+public:
+	Fixed_Tick_Thread() {}
+
+	void start(double dt, const std::function<void()>& tick)
+	{
+		if (thread.joinable())
+			return;
+		running = true;
+		thread = std::thread{ [this, dt, tick]()
+		{
+			using clock = std::chrono::steady_clock;
+			const clock::duration interval{ std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(dt)) };
+			clock::time_point next_tick{ clock::now() + interval };
+			while (running)
+			{
+				std::this_thread::sleep_until(next_tick);
+				tick();
+				next_tick += interval;
+
+				//Hngt der Thread mehrere Ticks hinterher (z.B. im Debugger), wird nicht alles auf einmal nachgeholt.
+				const clock::time_point now{ clock::now() };
+				if (now - next_tick > 5 * interval)
+					next_tick = now;
+			}
+		} };
+	}
+
+	void stop()
+	{
+		running = false;
+		if (thread.joinable())
+			thread.join();
+	}
+
+	bool is_running() const
+	{
+		return thread.joinable();
+	}
+
+	~Fixed_Tick_Thread()
+	{
+		stop();
+	}
+
+private:
+	std::thread thread;
+	std::atomic<bool> running{ false };
+};
+
 //Maus-Klasse
 class Mouse
 {
@@ -583,282 +854,963 @@ private:
 	int game_volume;
 };
 
-//Shader-Klassen
-
-//Einfache Formen fr den Shader
-struct OpenGL_Shape
+//Merkt sich, ob sich seit dem letzten angezeigten Bild etwas verndert hat.
+//Statische Mens werden nur neu gezeichnet, wenn ein Widget sich als verndert markiert; sonst bleibt das alte Bild stehen.
+class Redraw_Tracker
 {
-	std::vector<float> vertex_data;
-	std::vector<unsigned int> indices;
-};
+public:
+	Redraw_Tracker() {}
 
-namespace Shapes
-{
-	//Quadrat der Lnge 1 mit Koordinatenmittelpunkt im Zentrum.
-	OpenGL_Shape square
+	void mark_dirty()
 	{
-		//Vertex Data.
-		{ -0.5f, -0.5f,
-		 +0.5f, -0.5f,
-		 -0.5f, +0.5f,
-		 +0.5f, +0.5f },
-
-		 //Indices
-		 { 0,1,2,
-		  3,1,2 }
-	};
+		dirty = true;
+	}
 
-	//Quadrat der Lnge 1 mit Koordinatenmittelpunkt im Zentrum und Texturdaten.
-	OpenGL_Shape square_textured
+	//Ob das nchste Bild gezeichnet und angezeigt werden muss.
+	bool needs_redraw() const
 	{
-		//Vertex und Textur Data.
-			//Koordinaten Bildschirm	//Textur-Koordinaten
-		{   -0.5f, -0.5f,				0.0f,	0.0f,
-			+0.5f, -0.5f,				1.0f,	0.0f,
-			-0.5f, +0.5f,				0.0f,	1.0f,
-			+0.5f, +0.5f ,				1.0f,	1.0f
-		},
-
-		//Indices
-		{ 0,1,2,
-		  3,1,2 }
-	};
+		return dirty || !enabled;
+	}
 
-	//Glyph fr Bitmap-Text
-	OpenGL_Shape glyph
+	//Nachdem ein Bild angezeigt wurde.
+	void presented()
 	{
-		//Vertex und Textur Data.
-			//Koordinaten Bildschirm	//Textur-Koordinaten
-		{   0.0f,	-0.25f,				0.0f,	0.0f,
-			1.0f,	-0.25f,				1.0f,	0.0f,
-			0.0f,	+0.75f,				0.0f,	1.0f,
-			1.0f,	+0.75f,				1.0f,	1.0f
-		},
+		dirty = false;
+	}
 
-		//Indices
-		{ 0,1,2,
-		  3,1,2 }
-	};
+	bool enabled{ true };	//false: Jedes Bild wird gezeichnet (--always-redraw).
 
+private:
+	bool dirty{ true };
 };
 
-//Massstab, der die Hhe automatisch mit der Fenstergrsse skaliert
-struct Scale_2D
+namespace Game
 {
-	Scale_2D(float w = 0.0f, float h = 0.0f, bool scaled = true): width{w}
-	{
-		if (scaled)
-			height = h * Game::window.ratio();
-		else
-			height = h;
-	}
+	Redraw_Tracker redraw{};	//Ob sich in einem statischen Men etwas verndert hat.
+};
 
-	float width;
-	float height;
+//Shader-Klassen
+
+//Fhrt die Befehle eines Bildes aus: Binds, Uniforms, Uploads und Draws. GL_State davor merkt sich den Zustand
+//und lsst berflssige Aufrufe weg. Ressourcen (Programme, Texturen, VAOs) werden beim Laden immer mit OpenGL erstellt.
+class Render_Backend
+{
+public:
+	virtual ~Render_Backend() {}
+
+	//false: Die Befehle werden nur aufgezeichnet. Dann braucht es z.B. keinen gemappten Ring-Buffer.
+	virtual bool executes() const = 0;
+
+	virtual void clear() = 0;
+	virtual void use_program(unsigned int program) = 0;
+	virtual void bind_vertex_array(unsigned int vao) = 0;
+	virtual void bind_texture(unsigned int texture) = 0;
+
+	//n Komponenten; n = 1 ist ein int (Sampler).
+	virtual void uniform(unsigned int program, int location, const std::array<float, 4>& value, int n) = 0;
+
+	//Fr GL_ELEMENT_ARRAY_BUFFER muss das VAO gebunden sein, zu dem der Buffer gehrt.
+	virtual void buffer_data(GLenum target, unsigned int buffer, std::size_t size, const void* data, GLenum usage) = 0;
+
+	virtual void draw_elements(GLenum mode, int n_indices) = 0;
+	virtual void draw_elements_instanced(GLenum mode, int n_indices, int n_instances, int first_instance) = 0;
+	virtual void present(SDL_Window* window) = 0;
+	virtual void end_frame() {}
 };
 
-//Generische Shader-Klasse. Beinhaltet keine Vertex-Objekte.
-class Shader
+class GL_Backend : public Render_Backend
 {
 public:
-	Shader() {};
+	GL_Backend() {}
 
-	void load(const std::vector<float>& vertex_array, const std::vector<unsigned int>& index_array, const std::string& shader_name)
+	bool executes() const override
 	{
-		if (loaded == false)
-		{
-			load_program(vertex_array, index_array, shader_name);
-			loaded = true;
-		}
+		return true;
 	}
 
-	void unload()
+	void clear() override
 	{
-		if(loaded)
-		{
-			glDeleteProgram(program);
-			vertex_shader_name.str("");
-			vertex_shader_name.clear();
-			fragment_shader_name.str("");
-			fragment_shader_name.clear();
-			loaded = false;
-		}
+		glClear(GL_COLOR_BUFFER_BIT);
 	}
 
-	~Shader()
+	void use_program(unsigned int program) override
 	{
-		unload();
+		glUseProgram(program);
 	}
 
-protected:
-	unsigned int program{};
-	std::vector<float> vertex_data{};
-	std::vector<unsigned int> indices{};
-
-private:
-	bool loaded{false};
-	std::stringstream vertex_shader_name{}, fragment_shader_name{};
-	std::string vertex_shader_source{}, fragment_shader_source{};
-	unsigned int vertex_shader{}, fragment_shader{};
-
-	void read_shader(const std::string& file_name, std::string& shader_code) //Speichert den Shader in shader_code
+	void bind_vertex_array(unsigned int vao) override
 	{
-		std::ifstream file_input{ file_name };
-		if (!file_input)													//Falls man die Datei nicht finden konnte.
-		{
-			std::cerr << "Error: Could not find the following shader source-file: " << file_name << '\n';
-			exit(-1);
-		}
-		else
-		{
-			std::stringstream file_stream;
-			file_stream << file_input.rdbuf();
-			shader_code = file_stream.str();
-		}
-
-		file_input.close();
+		glBindVertexArray(vao);
 	}
 
-	void initalize_vertexshader()
+	//Es wird nur die Textur-Einheit 0 benutzt.
+	void bind_texture(unsigned int texture) override
 	{
-		int  success{};
-		char infoLog[512]{};
-
-		read_shader(vertex_shader_name.str().c_str(), vertex_shader_source); //Lese den Shader-Code ein.
-		const GLchar* shader_file[] = { vertex_shader_source.c_str() }; //Konvertiere von string zu const GLchar*
+		glBindTexture(GL_TEXTURE_2D, texture);
+	}
 
-		vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex_shader, 1, shader_file, NULL);
-		glCompileShader(vertex_shader);
-		glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-		if (!success)
+	//Ab OpenGL 4.1 mit glProgramUniform*, sonst muss GL_State das Programm vorher binden.
+	void uniform(unsigned int program, int location, const std::array<float, 4>& value, int n) override
+	{
+		const bool direct{ Game::window.glsl_version() >= 410 };
+		switch (n)
 		{
-			glGetShaderInfoLog(vertex_shader, 512, NULL, infoLog);
-			std::cerr << "Error: Vertex-Shader compilation failed!\n" << infoLog << 'n';
+		case 1:
+			if (direct)
+				glProgramUniform1i(program, location, static_cast<int>(value[0]));
+			else
+				glUniform1i(location, static_cast<int>(value[0]));
+			break;
+		case 2:
+			if (direct)
+				glProgramUniform2f(program, location, value[0], value[1]);
+			else
+				glUniform2f(location, value[0], value[1]);
+			break;
+		default:
+			if (direct)
+				glProgramUniform3f(program, location, value[0], value[1], value[2]);
+			else
+				glUniform3f(location, value[0], value[1], value[2]);
+			break;
 		}
 	}
 
-	void initalize_fragmentshader()
+	void buffer_data(GLenum target, unsigned int buffer, std::size_t size, const void* data, GLenum usage) override
 	{
-		int  success{};
-		char infoLog[512]{};
-
-		read_shader(fragment_shader_name.str().c_str(), fragment_shader_source); //Lese den Shader-Code ein.
-		const GLchar* shader_file[] = { fragment_shader_source.c_str() }; //Konvertiere von string zu const GLchar*
+		glBindBuffer(target, buffer);
+		glBufferData(target, static_cast<GLsizeiptr>(size), data, usage);
+	}
 
-		fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment_shader, 1, shader_file, NULL);
-		glCompileShader(fragment_shader);
-		glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-		if (!success)
-		{
-			glGetShaderInfoLog(fragment_shader, 512, NULL, infoLog);
-			std::cerr << "Error: Fragment-Shader compilation failed!\n" << infoLog << 'n';
-		}
+	void draw_elements(GLenum mode, int n_indices) override
+	{
+		glDrawElements(mode, n_indices, GL_UNSIGNED_INT, 0);
 	}
-	
-	void create_shaderprogram()
+
+	//first_instance > 0 braucht OpenGL 4.2.
+	void draw_elements_instanced(GLenum mode, int n_indices, int n_instances, int first_instance) override
 	{
-		int  success{};
-		char infoLog[512]{};
-		program = glCreateProgram();
-		glAttachShader(program, vertex_shader);
-		glAttachShader(program, fragment_shader);
-		glLinkProgram(program);
-		glGetProgramiv(program, GL_LINK_STATUS, &success);
-		if (!success)
-		{
-			glGetProgramInfoLog(program, 512, NULL, infoLog);
-			std::cerr << "Error: Could not link shader program!\n" << infoLog << 'n';
-		}
-		glDeleteShader(vertex_shader);
-		glDeleteShader(fragment_shader);
-		glUseProgram(program);
+		if (first_instance > 0)
+			glDrawElementsInstancedBaseInstance(mode, n_indices, GL_UNSIGNED_INT, 0, n_instances, first_instance);
+		else
+			glDrawElementsInstanced(mode, n_indices, GL_UNSIGNED_INT, 0, n_instances);
 	}
 
-	void load_program(const std::vector<float>& vertex_array, const std::vector<unsigned int>& index_array, const std::string& shader_name)
+	void present(SDL_Window* window) override
 	{
-		vertex_data = vertex_array;
-		indices = index_array;
-		vertex_shader_name << "Shaders\\" << shader_name.c_str() << ".vert";
-		fragment_shader_name << "Shaders\\" << shader_name.c_str() << ".frag";
-		initalize_vertexshader();
-		initalize_fragmentshader();
-		create_shaderprogram();
+		SDL_GL_SwapWindow(window);
 	}
 };
 
-//Shader-Template fr 2D-Objekte ohne Textur- oder Farbdaten.
-class Shader_2D : public Shader
+//Fhrt nichts aus und zeichnet nur auf, welche Befehle ein Bild abgesetzt htte (--null-renderer).
+//So lsst sich messen, wie viel CPU-Zeit das Spiel selbst braucht, ohne Treiber und Grafikkarte.
+class Null_Backend : public Render_Backend
 {
 public:
-	Shader_2D() : Shader() {}
-
-	void load(const OpenGL_Shape &shape, const std::string& shader_name)
+	struct Command
 	{
-		if (loaded == false)
+		enum Type : uint8_t
 		{
-			Shader::load(shape.vertex_data, shape.indices, shader_name);
-			create_vertexobjects();
-			loaded = true;
-		}
+			CLEAR,
+			USE_PROGRAM,
+			BIND_VERTEX_ARRAY,
+			BIND_TEXTURE,
+			UNIFORM,
+			BUFFER_DATA,
+			DRAW,
+			PRESENT,
+		};
+		Type type{ CLEAR };
+		unsigned int name{ 0 };		//Programm, VAO, Textur oder Buffer.
+		int location{ -1 };			//Nur Uniforms.
+		std::size_t count{ 0 };		//Indizes pro Draw, Bytes pro Upload.
+		int n_instances{ 0 }, first_instance{ 0 };
+	};
+
+	Null_Backend() {}
+
+	bool executes() const override
+	{
+		return false;
+	}
+
+	void clear() override
+	{
+		commands.push_back({ Command::CLEAR });
+	}
+
+	void use_program(unsigned int program) override
+	{
+		commands.push_back({ Command::USE_PROGRAM, program });
+	}
+
+	void bind_vertex_array(unsigned int vao) override
+	{
+		commands.push_back({ Command::BIND_VERTEX_ARRAY, vao });
+	}
+
+	void bind_texture(unsigned int texture) override
+	{
+		commands.push_back({ Command::BIND_TEXTURE, texture });
+	}
+
+	void uniform(unsigned int program, int location, const std::array<float, 4>& value, int n) override
+	{
+		(void)value;
+		commands.push_back({ Command::UNIFORM, program, location, static_cast<std::size_t>(n) });
+	}
+
+	void buffer_data(GLenum target, unsigned int buffer, std::size_t size, const void* data, GLenum usage) override
+	{
+		(void)target, (void)data, (void)usage;
+		commands.push_back({ Command::BUFFER_DATA, buffer, -1, size });
+	}
+
+	void draw_elements(GLenum mode, int n_indices) override
+	{
+		(void)mode;
+		commands.push_back({ Command::DRAW, 0, -1, static_cast<std::size_t>(n_indices), 1, 0 });
+	}
+
+	void draw_elements_instanced(GLenum mode, int n_indices, int n_instances, int first_instance) override
+	{
+		(void)mode;
+		commands.push_back({ Command::DRAW, 0, -1, static_cast<std::size_t>(n_indices), n_instances, first_instance });
+	}
+
+	void present(SDL_Window* window) override
+	{
+		(void)window;
+		commands.push_back({ Command::PRESENT });
+	}
+
+	//Die Liste wird pro Bild getauscht, damit im Betrieb nichts alloziert wird.
+	void end_frame() override
+	{
+		std::swap(commands, last_frame);
+		commands.clear();
+	}
+
+	//Die Befehle des letzten ganzen Bildes.
+	const std::vector<Command>& get_last_frame() const
+	{
+		return last_frame;
+	}
+
+private:
+	std::vector<Command> commands{}, last_frame{};
+};
+
+namespace Game
+{
+	GL_Backend gl_backend{};		//Fhrt alles mit OpenGL aus.
+	Null_Backend null_backend{};	//Zeichnet nur auf (--null-renderer).
+};
+
+//Merkt sich den OpenGL-Zustand (Programm, VAO, Textur und Uniform-Werte) und lsst berflssige Aufrufe weg.
+//Alle Shader-Klassen binden und zeichnen nur ber Game::gl; darum wird auch nichts mehr zurck auf 0 gesetzt.
+//Die brigen Aufrufe gehen an das Render_Backend. Zhlt die Aufrufe pro Bild.
+class GL_State
+{
+public:
+	struct Statistics
+	{
+		int calls{ 0 };			//Abgesetzte Aufrufe (Binds, Uniforms, Uploads, Draws).
+		int skipped{ 0 };		//Weggelassene Aufrufe, weil der Zustand schon stimmte.
+		int draw_calls{ 0 };
+		std::size_t bytes_uploaded{ 0 };
+	};
+
+	GL_State() {}
+
+	//Vor dem ersten Bild whlen. Der gemerkte Zustand gilt fr das neue Backend nicht mehr.
+	void set_backend(Render_Backend& backend_new)
+	{
+		backend = &backend_new;
+		current_program = current_vao = current_texture = 0;
+		uniforms.clear();
+	}
+
+	const Render_Backend& get_backend() const
+	{
+		return *backend;
+	}
+
+	void clear()
+	{
+		backend->clear();
+		frame.calls++;
+	}
+
+	void use_program(unsigned int program)
+	{
+		if (program == current_program)
+		{
+			frame.skipped++;
+			return;
+		}
+		backend->use_program(program);
+		current_program = program;
+		frame.calls++;
+	}
+
+	void bind_vertex_array(unsigned int vao)
+	{
+		if (vao == current_vao)
+		{
+			frame.skipped++;
+			return;
+		}
+		backend->bind_vertex_array(vao);
+		current_vao = vao;
+		frame.calls++;
+	}
+
+	//Es wird nur die Textur-Einheit 0 benutzt.
+	void bind_texture(unsigned int texture)
+	{
+		if (texture == current_texture)
+		{
+			frame.skipped++;
+			return;
+		}
+		backend->bind_texture(texture);
+		current_texture = texture;
+		frame.calls++;
+	}
+
+	//Uniforms werden ab OpenGL 4.1 mit glProgramUniform* gesetzt, ohne das Programm zu binden.
+	void uniform(unsigned int program, int location, float x, float y)
+	{
+		set_uniform(program, location, { x, y, 0.0f, 0.0f }, 2);
+	}
+
+	void uniform(unsigned int program, int location, float x, float y, float z)
+	{
+		set_uniform(program, location, { x, y, z, 0.0f }, 3);
+	}
+
+	void uniform(unsigned int program, int location, int value)
+	{
+		set_uniform(program, location, { static_cast<float>(value), 0.0f, 0.0f, 0.0f }, 1);
+	}
+
+	//Ldt Daten hoch, die sich whrend dem Spiel ndern (Instanzen, Text).
+	void buffer_data(GLenum target, unsigned int buffer, std::size_t size, const void* data, GLenum usage)
+	{
+		backend->buffer_data(target, buffer, size, data, usage);
+		frame.calls++;
+		frame.bytes_uploaded += size;
+	}
+
+	void draw_elements(GLenum mode, int n_indices)
+	{
+		backend->draw_elements(mode, n_indices);
+		frame.calls++;
+		frame.draw_calls++;
+	}
+
+	//first_instance > 0 braucht OpenGL 4.2.
+	void draw_elements_instanced(GLenum mode, int n_indices, int n_instances, int first_instance = 0)
+	{
+		backend->draw_elements_instanced(mode, n_indices, n_instances, first_instance);
+		frame.calls++;
+		frame.draw_calls++;
+	}
+
+	void present(SDL_Window* window)
+	{
+		backend->present(window);
+	}
+
+	//Gelschte Namen kann OpenGL wiederverwenden, darum mssen sie hier vergessen werden.
+	void delete_vertex_array(unsigned int vao)
+	{
+		glDeleteVertexArrays(1, &vao);
+		if (vao == current_vao)
+			current_vao = 0;
+	}
+
+	void delete_texture(unsigned int texture)
+	{
+		glDeleteTextures(1, &texture);
+		if (texture == current_texture)
+			current_texture = 0;
+	}
+
+	void delete_program(unsigned int program)
+	{
+		glDeleteProgram(program);
+		if (program == current_program)
+			current_program = 0;
+		for (auto it{ uniforms.begin() }; it != uniforms.end();)
+		{
+			if ((it->first >> 32) == program)
+				it = uniforms.erase(it);
+			else
+				++it;
+		}
+	}
+
+	//Am Ende eines Bildes: Merkt sich die Zhler dieses Bildes und beginnt von vorne.
+	void end_frame()
+	{
+		backend->end_frame();
+		last_frame = frame;
+		frame = Statistics{};
+	}
+
+	const Statistics& get_frame_statistics() const
+	{
+		return last_frame;
+	}
+
+private:
+	Render_Backend* backend{ &Game::gl_backend };
+	unsigned int current_program{}, current_vao{}, current_texture{};
+	std::unordered_map<uint64_t, std::array<float, 4>> uniforms{};	//Schlssel: Programm (obere 32 Bit) und Ort.
+	Statistics frame{}, last_frame{};
+
+	void set_uniform(unsigned int program, int location, const std::array<float, 4>& value, int n)
+	{
+		if (location < 0)
+			return;
+
+		const uint64_t key{ (static_cast<uint64_t>(program) << 32) | static_cast<uint32_t>(location) };
+		auto it{ uniforms.find(key) };
+		if (it != uniforms.end() && it->second == value)
+		{
+			frame.skipped++;
+			return;
+		}
+		uniforms[key] = value;
+
+		if (Game::window.glsl_version() < 410)
+			use_program(program);
+		backend->uniform(program, location, value, n);
+		frame.calls++;
+	}
+};
+
+namespace Game
+{
+	GL_State gl{};	//Gebundener OpenGL-Zustand und Aufruf-Zhler.
+};
+
+//Einfache Formen fr den Shader
+struct OpenGL_Shape
+{
+	std::vector<float> vertex_data;
+	std::vector<unsigned int> indices;
+};
+
+namespace Shapes
+{
+	//Quadrat der Lnge 1 mit Koordinatenmittelpunkt im Zentrum.
+	OpenGL_Shape square
+	{
+		//Vertex Data.
+		{ -0.5f, -0.5f,
+		 +0.5f, -0.5f,
+		 -0.5f, +0.5f,
+		 +0.5f, +0.5f },
+
+		 //Indices
+		 { 0,1,2,
+		  3,1,2 }
+	};
+
+	//Quadrat der Lnge 1 mit Koordinatenmittelpunkt im Zentrum und Texturdaten.
+	OpenGL_Shape square_textured
+	{
+		//Vertex und Textur Data.
+			//Koordinaten Bildschirm	//Textur-Koordinaten
+		{   -0.5f, -0.5f,				0.0f,	0.0f,
+			+0.5f, -0.5f,				1.0f,	0.0f,
+			-0.5f, +0.5f,				0.0f,	1.0f,
+			+0.5f, +0.5f ,				1.0f,	1.0f
+		},
+
+		//Indices
+		{ 0,1,2,
+		  3,1,2 }
+	};
+
+	//Glyph fr Bitmap-Text
+	OpenGL_Shape glyph
+	{
+		//Vertex und Textur Data.
+			//Koordinaten Bildschirm	//Textur-Koordinaten
+		{   0.0f,	-0.25f,				0.0f,	0.0f,
+			1.0f,	-0.25f,				1.0f,	0.0f,
+			0.0f,	+0.75f,				0.0f,	1.0f,
+			1.0f,	+0.75f,				1.0f,	1.0f
+		},
+
+		//Indices
+		{ 0,1,2,
+		  3,1,2 }
+	};
+
+};
+
+//Massstab, der die Hhe automatisch mit der Fenstergrsse skaliert
+struct Scale_2D
+{
+	Scale_2D(float w = 0.0f, float h = 0.0f, bool scaled = true): width{w}
+	{
+		if (scaled)
+			height = h * Game::window.ratio();
+		else
+			height = h;
+	}
+
+	float width;
+	float height;
+};
+
+//Kompiliert jedes Shader-Programm nur einmal. Alle Shader-Objekte mit dem gleichen Namen teilen sich das Programm,
+//die Uniform-Werte speichert jedes Objekt selbst und setzt sie beim Zeichnen.
+class Shader_Program_Registry
+{
+public:
+	Shader_Program_Registry() {}
+
+	//Gibt das Programm zum Namen zurck. Beim ersten Aufruf wird es aus Shaders\name.vert und .frag kompiliert.
+	//Erst hier wird nachgefragt, ob das Kompilieren geklappt hat.
+	unsigned int get(const std::string& shader_name)
+	{
+		auto it{ programs.find(shader_name) };
+		if (it != programs.end())
+			return it->second;
+
+		if (pending.find(shader_name) == pending.end())
+			start_program(shader_name);
+		return finish_program(shader_name);
+	}
+
+	//Startet alle bekannten Programme auf einmal, ohne auf das Resultat zu warten. Der Treiber kann so parallel kompilieren,
+	//whrend das Spiel Texturen und Sounds ldt.
+	void compile_all()
+	{
+		enable_parallel_compile();
+		for (const char* shader_name : known_programs)
+		{
+			if (programs.find(shader_name) == programs.end() && pending.find(shader_name) == pending.end())
+				start_program(shader_name);
+		}
+	}
+
+	int number_of_programs() const
+	{
+		return static_cast<int>(programs.size() + pending.size());
+	}
+
+	//Lscht alle Programme. Muss vor dem Schliessen des OpenGL-Contexts aufgerufen werden.
+	void unload()
+	{
+		for (const auto& [name, program] : programs)
+			Game::gl.delete_program(program);
+		programs.clear();
+		for (const auto& [name, compilation] : pending)
+		{
+			glDeleteShader(compilation.vertex_shader);
+			glDeleteShader(compilation.fragment_shader);
+			glDeleteProgram(compilation.program);
+		}
+		pending.clear();
+	}
+
+private:
+	//Alle Programme, die das Spiel benutzt.
+	static constexpr const char* known_programs[]{ "monocolour_instanced_shader", "monocolour_texture_shader", "texture_shader",
+		"portrait_shader", "monocolour_shader" };
+
+	//Programm, das der Treiber noch kompiliert und linkt.
+	struct Compilation
+	{
+		unsigned int program{}, vertex_shader{}, fragment_shader{};
+		uint64_t key{};
+	};
+
+	std::map<std::string, unsigned int> programs{};
+	std::map<std::string, Compilation> pending{};
+	bool parallel_checked{ false };
+
+	//Mit GL_KHR_parallel_shader_compile (bzw. ARB) kompiliert der Treiber in eigenen Threads.
+	//Ohne die Erweiterung bringt das spte Nachfragen immer noch etwas bei Treibern, die von sich aus im Hintergrund kompilieren.
+	void enable_parallel_compile()
+	{
+		if (parallel_checked)
+			return;
+		parallel_checked = true;
+
+		using Max_Threads_Function = void (APIENTRY*)(GLuint);
+		Max_Threads_Function max_threads{ nullptr };
+		if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile"))
+			max_threads = reinterpret_cast<Max_Threads_Function>(SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR"));
+		else if (SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile"))
+			max_threads = reinterpret_cast<Max_Threads_Function>(SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsARB"));
+
+		if (max_threads != nullptr)
+			max_threads(0xFFFFFFFFu); //Der Treiber whlt die Anzahl Threads.
+	}
+
+	void read_shader(const std::string& file_name, std::string& shader_code) //Speichert den Shader in shader_code
+	{
+		std::ifstream file_input{ file_name };
+		if (!file_input)													//Falls man die Datei nicht finden konnte.
+		{
+			std::cerr << "Error: Could not find the following shader source-file: " << file_name << '\n';
+			exit(-1);
+		}
+		else
+		{
+			std::stringstream file_stream;
+			file_stream << file_input.rdbuf();
+			shader_code = file_stream.str();
+		}
+
+		file_input.close();
+
+		//Die Shader sind fr GLSL 4.60 geschrieben. Bei einem lteren Context wird die Version angepasst.
+		const std::string version_460{ "#version 460" };
+		if (shader_code.compare(0, version_460.size(), version_460) == 0 && Game::window.glsl_version() < 460)
+			shader_code.replace(0, version_460.size(), "#version " + std::to_string(Game::window.glsl_version()));
+	}
+
+	unsigned int compile_shader(GLenum type, const std::string& shader_source)
+	{
+		const GLchar* shader_file[] = { shader_source.c_str() }; //Konvertiere von string zu const GLchar*
+
+		const unsigned int shader{ glCreateShader(type) };
+		glShaderSource(shader, 1, shader_file, NULL);
+		glCompileShader(shader);
+		return shader;
+	}
+
+	//Ldt das Programm aus dem Cache oder startet das Kompilieren und Linken, ohne den Status abzufragen.
+	void start_program(const std::string& shader_name)
+	{
+		std::string vertex_source{}, fragment_source{};
+		read_shader("Shaders\\" + shader_name + ".vert", vertex_source); //Lese den Shader-Code ein.
+		read_shader("Shaders\\" + shader_name + ".frag", fragment_source);
+
+		//Zuerst im Cache nachschauen, dann erst kompilieren.
+		const uint64_t key{ cache_key(vertex_source, fragment_source) };
+		const unsigned int cached_program{ load_binary(shader_name, key) };
+		if (cached_program != 0)
+		{
+			programs[shader_name] = cached_program;
+			return;
+		}
+
+		Compilation compilation{};
+		compilation.key = key;
+		compilation.vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source);
+		compilation.fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+		compilation.program = glCreateProgram();
+		glAttachShader(compilation.program, compilation.vertex_shader);
+		glAttachShader(compilation.program, compilation.fragment_shader);
+		if (!cache_directory().empty())
+			glProgramParameteri(compilation.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(compilation.program);
+		pending[shader_name] = compilation;
+	}
+
+	//Wartet, bis das Programm fertig ist, meldet Fehler und speichert es im Cache.
+	unsigned int finish_program(const std::string& shader_name)
+	{
+		auto it{ programs.find(shader_name) };
+		if (it != programs.end())
+			return it->second;
+
+		const Compilation compilation{ pending[shader_name] };
+		pending.erase(shader_name);
+
+		int  success{};
+		char infoLog[512]{};
+		glGetProgramiv(compilation.program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderiv(compilation.vertex_shader, GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(compilation.vertex_shader, 512, NULL, infoLog);
+				std::cerr << "Error: Vertex-Shader compilation failed!\n" << infoLog << '\n';
+			}
+			glGetShaderiv(compilation.fragment_shader, GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(compilation.fragment_shader, 512, NULL, infoLog);
+				std::cerr << "Error: Fragment-Shader compilation failed!\n" << infoLog << '\n';
+			}
+			glGetProgramInfoLog(compilation.program, 512, NULL, infoLog);
+			std::cerr << "Error: Could not link shader program " << shader_name << "!\n" << infoLog << '\n';
+		}
+		else
+			save_binary(shader_name, compilation.key, compilation.program);
+
+		glDeleteShader(compilation.vertex_shader);
+		glDeleteShader(compilation.fragment_shader);
+		programs[shader_name] = compilation.program;
+		return compilation.program;
+	}
+
+	//Programm-Binrdateien (glGetProgramBinary) im Benutzerordner, damit ein Warmstart kein GLSL kompiliert.
+	//Dateiformat: "PSPB", Schlssel (u64), Binrformat (u32), Lnge (u32), Binrdaten.
+	//Der Schlssel ist ein Hash ber Treiber und Quelltext; passt er nicht, wird neu kompiliert und die Datei berschrieben.
+	bool cache_checked{ false };
+	std::filesystem::path cache_path{};
+
+	//Leer, falls der Context (vor OpenGL 4.1) oder der Treiber keine Programm-Binrdateien untersttzt.
+	const std::filesystem::path& cache_directory()
+	{
+		if (!cache_checked)
+		{
+			cache_checked = true;
+			int n_formats{ 0 };
+			if (Game::window.glsl_version() >= 410)
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+
+			char* pref_path{ n_formats > 0 ? SDL_GetPrefPath("OberholzerSM", "Pong") : nullptr };
+			if (pref_path != nullptr)
+			{
+				std::error_code error;
+				cache_path = std::filesystem::path{ pref_path } / "Shader_Cache";
+				SDL_free(pref_path);
+				std::filesystem::create_directories(cache_path, error);
+				if (error)
+					cache_path.clear();
+			}
+		}
+		return cache_path;
+	}
+
+	//FNV-1a ber Hersteller, Renderer, Treiberversion und beide Quelltexte.
+	uint64_t cache_key(const std::string& vertex_source, const std::string& fragment_source) const
+	{
+		uint64_t hash{ 14695981039346656037ull };
+		auto add = [&hash](const std::string& text)
+			{
+				for (unsigned char c : text)
+				{
+					hash ^= c;
+					hash *= 1099511628211ull;
+				}
+				hash ^= 0xff;
+				hash *= 1099511628211ull;
+			};
+
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+		{
+			const GLubyte* driver_string{ glGetString(name) };
+			add(driver_string != nullptr ? reinterpret_cast<const char*>(driver_string) : "");
+		}
+		add(vertex_source);
+		add(fragment_source);
+		return hash;
+	}
+
+	//Gibt 0 zurck, falls es keine passende Binrdatei gibt oder der Treiber sie nicht mehr annimmt.
+	unsigned int load_binary(const std::string& shader_name, uint64_t key)
+	{
+		if (cache_directory().empty())
+			return 0;
+
+		std::ifstream file{ cache_directory() / (shader_name + ".bin"), std::ios::binary };
+		char magic[4]{};
+		uint64_t file_key{};
+		uint32_t format{}, length{};
+		file.read(magic, 4);
+		file.read(reinterpret_cast<char*>(&file_key), sizeof(file_key));
+		file.read(reinterpret_cast<char*>(&format), sizeof(format));
+		file.read(reinterpret_cast<char*>(&length), sizeof(length));
+		if (!file || std::string(magic, 4) != "PSPB" || file_key != key || length == 0)
+			return 0;
+
+		std::vector<char> binary(length);
+		if (!file.read(binary.data(), length))
+			return 0;
+
+		int success{};
+		const unsigned int program{ glCreateProgram() };
+		glProgramBinary(program, format, binary.data(), static_cast<int>(length));
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	void save_binary(const std::string& shader_name, uint64_t key, unsigned int program)
+	{
+		if (cache_directory().empty())
+			return;
+
+		int length{ 0 };
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+
+		std::vector<char> binary(length);
+		GLenum format{};
+		glGetProgramBinary(program, length, &length, &format, binary.data());
+
+		std::ofstream file{ cache_directory() / (shader_name + ".bin"), std::ios::binary | std::ios::trunc };
+		const uint32_t format_u32{ static_cast<uint32_t>(format) }, length_u32{ static_cast<uint32_t>(length) };
+		file.write("PSPB", 4);
+		file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+		file.write(reinterpret_cast<const char*>(&format_u32), sizeof(format_u32));
+		file.write(reinterpret_cast<const char*>(&length_u32), sizeof(length_u32));
+		file.write(binary.data(), length);
+		if (!file)
+			std::cerr << "Error: Could not write the shader cache for " << shader_name << '\n';
+	}
+};
+
+namespace Game
+{
+	Shader_Program_Registry programs{};	//Alle geladenen Shader-Programme, nach Namen.
+};
+
+//Ldt jede Form nur einmal auf die Grafikkarte. Alle Shader mit der gleichen Form teilen sich VAO, VBO und EBO.
+class Geometry_Cache
+{
+public:
+	struct Geometry
+	{
+		unsigned int vao{}, vbo{}, ebo{};
+	};
+
+	Geometry_Cache() {}
+
+	//floats_per_vertex: 2 fr nur Koordinaten (Attribut 0), 4 fr Koordinaten und Textur-Koordinaten (Attribute 0 und 1).
+	Geometry get(const OpenGL_Shape& shape, int floats_per_vertex)
+	{
+		for (const Entry& entry : entries)
+		{
+			if (entry.floats_per_vertex == floats_per_vertex && entry.shape.vertex_data == shape.vertex_data && entry.shape.indices == shape.indices)
+				return entry.geometry;
+		}
+
+		Entry entry{ shape, floats_per_vertex, create_vertexobjects(shape, floats_per_vertex) };
+		entries.push_back(entry);
+		return entry.geometry;
+	}
+
+	int number_of_shapes() const
+	{
+		return static_cast<int>(entries.size());
+	}
+
+	//Lscht alle Vertex-Objekte. Muss vor dem Schliessen des OpenGL-Contexts aufgerufen werden.
+	void unload()
+	{
+		for (const Entry& entry : entries)
+		{
+			Game::gl.delete_vertex_array(entry.geometry.vao);
+			glDeleteBuffers(1, &entry.geometry.vbo);
+			glDeleteBuffers(1, &entry.geometry.ebo);
+		}
+		entries.clear();
+	}
+
+private:
+	//Die Formen sind klein, darum reicht eine Liste mit Vergleich ber die Daten.
+	struct Entry
+	{
+		OpenGL_Shape shape;
+		int floats_per_vertex;
+		Geometry geometry;
+	};
+	std::vector<Entry> entries{};
+
+	Geometry create_vertexobjects(const OpenGL_Shape& shape, int floats_per_vertex)
+	{
+		Geometry geometry{};
+		glGenVertexArrays(1, &geometry.vao);
+		glGenBuffers(1, &geometry.vbo);
+		glGenBuffers(1, &geometry.ebo);
+
+		Game::gl.bind_vertex_array(geometry.vao);
+
+		glBindBuffer(GL_ARRAY_BUFFER, geometry.vbo);
+		glBufferData(GL_ARRAY_BUFFER, shape.vertex_data.size() * sizeof(float), shape.vertex_data.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shape.indices.size() * sizeof(unsigned int), shape.indices.data(), GL_STATIC_DRAW);
+
+		//2D-Koordinaten
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, floats_per_vertex * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+
+		//Textur-Koordinaten
+		if (floats_per_vertex == 4)
+		{
+			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+			glEnableVertexAttribArray(1);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return geometry;
+	}
+};
+
+namespace Game
+{
+	Geometry_Cache geometry{};	//Alle hochgeladenen Formen.
+};
+
+//Generische Shader-Klasse. Beinhaltet keine Vertex-Objekte. Das Programm gehrt Game::programs.
+class Shader
+{
+public:
+	Shader() {};
+
+	void load(const std::string& shader_name)
+	{
+		if (loaded == false)
+		{
+			program = Game::programs.get(shader_name);
+			loaded = true;
+		}
 	}
 
 	void unload()
 	{
-		if (loaded == true)
+		if(loaded)
 		{
-			glDeleteVertexArrays(1, &vao);
-			glDeleteBuffers(1, &vbo);
-			glDeleteBuffers(1, &ebo);
+			program = 0;
 			loaded = false;
 		}
 	}
 
-	~Shader_2D()
+	~Shader()
 	{
 		unload();
 	}
 
 protected:
-	unsigned int vao{}, vbo{}, ebo{};
+	unsigned int program{};
 
 private:
-	bool loaded{ false };
-	void create_vertexobjects()
-	{
-		glGenVertexArrays(1, &vao);
-		glGenBuffers(1, &vbo);
-		glGenBuffers(1, &ebo);
-
-		glBindVertexArray(vao);
-
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, vertex_data.size() * sizeof(float), vertex_data.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
-	}
+	bool loaded{false};
 };
 
-//Shader-Template fr 2D-Objekte mit Textur aber ohne Farbdaten.
-class Shader_2D_Textured : public Shader
+//Shader-Template fr 2D-Objekte ohne Textur- oder Farbdaten. Die Vertex-Objekte gehren Game::geometry.
+class Shader_2D : public Shader
 {
 public:
-	Shader_2D_Textured(bool mipmap = true) : mipmap{mipmap} {}
+	Shader_2D() : Shader() {}
 
-	void load(const std::string &texture_path, const OpenGL_Shape &shape, const std::string &shader_name)
+	void load(const OpenGL_Shape &shape, const std::string& shader_name)
 	{
 		if (loaded == false)
 		{
-			Shader::load(shape.vertex_data, shape.indices, shader_name);
-			create_vertexobjects();
-			load_texture(texture_path.c_str());
+			Shader::load(shader_name);
+			vao = Game::geometry.get(shape, 2).vao;
 			loaded = true;
 		}
 	}
@@ -867,49 +1819,133 @@ public:
 	{
 		if (loaded == true)
 		{
-			glDeleteVertexArrays(1, &vao);
-			glDeleteBuffers(1, &vbo);
-			glDeleteBuffers(1, &ebo);
-			glDeleteTextures(1, &texture);
+			vao = 0;
 			loaded = false;
 		}
 	}
 
-	~Shader_2D_Textured()
+	~Shader_2D()
 	{
 		unload();
 	}
 
 protected:
-	unsigned int texture{}, vao{}, vbo{}, ebo{};
-	float texcel_width{}, texcel_height{};
+	unsigned int vao{};
 
 private:
-	bool loaded{ false }, mipmap;
-	void create_vertexobjects()
+	bool loaded{ false };
+};
+
+//Ldt jedes Bild nur einmal hoch und teilt die Textur nach Pfad, mit Referenzzhlung.
+//Mit use_atlas(true) landen kleine Bilder mit Mipmaps zusammen in einem Atlas, damit Text und Portraits dieselbe Textur benutzen.
+class Texture_Manager
+{
+public:
+	//Die Textur und der Ausschnitt darin, in dem das Bild liegt (ohne Atlas das ganze Bild).
+	struct Texture
 	{
-		glGenVertexArrays(1, &vao);
-		glGenBuffers(1, &vbo);
-		glGenBuffers(1, &ebo);
+		unsigned int id{};
+		float texcel_width{}, texcel_height{};						//Grsse eines Pixels, in Koordinaten des Bildes (0 bis 1).
+		float x{ 0.0f }, y{ 0.0f }, width{ 1.0f }, height{ 1.0f };	//Ausschnitt in Koordinaten der Textur.
+	};
 
-		glBindVertexArray(vao);
+	Texture_Manager() {}
 
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, vertex_data.size() * sizeof(float), vertex_data.data(), GL_STATIC_DRAW);
+	//Muss vor dem Laden der ersten Textur aufgerufen werden.
+	void use_atlas(bool atlas)
+	{
+		atlas_enabled = atlas;
+	}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+	Texture acquire(const std::string& path, bool mipmap)
+	{
+		auto it{ textures.find({ path, mipmap }) };
+		if (it != textures.end())
+		{
+			it->second.users++;
+			return it->second.texture;
+		}
 
-		//2D-Koordinaten
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
+		Entry entry{};
+		SDL_Surface* surface{ IMG_Load(path.c_str()) };
+		if (surface == NULL)
+		{
+			std::cerr << "Error: Could not load the texture " << path << "! " << IMG_GetError() << '\n';
+		}
+		else
+		{
+			flip_surface(surface);
+			entry.in_atlas = atlas_enabled && mipmap && add_to_atlas(surface, entry.texture);
+			if (!entry.in_atlas)
+				entry.texture = upload(surface, mipmap);
+			SDL_FreeSurface(surface);
+		}
+		textures[{ path, mipmap }] = entry;
+		return entry.texture;
+	}
 
-		//Textur-Koordinaten
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-		glEnableVertexAttribArray(1);
+	void release(const std::string& path, bool mipmap)
+	{
+		auto it{ textures.find({ path, mipmap }) };
+		if (it == textures.end())
+			return;
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+		it->second.users--;
+		if (it->second.users > 0)
+			return;
+
+		if (!it->second.in_atlas)
+			Game::gl.delete_texture(it->second.texture.id);
+		else if (--atlas_users == 0)
+			delete_atlas();
+		textures.erase(it);
+	}
+
+	//Anzahl OpenGL-Texturen (der Atlas zhlt einmal).
+	int number_of_textures() const
+	{
+		int n{ atlas != 0 ? 1 : 0 };
+		for (const auto& [key, entry] : textures)
+		{
+			if (!entry.in_atlas)
+				n++;
+		}
+		return n;
+	}
+
+	//Lscht alle Texturen. Muss vor dem Schliessen des OpenGL-Contexts aufgerufen werden.
+	void unload()
+	{
+		for (const auto& [key, entry] : textures)
+		{
+			if (!entry.in_atlas)
+				Game::gl.delete_texture(entry.texture.id);
+		}
+		textures.clear();
+		atlas_users = 0;
+		delete_atlas();
+	}
+
+private:
+	struct Entry
+	{
+		Texture texture{};
+		int users{ 1 };
+		bool in_atlas{ false };
+	};
+	std::map<std::pair<std::string, bool>, Entry> textures{};
+
+	//Atlas: Die Bilder werden in Regalen von links nach rechts abgelegt. Die Positionen sind auf 16 Pixel ausgerichtet und
+	//mindestens 16 Pixel auseinander, damit bis zur vierten Mipmap-Stufe keine Nachbarn hineinbluten.
+	static constexpr int atlas_width{ 1536 }, atlas_height{ 1024 }, atlas_max_image{ 1024 }, atlas_padding{ 16 };
+	bool atlas_enabled{ false };
+	unsigned int atlas{};
+	int atlas_users{ 0 };
+	int shelf_x{ 0 }, shelf_y{ 0 }, shelf_height{ 0 };
+
+	static int align(int n)
+	{
+		return (n + atlas_padding - 1) / atlas_padding * atlas_padding;
 	}
 
 	//Um das Bild korrekt herum zu drehen.
@@ -938,11 +1974,12 @@ private:
 		SDL_UnlockSurface(surface);
 	}
 
-	//Lade die Textur
-	void load_texture(const char* font_path = nullptr)
+	//Lade das Bild als eigene Textur hoch.
+	Texture upload(SDL_Surface* surface, bool mipmap)
 	{
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
+		Texture texture{};
+		glGenTextures(1, &texture.id);
+		Game::gl.bind_texture(texture.id);
 
 		//Bestimmt, wie die Textur vortgesetzt wird, sobald man ber den Rand hinaus geht.
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -956,216 +1993,450 @@ private:
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-		//Lade die Textur hoch
-		SDL_Surface* texture_surface;
-		if (font_path == nullptr)
-			texture_surface = IMG_Load("Fonts\\Font_Digital.png"); //Default-Font
-		else
-			texture_surface = IMG_Load(font_path);
+		int modus{ GL_RGB };
+		if (surface->format->BytesPerPixel == 4)
+			modus = GL_RGBA;
+		glTexImage2D(GL_TEXTURE_2D, 0, modus, surface->w, surface->h, 0, modus, GL_UNSIGNED_BYTE, surface->pixels);
+		if(mipmap)
+			glGenerateMipmap(GL_TEXTURE_2D);
 
-		if (texture_surface == NULL)
-		{
-			std::cerr << "Error: Could not load Font texture!\n";
-		}
-		else
-		{
-			flip_surface(texture_surface);
-			int modus{ GL_RGB };
-			if (texture_surface->format->BytesPerPixel == 4)
-				modus = GL_RGBA;
-			glTexImage2D(GL_TEXTURE_2D, 0, modus, texture_surface->w, texture_surface->h, 0, modus, GL_UNSIGNED_BYTE, texture_surface->pixels);
-			if(mipmap)
-				glGenerateMipmap(GL_TEXTURE_2D);
+		texture.texcel_width = 1.0f / static_cast<float>(surface->w);
+		texture.texcel_height = 1.0f / static_cast<float>(surface->h);
+		return texture;
+	}
+
+	//Gibt false zurck, falls das Bild zu gross ist oder keinen Platz mehr hat; dann bekommt es eine eigene Textur.
+	bool add_to_atlas(SDL_Surface* surface, Texture& texture)
+	{
+		if (surface->w > atlas_max_image || surface->h > atlas_max_image)
+			return false;
 
-			texcel_width = 1.0f / static_cast<float>(texture_surface->w);
-			texcel_height = 1.0f / static_cast<float>(texture_surface->h);
+		int x{ shelf_x }, y{ shelf_y };
+		if (x + surface->w > atlas_width)
+		{
+			x = 0;
+			y = align(shelf_y + shelf_height + atlas_padding);
 		}
+		if (y + surface->h > atlas_height)
+			return false;
+
+		SDL_Surface* rgba{ SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ABGR8888, 0) };
+		if (rgba == NULL)
+			return false;
+
+		if (atlas == 0)
+			create_atlas();
+		Game::gl.bind_texture(atlas);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, rgba->pitch / 4);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, rgba->w, rgba->h, GL_RGBA, GL_UNSIGNED_BYTE, rgba->pixels);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		SDL_FreeSurface(rgba);
+
+		texture.id = atlas;
+		texture.texcel_width = 1.0f / static_cast<float>(surface->w);
+		texture.texcel_height = 1.0f / static_cast<float>(surface->h);
+		texture.x = static_cast<float>(x) / static_cast<float>(atlas_width);
+		texture.y = static_cast<float>(y) / static_cast<float>(atlas_height);
+		texture.width = static_cast<float>(surface->w) / static_cast<float>(atlas_width);
+		texture.height = static_cast<float>(surface->h) / static_cast<float>(atlas_height);
+
+		if (y != shelf_y)
+			shelf_height = 0;
+		shelf_x = align(x + surface->w + atlas_padding);
+		shelf_y = y;
+		shelf_height = std::max(shelf_height, surface->h);
+		atlas_users++;
+		return true;
+	}
+
+	void create_atlas()
+	{
+		const std::vector<uint8_t> transparent(static_cast<size_t>(atlas_width) * atlas_height * 4, 0);
+		glGenTextures(1, &atlas);
+		Game::gl.bind_texture(atlas);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas_width, atlas_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, transparent.data());
+	}
 
-		SDL_FreeSurface(texture_surface);
+	void delete_atlas()
+	{
+		if (atlas != 0)
+			Game::gl.delete_texture(atlas);
+		atlas = 0;
+		shelf_x = shelf_y = shelf_height = 0;
 	}
 };
 
-//Einfacher Shader fr ein Rechteck
-class Shader_Square : public Shader_2D
+namespace Game
 {
-public:
+	Texture_Manager textures{};	//Alle geladenen Bilder, nach Pfad.
+};
 
-	Shader_Square(){}
+//Shader-Template fr 2D-Objekte mit Textur aber ohne Farbdaten. Die Vertex-Objekte gehren Game::geometry, die Textur Game::textures.
+class Shader_2D_Textured : public Shader
+{
+public:
+	Shader_2D_Textured(bool mipmap = true) : mipmap{mipmap} {}
 
-	void load(const OpenGL_Shape &shape = Shapes::square)
+	void load(const std::string &texture_path, const OpenGL_Shape &shape, const std::string &shader_name)
 	{
-		if(!loaded)
+		if (loaded == false)
 		{
-			Shader_2D::load(shape, "monocolour_shader");
-
-			//Position Uniform-Variablen.
-			x_loc = glGetUniformLocation(program, "x");
-			scaling_loc = glGetUniformLocation(program, "scaling");
-			input_colour_loc = glGetUniformLocation(program, "input_colour");
-
+			Shader::load(shader_name);
+			vao = Game::geometry.get(shape, 4).vao;
+			texture_name = texture_path;
+			texture_data = Game::textures.acquire(texture_path, mipmap);
+			texture = texture_data.id;
+			texcel_width = texture_data.texcel_width;
+			texcel_height = texture_data.texcel_height;
 			loaded = true;
 		}
 	}
 
-	void draw() const
+	void unload()
 	{
-		if (loaded)
+		if (loaded == true)
 		{
-			glUseProgram(program);
-			glBindVertexArray(vao);
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-			glUseProgram(0);
-			glBindVertexArray(0);
+			vao = 0;
+			Game::textures.release(texture_name, mipmap);
+			texture = 0;
+			loaded = false;
 		}
 	}
 
-	void move_to(float x_draw, float y_draw) const
+	~Shader_2D_Textured()
 	{
-		if(loaded)
+		unload();
+	}
+
+protected:
+	unsigned int texture{}, vao{};
+	float texcel_width{}, texcel_height{};
+
+	//Setzt den Textur-Ausschnitt (in Koordinaten des Bildes) als Uniform, umgerechnet auf den Ausschnitt im Atlas.
+	void set_texture_square_uniforms(int x_texture_loc, int scaling_texture_loc, const float x_texture[2], const float scaling_texture[2]) const
+	{
+		Game::gl.uniform(program, x_texture_loc, texture_data.x + x_texture[0] * texture_data.width, texture_data.y + x_texture[1] * texture_data.height);
+		Game::gl.uniform(program, scaling_texture_loc, scaling_texture[0] * texture_data.width, scaling_texture[1] * texture_data.height);
+	}
+
+private:
+	bool loaded{ false }, mipmap;
+	std::string texture_name{};
+	Texture_Manager::Texture texture_data{};
+};
+
+//Sammelt alle einfarbigen Rechtecke (Shader_Square und Shader_Square_with_Border) und zeichnet sie instanziert mit einem Aufruf.
+//Die Reihenfolge bleibt erhalten: Jeder andere Shader ruft vor dem Zeichnen flush() auf, ebenso das Ende eines Bildes.
+//Ab OpenGL 4.4 liegen die Instanzen in einem dauerhaft gemappten Ring-Buffer mit drei Abschnitten, einer pro Bild:
+//flush() kopiert nur in den Abschnitt des aktuellen Bildes, end_frame() setzt einen Fence, und erst wenn die Grafikkarte
+//den Abschnitt drei Bilder spter nicht mehr liest, wird er berschrieben. Sonst wird der Buffer pro flush() neu befllt.
+class Quad_Batcher : public Shader
+{
+public:
+	//Eigenschaften eines Rechtecks, genau so wie sie im Instanz-Buffer liegen.
+	struct Instance
+	{
+		float x{}, y{};
+		float width{}, height{};
+		float r{}, g{}, b{};
+		float border_r{}, border_g{}, border_b{};
+		float border_width{}, border_height{};
+	};
+
+	Quad_Batcher() {}
+
+	void load()
+	{
+		if (!loaded)
 		{
-			glUseProgram(program);
-			glUniform2f(x_loc, x_draw, y_draw);
-			glUseProgram(0);
+			Shader::load("monocolour_instanced_shader");
+			create_vertexobjects();
+			loaded = true;
 		}
 	}
 
-	void change_size(const Scale_2D &shape) const
+	void add(const Instance& instance)
 	{
-		if(loaded)
+		instances.push_back(instance);
+	}
+
+	//Zeichnet alle gesammelten Rechtecke und leert die Liste.
+	void flush()
+	{
+		if (loaded && !instances.empty())
 		{
-			glUseProgram(program);
-			glUniform2f(scaling_loc, shape.width, shape.height);
-			glUseProgram(0);
+			const int n{ static_cast<int>(instances.size()) };
+			int first_instance{ 0 };
+			if (mapped != nullptr && section_used + n > section_capacity)
+				create_ring(std::max(2 * section_capacity, n));
+
+			if (mapped != nullptr)
+			{
+				if (section_used == 0)
+					wait_for_section(section);
+
+				first_instance = section * section_capacity + section_used;
+				memcpy(mapped + static_cast<size_t>(first_instance) * sizeof(Instance), instances.data(), n * sizeof(Instance));
+				section_used += n;
+			}
+			else
+				Game::gl.buffer_data(GL_ARRAY_BUFFER, instance_vbo, n * sizeof(Instance), instances.data(), GL_STREAM_DRAW);
+
+			Game::gl.use_program(program);
+			Game::gl.bind_vertex_array(vao);
+			Game::gl.draw_elements_instanced(GL_TRIANGLES, 6, n, first_instance);
 		}
+		instances.clear();
 	}
 
-	void change_colour(const Colour& input_colour) const
+	//Nach dem letzten flush() eines Bildes: Der Abschnitt des Bildes ist fertig, das nchste Bild schreibt in den nchsten.
+	void end_frame()
 	{
-		if(loaded)
+		if (mapped != nullptr && section_used > 0)
 		{
-			glUseProgram(program);
-			glUniform3f(input_colour_loc, input_colour.r, input_colour.g, input_colour.b);
-			glUseProgram(0);
+			if (fences[section] != nullptr)
+				glDeleteSync(fences[section]);
+			fences[section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			section = (section + 1) % n_sections;
+			section_used = 0;
 		}
-	}	  
+	}
 
 	void unload()
 	{
-		if(loaded)
+		if (loaded)
 		{
-			Shader_2D::unload();
-			x_loc = 0;
-			scaling_loc = 0;
-			input_colour_loc = 0;
+			delete_fences();
+			Game::gl.delete_vertex_array(vao);
+			glDeleteBuffers(1, &instance_vbo);
+			mapped = nullptr;
+			Shader::unload();
+			instances.clear();
 			loaded = false;
 		}
 	}
 
-	~Shader_Square()
+	~Quad_Batcher()
 	{
 		unload();
 	}
 
 private:
-	bool loaded{false};
-
-	//Uniform-Variablen Ort im Shader
-	int x_loc{}, scaling_loc{}, input_colour_loc{};
-};
+	bool loaded{ false };
+	unsigned int vao{}, instance_vbo{};
+	std::vector<Instance> instances{};
+
+	//Ring-Buffer (nur mit OpenGL 4.4)
+	static constexpr int n_sections{ 3 };
+	uint8_t* mapped{ nullptr };
+	int section_capacity{ 1024 };	//Rechtecke pro Bild; wchst, falls ein Bild mehr braucht.
+	int section{ 0 }, section_used{ 0 };
+	GLsync fences[n_sections]{};
+
+	//Eigenes VAO, da es die Instanz-Attribute enthlt. Die Ecken des Quadrats (Attribut 0) kommen aus Game::geometry,
+	//die Attribute 1-5 pro Instanz aus instance_vbo.
+	void create_vertexobjects()
+	{
+		const Geometry_Cache::Geometry square{ Game::geometry.get(Shapes::square, 2) };
+		glGenVertexArrays(1, &vao);
+		Game::gl.bind_vertex_array(vao);
 
-//Einfacher Shader fr ein Rechteck mit Rand
-class Shader_Square_with_Border : public Shader_2D
-{
-public:
+		glBindBuffer(GL_ARRAY_BUFFER, square.vbo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, square.ebo);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
 
-	Shader_Square_with_Border() {}
+		//Ein Backend, das nur aufzeichnet, schreibt nie in den Ring; dann reicht der normale Buffer.
+		if (Game::window.glsl_version() >= 440 && Game::gl.get_backend().executes())
+			create_ring(section_capacity);
+		else
+		{
+			glGenBuffers(1, &instance_vbo);
+			set_instance_attributes();
+		}
+	}
 
-	void load(const OpenGL_Shape& shape = Shapes::square)
+	void set_instance_attributes()
 	{
-		if (!loaded)
+		Game::gl.bind_vertex_array(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+
+		const int n_components[5]{ 2, 2, 3, 3, 2 };
+		size_t offset{ 0 };
+		for (unsigned int i{ 0 }; i < 5; i++)
 		{
-			Shader_2D::load(shape, "monocolour_border_shader");
+			glVertexAttribPointer(i + 1, n_components[i], GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offset);
+			glEnableVertexAttribArray(i + 1);
+			glVertexAttribDivisor(i + 1, 1);
+			offset += n_components[i] * sizeof(float);
+		}
 
-			//Position Uniform-Variablen.
-			x_loc = glGetUniformLocation(program, "x");
-			scaling_loc = glGetUniformLocation(program, "scaling");
-			input_colour_loc = glGetUniformLocation(program, "input_colour");
-			border_colour_loc = glGetUniformLocation(program, "border_colour");
-			border_thickness_loc = glGetUniformLocation(program, "border_thickness");
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
 
-			loaded = true;
+	//Ein Buffer mit glBufferStorage ist unvernderlich; zum Vergrssern wird ein neuer angelegt.
+	//Der alte wird erst gelscht, wenn die Grafikkarte ihn nicht mehr braucht (das macht OpenGL selbst).
+	void create_ring(int capacity)
+	{
+		delete_fences();
+		if (instance_vbo != 0)
+			glDeleteBuffers(1, &instance_vbo);
+		section_capacity = capacity;
+		section = 0;
+		section_used = 0;
+
+		const GLbitfield flags{ GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+		const GLsizeiptr size{ static_cast<GLsizeiptr>(n_sections * section_capacity * sizeof(Instance)) };
+		glGenBuffers(1, &instance_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+		glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+		mapped = static_cast<uint8_t*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+		if (mapped == nullptr)
+		{
+			//Ohne Mapping wie vor OpenGL 4.4: Ein normaler Buffer, der pro flush() neu befllt wird.
+			glDeleteBuffers(1, &instance_vbo);
+			glGenBuffers(1, &instance_vbo);
 		}
+		set_instance_attributes();
 	}
 
-	void draw() const
+	void wait_for_section(int i)
 	{
-		if (loaded)
+		if (fences[i] != nullptr)
 		{
-			glUseProgram(program);
-			glBindVertexArray(vao);
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-			glUseProgram(0);
-			glBindVertexArray(0);
+			while (glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+			glDeleteSync(fences[i]);
+			fences[i] = nullptr;
 		}
 	}
 
-	void move_to(float x_draw, float y_draw) const
+	void delete_fences()
 	{
-		if (loaded)
+		for (GLsync& fence : fences)
 		{
-			glUseProgram(program);
-			glUniform2f(x_loc, x_draw, y_draw);
-			glUseProgram(0);
+			if (fence != nullptr)
+				glDeleteSync(fence);
+			fence = nullptr;
 		}
 	}
+};
+
+namespace Game
+{
+	Quad_Batcher quads{};	//Alle einfarbigen Rechtecke eines Bildes.
+};
+
+//Einfaches Rechteck. Wird beim Zeichnen nur in Game::quads gesammelt.
+class Shader_Square
+{
+public:
+
+	Shader_Square(){}
 
-	void change_size(const Scale_2D &shape, const Scale_2D& border = {0.005f,0.005f}) const
+	void load()
 	{
-		if (loaded)
+		if(!loaded)
 		{
-			glUseProgram(program);
-			glUniform2f(scaling_loc, shape.width, shape.height);
-			glUniform2f(border_thickness_loc, border.width, border.height);
-			glUseProgram(0);
+			Game::quads.load();
+			loaded = true;
 		}
 	}
 
-	void change_colour(const Colour& input_colour, const Colour& border_colour = {0.0f,0.0f,0.0f}) const
+	void draw() const
 	{
 		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform3f(input_colour_loc, input_colour.r, input_colour.g, input_colour.b);
-			glUniform3f(border_colour_loc, border_colour.r, border_colour.g, border_colour.b);
-			glUseProgram(0);
-		}
+			Game::quads.add(instance);
+	}
+
+	void move_to(float x_draw, float y_draw)
+	{
+		instance.x = x_draw;
+		instance.y = y_draw;
+	}
+
+	void change_size(const Scale_2D &shape)
+	{
+		instance.width = shape.width;
+		instance.height = shape.height;
 	}
 
+	//Ohne Rand: Die Randfarbe ist gleich der Fllfarbe.
+	void change_colour(const Colour& input_colour)
+	{
+		instance.r = instance.border_r = input_colour.r;
+		instance.g = instance.border_g = input_colour.g;
+		instance.b = instance.border_b = input_colour.b;
+	}	  
+
 	void unload()
 	{
-		if (loaded)
+		loaded = false;
+	}
+
+private:
+	bool loaded{false};
+	Quad_Batcher::Instance instance{};
+};
+
+//Einfaches Rechteck mit Rand. Wird beim Zeichnen nur in Game::quads gesammelt.
+class Shader_Square_with_Border
+{
+public:
+
+	Shader_Square_with_Border() {}
+
+	void load()
+	{
+		if (!loaded)
 		{
-			Shader_2D::unload();
-			x_loc = 0;
-			scaling_loc = 0;
-			input_colour_loc = 0;
-			border_colour_loc = 0;
-			border_thickness_loc = 0;
-			loaded = false;
+			Game::quads.load();
+			loaded = true;
 		}
 	}
 
-	~Shader_Square_with_Border()
+	void draw() const
+	{
+		if (loaded)
+			Game::quads.add(instance);
+	}
+
+	void move_to(float x_draw, float y_draw)
+	{
+		instance.x = x_draw;
+		instance.y = y_draw;
+	}
+
+	void change_size(const Scale_2D &shape, const Scale_2D& border = {0.005f,0.005f})
+	{
+		instance.width = shape.width;
+		instance.height = shape.height;
+		instance.border_width = border.width;
+		instance.border_height = border.height;
+	}
+
+	void change_colour(const Colour& input_colour, const Colour& border_colour = {0.0f,0.0f,0.0f})
 	{
-		unload();
+		instance.r = input_colour.r;
+		instance.g = input_colour.g;
+		instance.b = input_colour.b;
+		instance.border_r = border_colour.r;
+		instance.border_g = border_colour.g;
+		instance.border_b = border_colour.b;
+	}
+
+	void unload()
+	{
+		loaded = false;
 	}
 
 private:
 	bool loaded{ false };
-
-	//Uniform-Variablen Ort im Shader
-	unsigned int x_loc{}, scaling_loc{}, input_colour_loc{};
-	unsigned int border_colour_loc{}, border_thickness_loc{};
+	Quad_Batcher::Instance instance{};
 };
 
 //Einfacher Shader fr ein Rechteck mit einfarbiger Textur.
@@ -1193,68 +2464,60 @@ public:
 
 	void draw() const
 	{
+		Game::quads.flush();
 		if (loaded)
 		{
-			glUseProgram(program);
-			glBindVertexArray(vao);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, texture);
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-			glUseProgram(0);
-			glBindVertexArray(0);
+			set_uniforms();
+			Game::gl.use_program(program);
+			Game::gl.bind_vertex_array(vao);
+			Game::gl.bind_texture(texture);
+			Game::gl.draw_elements(GL_TRIANGLES, 6);
 		}
 	}
 
-	void move_to(float x_draw, float y_draw) const
+	//Zeichne andere Geometrie (gleiches Format wie Shapes::square_textured) mit diesem Programm und dieser Textur.
+	void draw(unsigned int vertex_array, int n_indices) const
 	{
-		if (loaded)
+		Game::quads.flush();
+		if (loaded && n_indices > 0)
 		{
-			glUseProgram(program);
-			glUniform2f(x_loc, x_draw, y_draw);
-			glUseProgram(0);
+			set_uniforms();
+			Game::gl.use_program(program);
+			Game::gl.bind_vertex_array(vertex_array);
+			Game::gl.bind_texture(texture);
+			Game::gl.draw_elements(GL_TRIANGLES, n_indices);
 		}
 	}
 
+	void move_to(float x_draw, float y_draw)
+	{
+		x[0] = x_draw;
+		x[1] = y_draw;
+	}
+
 	//Bewege das Quadrat, welches den Ausschnitt der Textur zeigt, den es zu zeichnen gilt.
-	void move_texture_square(float x_new, float y_new) const
+	void move_texture_square(float x_new, float y_new)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(x_texture_loc, x_new + 0.5f*texcel_width, y_new + 0.5f * texcel_height);
-			glUseProgram(0);
-		}
+		x_texture[0] = x_new + 0.5f * texcel_width;
+		x_texture[1] = y_new + 0.5f * texcel_height;
 	}
 
-	void change_size(const Scale_2D& shape) const
+	void change_size(const Scale_2D& shape)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(scaling_loc, shape.width, shape.height);
-			glUseProgram(0);
-		}
+		scaling[0] = shape.width;
+		scaling[1] = shape.height;
 	}
 
 	//ndere die Grsse des Quadrats, welches den Ausschnitt der Textur zeigt, den es zu zeichnen gilt.
-	void change_size_texture_square(float width, float height) const
+	void change_size_texture_square(float width, float height)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(scaling_texture_loc, width, height);
-			glUseProgram(0);
-		}
+		scaling_texture[0] = width;
+		scaling_texture[1] = height;
 	}
 
-	void change_colour(const Colour& input_colour) const
+	void change_colour(const Colour& input_colour)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform3f(input_colour_loc, input_colour.r, input_colour.g, input_colour.b);
-			glUseProgram(0);
-		}
+		colour = input_colour;
 	}
 
 	void unload()
@@ -1279,6 +2542,19 @@ private:
 
 	//Uniform-Variablen Ort im Shader
 	int x_loc{}, x_texture_loc{}, scaling_loc{}, scaling_texture_loc{}, input_colour_loc{};
+
+	//Eigene Uniform-Werte. Das Programm wird geteilt, darum werden sie bei jedem draw() gesetzt.
+	float x[2]{ 0.0f, 0.0f }, x_texture[2]{ 0.0f, 0.0f };
+	float scaling[2]{ 1.0f, 1.0f }, scaling_texture[2]{ 1.0f, 1.0f };
+	Colour colour{ 0.0f, 0.0f, 0.0f };
+
+	void set_uniforms() const
+	{
+		Game::gl.uniform(program, x_loc, x[0], x[1]);
+		Game::gl.uniform(program, scaling_loc, scaling[0], scaling[1]);
+		set_texture_square_uniforms(x_texture_loc, scaling_texture_loc, x_texture, scaling_texture);
+		Game::gl.uniform(program, input_colour_loc, colour.r, colour.g, colour.b);
+	}
 };
 
 //Einfacher Shader fr ein Rechteck mit Textur.
@@ -1306,68 +2582,46 @@ public:
 
 	void draw() const
 	{
+		Game::quads.flush();
 		if (loaded)
 		{
-			glUseProgram(program);
-			glBindVertexArray(vao);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, texture);
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-			glUseProgram(0);
-			glBindVertexArray(0);
+			set_uniforms();
+			Game::gl.use_program(program);
+			Game::gl.bind_vertex_array(vao);
+			Game::gl.bind_texture(texture);
+			Game::gl.draw_elements(GL_TRIANGLES, 6);
 		}
 	}
 
-	void move_to(float x_draw, float y_draw) const
+	void move_to(float x_draw, float y_draw)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(x_loc, x_draw, y_draw);
-			glUseProgram(0);
-		}
+		x[0] = x_draw;
+		x[1] = y_draw;
 	}
 
 	//Bewege das Quadrat, welches den Ausschnitt der Textur zeigt, den es zu zeichnen gilt.
-	void move_texture_square(float x_new, float y_new) const
+	void move_texture_square(float x_new, float y_new)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(x_texture_loc, x_new + 0.5f * texcel_width, y_new + 0.5f * texcel_height);
-			glUseProgram(0);
-		}
+		x_texture[0] = x_new + 0.5f * texcel_width;
+		x_texture[1] = y_new + 0.5f * texcel_height;
 	}
 
-	void change_size(const Scale_2D& shape) const
+	void change_size(const Scale_2D& shape)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(scaling_loc, shape.width, shape.height);
-			glUseProgram(0);
-		}
+		scaling[0] = shape.width;
+		scaling[1] = shape.height;
 	}
 
 	//ndere die Grsse des Quadrats, welches den Ausschnitt der Textur zeigt, den es zu zeichnen gilt.
-	void change_size_texture_square(float width, float height) const
+	void change_size_texture_square(float width, float height)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(scaling_texture_loc, width, height);
-			glUseProgram(0);
-		}
+		scaling_texture[0] = width;
+		scaling_texture[1] = height;
 	}
 
 	void flip(bool flip=true)
 	{
-		glUseProgram(program);
-		if(flip)
-			glUniform1i(flip_loc, true);
-		else
-			glUniform1i(flip_loc, false);
-		glUseProgram(0);
+		flipped = flip;
 	}
 
 	void unload()
@@ -1391,6 +2645,19 @@ private:
 
 	//Uniform-Variablen Ort im Shader
 	int x_loc{}, x_texture_loc{}, scaling_loc{}, scaling_texture_loc{}, flip_loc{};
+
+	//Eigene Uniform-Werte. Das Programm wird geteilt, darum werden sie bei jedem draw() gesetzt.
+	float x[2]{ 0.0f, 0.0f }, x_texture[2]{ 0.0f, 0.0f };
+	float scaling[2]{ 1.0f, 1.0f }, scaling_texture[2]{ 1.0f, 1.0f };
+	bool flipped{ false };
+
+	void set_uniforms() const
+	{
+		Game::gl.uniform(program, x_loc, x[0], x[1]);
+		Game::gl.uniform(program, scaling_loc, scaling[0], scaling[1]);
+		set_texture_square_uniforms(x_texture_loc, scaling_texture_loc, x_texture, scaling_texture);
+		Game::gl.uniform(program, flip_loc, flipped ? 1 : 0);
+	}
 };
 
 //Shader mit Textur, wo der Hintergrund von einer Farbe in die andere bergeht.
@@ -1420,79 +2687,52 @@ public:
 
 	void draw() const
 	{
+		Game::quads.flush();
 		if (loaded)
 		{
-			glUseProgram(program);
-			glBindVertexArray(vao);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, texture);
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-			glUseProgram(0);
-			glBindVertexArray(0);
+			set_uniforms();
+			Game::gl.use_program(program);
+			Game::gl.bind_vertex_array(vao);
+			Game::gl.bind_texture(texture);
+			Game::gl.draw_elements(GL_TRIANGLES, 6);
 		}
 	}
 
-	void move_to(float x_draw, float y_draw) const
+	void move_to(float x_draw, float y_draw)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(x_loc, x_draw, y_draw);
-			glUseProgram(0);
-		}
+		x[0] = x_draw;
+		x[1] = y_draw;
 	}
 
 	//Bewege das Quadrat, welches den Ausschnitt der Textur zeigt, den es zu zeichnen gilt.
-	void move_texture_square(float x_new, float y_new) const
+	void move_texture_square(float x_new, float y_new)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(x_texture_loc, x_new + 0.5f * texcel_width, y_new + 0.5f * texcel_height);
-			glUseProgram(0);
-		}
+		x_texture[0] = x_new + 0.5f * texcel_width;
+		x_texture[1] = y_new + 0.5f * texcel_height;
 	}
 
-	void change_size(const Scale_2D& shape) const
+	void change_size(const Scale_2D& shape)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(scaling_loc, shape.width, shape.height);
-			glUseProgram(0);
-		}
+		scaling[0] = shape.width;
+		scaling[1] = shape.height;
 	}
 
 	//ndere die Grsse des Quadrats, welches den Ausschnitt der Textur zeigt, den es zu zeichnen gilt.
-	void change_size_texture_square(float width, float height) const
+	void change_size_texture_square(float width, float height)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(scaling_texture_loc, width, height);
-			glUseProgram(0);
-		}
+		scaling_texture[0] = width;
+		scaling_texture[1] = height;
 	}
 
-	void change_background_colours(const Colour &colour1, const Colour &colour2)
+	void change_background_colours(const Colour &colour1_new, const Colour &colour2_new)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform3f(colour1_loc, colour1.r, colour1.g, colour1.b);
-			glUniform3f(colour2_loc, colour2.r, colour2.g, colour2.b);
-			glUseProgram(0);
-		}
+		colour1 = colour1_new;
+		colour2 = colour2_new;
 	}
 
-	void flip(bool flip = true)
+	void flip(bool flip=true)
 	{
-		glUseProgram(program);
-		if (flip)
-			glUniform1i(flip_loc, true);
-		else
-			glUniform1i(flip_loc, false);
-		glUseProgram(0);
+		flipped = flip;
 	}
 
 	void unload()
@@ -1516,6 +2756,22 @@ private:
 
 	//Uniform-Variablen Ort im Shader
 	int x_loc{}, x_texture_loc{}, scaling_loc{}, scaling_texture_loc{}, flip_loc{}, colour1_loc{}, colour2_loc{};
+
+	//Eigene Uniform-Werte. Das Programm wird geteilt, darum werden sie bei jedem draw() gesetzt.
+	float x[2]{ 0.0f, 0.0f }, x_texture[2]{ 0.0f, 0.0f };
+	float scaling[2]{ 1.0f, 1.0f }, scaling_texture[2]{ 1.0f, 1.0f };
+	bool flipped{ false };
+	Colour colour1{ 0.5f, 0.78f, 0.87f }, colour2{ 0.94f, 0.94f, 0.75f };
+
+	void set_uniforms() const
+	{
+		Game::gl.uniform(program, x_loc, x[0], x[1]);
+		Game::gl.uniform(program, scaling_loc, scaling[0], scaling[1]);
+		set_texture_square_uniforms(x_texture_loc, scaling_texture_loc, x_texture, scaling_texture);
+		Game::gl.uniform(program, flip_loc, flipped ? 1 : 0);
+		Game::gl.uniform(program, colour1_loc, colour1.r, colour1.g, colour1.b);
+		Game::gl.uniform(program, colour2_loc, colour2.r, colour2.g, colour2.b);
+	}
 };
 
 //Shader, der Linien zeichnet
@@ -1543,44 +2799,33 @@ public:
 
 	void draw() const
 	{
+		Game::quads.flush();
 		if (loaded)
 		{
-			glUseProgram(program);
-			glBindVertexArray(vao);
-			glDrawElements(GL_LINES, 2*n_lines, GL_UNSIGNED_INT, 0);
-			glUseProgram(0);
-			glBindVertexArray(0);
+			Game::gl.uniform(program, x_loc, x[0], x[1]);
+			Game::gl.uniform(program, scaling_loc, scaling[0], scaling[1]);
+			Game::gl.uniform(program, input_colour_loc, colour.r, colour.g, colour.b);
+			Game::gl.use_program(program);
+			Game::gl.bind_vertex_array(vao);
+			Game::gl.draw_elements(GL_LINES, 2*n_lines);
 		}
 	}
 
-	void move_to(float x_draw, float y_draw) const
+	void move_to(float x_draw, float y_draw)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(x_loc, x_draw, y_draw);
-			glUseProgram(0);
-		}
+		x[0] = x_draw;
+		x[1] = y_draw;
 	}
 
-	void change_size(const Scale_2D& shape) const
+	void change_size(const Scale_2D& shape)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform2f(scaling_loc, shape.width, shape.height);
-			glUseProgram(0);
-		}
+		scaling[0] = shape.width;
+		scaling[1] = shape.height;
 	}
 
-	void change_colour(const Colour& input_colour) const
+	void change_colour(const Colour& input_colour)
 	{
-		if (loaded)
-		{
-			glUseProgram(program);
-			glUniform3f(input_colour_loc, input_colour.r, input_colour.g, input_colour.b);
-			glUseProgram(0);
-		}
+		colour = input_colour;
 	}
 
 	void unload()
@@ -1606,6 +2851,269 @@ private:
 
 	//Uniform-Variablen Ort im Shader
 	int x_loc{}, scaling_loc{}, input_colour_loc{};
+
+	//Eigene Uniform-Werte. Das Programm wird geteilt, darum werden sie bei jedem draw() gesetzt.
+	float x[2]{ 0.0f, 0.0f }, scaling[2]{ 1.0f, 1.0f };
+	Colour colour{ 0.9f, 0.9f, 0.9f };
+};
+
+//Offscreen-Framebuffer, um ohne Fenster zu rendern und das Bild auszulesen.
+class Framebuffer
+{
+public:
+	Framebuffer() {}
+
+	void load(int w, int h)
+	{
+		if (!loaded)
+		{
+			width = w;
+			height = h;
+
+			glGenFramebuffers(1, &fbo);
+			glGenRenderbuffers(1, &colour_buffer);
+			glBindRenderbuffer(GL_RENDERBUFFER, colour_buffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour_buffer);
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+				std::cerr << "Error: Framebuffer is not complete!\n";
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+			//Zwei Pixel-Buffer, damit das Auslesen eines Bildes nicht auf das Rendern warten muss.
+			glGenBuffers(2, pbo);
+			for (int i{ 0 }; i < 2; i++)
+			{
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
+				glBufferData(GL_PIXEL_PACK_BUFFER, 4 * width * height, NULL, GL_STREAM_READ);
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+			loaded = true;
+		}
+	}
+
+	void bind() const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glViewport(0, 0, width, height);
+	}
+
+	void unbind() const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, Game::window.width(), Game::window.height());
+	}
+
+	//Fordert das aktuelle Bild an und gibt das vorherige als RGBA zurck (Zeilen von unten nach oben).
+	//Gibt false zurck, falls es noch kein vorheriges Bild gibt.
+	bool read_pixels(std::vector<uint8_t>& rgba)
+	{
+		Game::quads.flush();
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[next]);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		next = 1 - next;
+
+		bool ready{ pending };
+		if (pending)
+			copy_pixels(pbo[next], rgba);
+		pending = true;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		return ready;
+	}
+
+	//Liest das gerade gebundene Bild ohne Pixel-Buffer aus und speichert es als PPM (P6), z.B. als Vergleichsbild fr Tests.
+	static bool save_screenshot(const std::string& path, int w, int h)
+	{
+		Game::quads.flush();
+		std::vector<uint8_t> rgb(3 * static_cast<std::size_t>(w) * h);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+
+		std::ofstream file{ path, std::ios::binary };
+		if (!file)
+		{
+			std::cerr << "Error: Could not write the screenshot " << path << "!\n";
+			return false;
+		}
+		file << "P6\n" << w << ' ' << h << "\n255\n";
+		//OpenGL liefert die Zeilen von unten nach oben.
+		for (int row{ h - 1 }; row >= 0; row--)
+			file.write(reinterpret_cast<const char*>(rgb.data() + 3 * static_cast<std::size_t>(row) * w), 3 * static_cast<std::streamsize>(w));
+		return true;
+	}
+
+	//Gibt das letzte angeforderte Bild zurck.
+	bool finish_reading(std::vector<uint8_t>& rgba)
+	{
+		if (!pending)
+			return false;
+		copy_pixels(pbo[1 - next], rgba);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		pending = false;
+		return true;
+	}
+
+	int get_width() const
+	{
+		return width;
+	}
+
+	int get_height() const
+	{
+		return height;
+	}
+
+	void unload()
+	{
+		if (loaded)
+		{
+			glDeleteBuffers(2, pbo);
+			glDeleteRenderbuffers(1, &colour_buffer);
+			glDeleteFramebuffers(1, &fbo);
+			pending = false;
+			loaded = false;
+		}
+	}
+
+	~Framebuffer()
+	{
+		unload();
+	}
+
+private:
+	bool loaded{ false }, pending{ false };
+	int width{}, height{}, next{ 0 };
+	unsigned int fbo{}, colour_buffer{}, pbo[2]{};
+
+	void copy_pixels(unsigned int buffer, std::vector<uint8_t>& rgba) const
+	{
+		rgba.resize(4 * static_cast<std::size_t>(width) * height);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		const void* data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (data != nullptr)
+		{
+			memcpy(rgba.data(), data, rgba.size());
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+	}
+};
+
+//Schreibt Bilder als Video-Datei: .y4m (YUV 4:2:0, lesbar von ffmpeg, mpv etc.), sonst rohe RGB24-Bilder.
+class Video_Writer
+{
+public:
+	Video_Writer() {}
+
+	bool open(const std::string& path, int w, int h, int fps)
+	{
+		width = w;
+		height = h;
+		y4m = path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+
+		file.open(path, std::ios::binary);
+		if (!file)
+		{
+			std::cerr << "Error: Could not open video file! " << path << '\n';
+			return false;
+		}
+		if (y4m)
+			file << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+		return true;
+	}
+
+	//rgba: Zeilen von unten nach oben, wie von glReadPixels.
+	void write_frame(const std::vector<uint8_t>& rgba)
+	{
+		if (y4m)
+			write_frame_yuv(rgba);
+		else
+			write_frame_rgb(rgba);
+		n_frames++;
+	}
+
+	int number_of_frames() const
+	{
+		return n_frames;
+	}
+
+	void close()
+	{
+		file.close();
+	}
+
+private:
+	std::ofstream file;
+	int width{}, height{}, n_frames{ 0 };
+	bool y4m{ true };
+	std::vector<uint8_t> buffer;
+
+	const uint8_t* pixel(const std::vector<uint8_t>& rgba, int x, int y) const
+	{
+		x = std::min(x, width - 1);
+		y = std::min(y, height - 1);
+		return &rgba[4 * (static_cast<std::size_t>(height - 1 - y) * width + x)];
+	}
+
+	void write_frame_rgb(const std::vector<uint8_t>& rgba)
+	{
+		buffer.resize(3 * static_cast<std::size_t>(width) * height);
+		uint8_t* out = buffer.data();
+		for (int y{ 0 }; y < height; y++)
+		{
+			for (int x{ 0 }; x < width; x++)
+			{
+				const uint8_t* p = pixel(rgba, x, y);
+				*out++ = p[0];
+				*out++ = p[1];
+				*out++ = p[2];
+			}
+		}
+		file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	}
+
+	//RGB nach YCbCr (BT.601, voller Bereich), Farbanteile gemittelt ber 2x2 Pixel.
+	void write_frame_yuv(const std::vector<uint8_t>& rgba)
+	{
+		const int chroma_width{ (width + 1) / 2 }, chroma_height{ (height + 1) / 2 };
+		const std::size_t luma_size{ static_cast<std::size_t>(width) * height };
+		const std::size_t chroma_size{ static_cast<std::size_t>(chroma_width) * chroma_height };
+		buffer.resize(luma_size + 2 * chroma_size);
+		uint8_t* luma = buffer.data();
+		uint8_t* cb = luma + luma_size;
+		uint8_t* cr = cb + chroma_size;
+
+		for (int y{ 0 }; y < height; y++)
+		{
+			for (int x{ 0 }; x < width; x++)
+			{
+				const uint8_t* p = pixel(rgba, x, y);
+				luma[y * width + x] = static_cast<uint8_t>((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+			}
+		}
+
+		for (int y{ 0 }; y < chroma_height; y++)
+		{
+			for (int x{ 0 }; x < chroma_width; x++)
+			{
+				int r{ 0 }, g{ 0 }, b{ 0 };
+				for (int k{ 0 }; k < 4; k++)
+				{
+					const uint8_t* p = pixel(rgba, 2 * x + (k & 1), 2 * y + (k >> 1));
+					r += p[0];
+					g += p[1];
+					b += p[2];
+				}
+				cb[y * chroma_width + x] = static_cast<uint8_t>(std::clamp((-43 * r - 85 * g + 128 * b + 512) / 1024 + 128, 0, 255));
+				cr[y * chroma_width + x] = static_cast<uint8_t>(std::clamp((128 * r - 107 * g - 21 * b + 512) / 1024 + 128, 0, 255));
+			}
+		}
+
+		file << "FRAME\n";
+		file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	}
 };
 
 //Klassen, die Shader bentigen
@@ -1646,6 +3154,11 @@ public:
 			update_glyph_size();
 			update_glyph_coordinates();
 
+			//Die Textur-Koordinaten der Glyphen stehen schon in den Vertex-Daten.
+			shader.change_size_texture_square(1.0f, 1.0f);
+			shader.move_texture_square(0.0f, 0.0f);
+			create_glyph_buffers();
+
 			//Inputs
 			move_to(x,y);
 			change_glyph_size(glyph);
@@ -1655,47 +3168,24 @@ public:
 		}
 	}
 
+	//Zeichnet den ganzen Text mit einem Aufruf. Die Vierecke der Glyphen werden nur nach nderungen neu gebaut.
 	void draw()
 	{
 		if (loaded)
 		{
-			//Zeichne den Text
-			int i{ 0 }, j{ 0 };
-			for (int k{ 0 }; k < text.size(); k++)
-			{
-				//Zeichne den nchsten Glyphen, falls kein Absatz kommt.
-				if (text[k] != '\n')
-				{
-					//Setze die Textur-Koordinaten des nchsten Glyphen
-					shader.move_texture_square(x_array[k], y_array[k]);
-
-					//Zeichne den nchsten Glyphen
-					shader.move_to(x + i * glyph.width, y - j * glyph.height);
-					shader.draw();
-
-					//Teste, ob der nchste Glyph ber den rechten Rand hinaus geht.
-					if (x + static_cast<float>(i + 2) * glyph.width < 1.0f)
-					{
-						i++;
-					}
-					else
-					{
-						i = 0;
-						j++;
-					}
-
-				}
-				else //Falls ein Absatz kommt
-				{
-					i = 0;
-					j++;
-				}
-			}
+			if (glyph_quads_dirty)
+				update_glyph_quads();
+			shader.draw(glyph_vao, static_cast<int>(glyph_indices.size()));
 		}
 	}
 
+	//Die Zeilenumbrche hngen von x ab, y verschiebt nur den ganzen Text.
 	void move_to(float x_new, float y_new)
 	{
+		if (x_new != x)
+			glyph_quads_dirty = true;
+		if (x_new != x || y_new != y)
+			Game::redraw.mark_dirty();
 		x = x_new;
 		y = y_new;
 		shader.move_to(x_new,y_new);
@@ -1703,8 +3193,12 @@ public:
 
 	void change_text(const std::string &new_text)
 	{
+		if (new_text == text)
+			return;
 		text = new_text;
 		update_glyph_coordinates();
+		glyph_quads_dirty = true;
+		Game::redraw.mark_dirty();
 	}
 
 	void change_bitmap(const Bitmap &bitmap_new)
@@ -1712,12 +3206,16 @@ public:
 		bitmap = bitmap_new;
 		update_glyph_size();
 		update_glyph_coordinates();
+		glyph_quads_dirty = true;
+		Game::redraw.mark_dirty();
 	}
 
 	void change_glyph_size(const Scale_2D &new_glyph)
 	{
 		glyph = new_glyph;
 		shader.change_size(glyph);
+		glyph_quads_dirty = true;
+		Game::redraw.mark_dirty();
 	}
 
 	void change_text_size(const Scale_2D& new_glyph)
@@ -1726,12 +3224,15 @@ public:
 		glyph.width = glyph.width / static_cast<float>(get_number_of_letters());
 		glyph.height = glyph.height / static_cast<float>(get_number_of_paragraphs());
 		shader.change_size(glyph);
+		glyph_quads_dirty = true;
+		Game::redraw.mark_dirty();
 	}
 
 	void change_colour(const Colour& input_colour)
 	{
 		text_colour = input_colour;
 		shader.change_colour(input_colour);
+		Game::redraw.mark_dirty();
 	}
 
 	std::string string()
@@ -1839,6 +3340,10 @@ public:
 		if (loaded)
 		{
 			shader.unload();
+			Game::gl.delete_vertex_array(glyph_vao);
+			glDeleteBuffers(1, &glyph_vbo);
+			glDeleteBuffers(1, &glyph_ebo);
+			glyph_quads_dirty = true;
 			loaded = false;
 		}
 	}
@@ -1869,12 +3374,85 @@ private:
 	//Shader
 	Shader_Square_Textured_Monocolour shader{};
 
+	//Alle Glyphen des Texts als ein Vertex-Buffer: Pro Glyph ein Viereck in Einheiten der Glyph-Grsse, relativ zur
+	//Textposition, mit den Textur-Koordinaten des Zeichens. Position und Grsse kommen als Uniform dazu.
+	unsigned int glyph_vao{}, glyph_vbo{}, glyph_ebo{};
+	std::vector<float> glyph_vertices{};
+	std::vector<unsigned int> glyph_indices{};
+	bool glyph_quads_dirty{ true };
+
 	//ndert die Grsse des Glyphs anhand der Bitmap-Eigenschaften
 	void update_glyph_size()
 	{
 		glyph_width = 1.0f / static_cast<float>(bitmap.n_columns);
 		glyph_height = 1.0f / static_cast<float>(bitmap.n_rows);
-		shader.change_size_texture_square(glyph_width, glyph_height);
+	}
+
+	void create_glyph_buffers()
+	{
+		glGenVertexArrays(1, &glyph_vao);
+		glGenBuffers(1, &glyph_vbo);
+		glGenBuffers(1, &glyph_ebo);
+
+		Game::gl.bind_vertex_array(glyph_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glyph_ebo);
+
+		//2D-Koordinaten und Textur-Koordinaten, wie bei Shapes::glyph.
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	//Baut die Vierecke aller Glyphen neu und ldt sie hoch. Gleiche Zeilenumbrche wie get_number_of_paragraphs().
+	void update_glyph_quads()
+	{
+		glyph_vertices.clear();
+		glyph_indices.clear();
+		const std::vector<float>& corners{ Shapes::glyph.vertex_data };
+
+		int i{ 0 }, j{ 0 };
+		for (int k{ 0 }; k < text.size(); k++)
+		{
+			//Fge den nchsten Glyphen hinzu, falls kein Absatz kommt.
+			if (text[k] != '\n')
+			{
+				const unsigned int first_vertex{ static_cast<unsigned int>(glyph_vertices.size() / 4) };
+				for (int c{ 0 }; c < 4; c++)
+				{
+					glyph_vertices.push_back(corners[4 * c] + static_cast<float>(i));
+					glyph_vertices.push_back(corners[4 * c + 1] - static_cast<float>(j));
+					glyph_vertices.push_back(corners[4 * c + 2] * glyph_width + x_array[k]);
+					glyph_vertices.push_back(corners[4 * c + 3] * glyph_height + y_array[k]);
+				}
+				for (unsigned int index : Shapes::glyph.indices)
+					glyph_indices.push_back(first_vertex + index);
+
+				//Teste, ob der nchste Glyph ber den rechten Rand hinaus geht.
+				if (x + static_cast<float>(i + 2) * glyph.width < 1.0f)
+				{
+					i++;
+				}
+				else
+				{
+					i = 0;
+					j++;
+				}
+			}
+			else //Falls ein Absatz kommt
+			{
+				i = 0;
+				j++;
+			}
+		}
+
+		Game::gl.bind_vertex_array(glyph_vao);
+		Game::gl.buffer_data(GL_ARRAY_BUFFER, glyph_vbo, glyph_vertices.size() * sizeof(float), glyph_vertices.data(), GL_DYNAMIC_DRAW);
+		Game::gl.buffer_data(GL_ELEMENT_ARRAY_BUFFER, glyph_ebo, glyph_indices.size() * sizeof(unsigned int), glyph_indices.data(), GL_DYNAMIC_DRAW);
+		glyph_quads_dirty = false;
 	}
 
 	//Bestimmt, wo auf der Bitmap sich ein Glyph befindet.
@@ -2093,6 +3671,7 @@ public:
 		text_colour = text_colour_new;
 		shader.change_colour(button_colour, border_colour);
 		text.change_colour(text_colour);
+		Game::redraw.mark_dirty();
 	}
 
 	//Passt Sound und Farbe je nachdem an, ob der Knopf ausgewhlt/gedrckt wurde.
@@ -2175,8 +3754,19 @@ public:
 	}
 
 	void draw()
+	{
+		draw_shape();
+		draw_text();
+	}
+
+	//Getrennt, damit Mens zuerst alle Knpfe und dann alle Texte zeichnen knnen (ein Aufruf fr alle Rechtecke).
+	void draw_shape() const
 	{
 		shader.draw();
+	}
+
+	void draw_text()
+	{
 		if(text_exists)
 			text.draw();
 	}
@@ -2380,8 +3970,10 @@ public:
 		if(active && loaded)
 		{
 			shader.draw();
-			button_yes.draw();
-			button_no.draw();
+			button_yes.draw_shape();
+			button_no.draw_shape();
+			button_yes.draw_text();
+			button_no.draw_text();
 			txt_message.draw();
 		}
 	}
@@ -2498,7 +4090,11 @@ public:
 		{
 			for(int i=0; i<n; i++)
 			{
-				buttons[i].draw();
+				buttons[i].draw_shape();
+			}
+			for(int i=0; i<n; i++)
+			{
+				buttons[i].draw_text();
 			}
 		}
 	}
@@ -2787,9 +4383,12 @@ public:
 
 	void update_graphics(double alpha = 1.0)
 	{
+		const float x_draw_old{ x_slider_draw }, y_draw_old{ y_slider_draw };
 		x_slider_draw = static_cast<float>(alpha * x_slider + (1.0 - alpha) * x_slider_old);
 		y_slider_draw = static_cast<float>(alpha * y_slider + (1.0 - alpha) * y_slider_old);
 		shader_slider.move_to(x_slider_draw, y_slider_draw);
+		if (x_slider_draw != x_draw_old || y_slider_draw != y_draw_old)
+			Game::redraw.mark_dirty();
 	}
 
 	//Float zwischen 0 (ganz links) und 1 (ganz rechts)
@@ -0,0 +1,14 @@
+#version 460 core
+in vec2 x_shape;
+flat in vec2 x_border;
+flat in vec3 colour_inside;
+flat in vec3 colour_border;
+out vec4 Frag_Colour;
+
+void main()
+{
+	if( abs(x_shape.x) >= x_border.x || abs(x_shape.y) >= x_border.y )
+		Frag_Colour = vec4(colour_border,1.0f);
+	else
+		Frag_Colour = vec4(colour_inside,1.0f);
+}
\ No newline at end of file
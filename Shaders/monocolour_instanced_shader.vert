@@ -0,0 +1,19 @@
+#version 460 core
+layout(location=0) in vec2 x_start;
+layout(location=1) in vec2 x;
+layout(location=2) in vec2 scaling;
+layout(location=3) in vec3 input_colour;
+layout(location=4) in vec3 border_colour;
+layout(location=5) in vec2 border_thickness;
+out vec2 x_shape;
+flat out vec2 x_border;
+flat out vec3 colour_inside;
+flat out vec3 colour_border;
+void main()
+{
+	x_shape = x_start * scaling;
+	x_border = 0.5f * scaling - border_thickness;
+	colour_inside = input_colour;
+	colour_border = border_colour;
+	gl_Position = vec4(x_shape + x, 0.0f, 1.0f);
+}
\ No newline at end of file